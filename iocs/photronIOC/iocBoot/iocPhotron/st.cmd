@@ -37,9 +37,26 @@ asynSetMinTimerPeriod(0.001)
 # Uncomment the following line to set it in the IOC.
 #epicsEnvSet("EPICS_CA_MAX_ARRAY_BYTES", "10000000")
 
+# Without a camera (Linux builds use the simulated PDCLIB) configure the
+# simulated camera before creating the driver
+# PhotronSimConfig(int width, int height, int bits, double latencyUsec, 
+#                  double bandwidthMBps, int memFrames)
+#PhotronSimConfig(1024, 1024, 12, 100, 100, 1000)
+# Give the simulated camera a second interface for striped readout
+#PhotronSimAddLink("192.168.0.10", "192.168.1.10")
+# Mark an event every 500 frames of each simulated recording
+#PhotronSimEvents(500)
+# Give the simulated camera two heads, read by ports with childNo 1 and 2
+#PhotronSimHeads(2)
+
 # Create a Photron driver
 # PhotronConfig(const char *portName, const char *ipAddress, int autoDetect, 
-#                   int maxBuffers, int maxMemory, int priority, int stackSize)
+#                   int maxBuffers, int maxMemory, int priority, int stackSize,
+#                   int childNo, const char *linkIpAddress)
+# Each head of a multi-head camera gets its own port with the same ipAddress
+# and childNo 1, 2, ...; the ports download their heads together, taking
+# turns on the camera's link one frame at a time.
+# linkIpAddress is the camera's second interface (SA-Z), used by StripedReadout.
 #!PhotronConfig("$(PORT)", "192.168.0.10", 0, 2, 0, 0)
 # If plugins can't keep up and enabling blocking isn't ideal, increase the number of buffers
 PhotronConfig("$(PORT)", "192.168.0.10", 0, 20, 0, 0)
@@ -16,6 +16,8 @@
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
 
 #include <epicsTime.h>
 #include <epicsThread.h>
@@ -32,14 +34,140 @@
 #include "ADDriver.h"
 #include <epicsExport.h>
 #include "Photron.h"
+#include "PhotronConvert.h"
 
+#ifdef _WIN32
 #include <windows.h>
+#include <malloc.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 static const char *driverName = "Photron";
 
 static int PDCLibInitialized=0;
 
 static ELLLIST *cameraList;
+static epicsMutexId cameraListLock;
+static ELLLIST *deviceList;
+
+
+/* Page-aligned allocation for the buffers the SDK transfers images into */
+static void *transferBufAlloc(size_t size) {
+#ifdef _WIN32
+  return _aligned_malloc(size, TRANSFER_BUFFER_ALIGN);
+#else
+  void *pBuf;
+  
+  if (posix_memalign(&pBuf, TRANSFER_BUFFER_ALIGN, size)) {
+    return NULL;
+  }
+  return pBuf;
+#endif
+}
+
+
+static void transferBufFree(void *pBuf) {
+#ifdef _WIN32
+  _aligned_free(pBuf);
+#else
+  free(pBuf);
+#endif
+}
+
+
+/* Moves to an offset in a raw file, which can be past 2 GiB. Returns 0 on
+   success and -1 with errno set on failure. */
+static int rawFileSeek(int fd, double offset) {
+#ifdef _WIN32
+  return (_lseeki64(fd, (__int64)offset, SEEK_SET) < 0) ? -1 : 0;
+#else
+  return (lseek(fd, (off_t)offset, SEEK_SET) < 0) ? -1 : 0;
+#endif
+}
+
+
+/* Cuts or extends a raw file or its index to a size, which can be past 
+   2 GiB. Returns 0 on success and -1 with errno set on failure. */
+static int rawFileTruncate(int fd, double size) {
+#ifdef _WIN32
+  errno = _chsize_s(fd, (__int64)size);
+  return errno ? -1 : 0;
+#else
+  return ftruncate(fd, (off_t)size) ? -1 : 0;
+#endif
+}
+
+
+/* Allocates maps with a zero dark frame and unit gain for the given region,
+   with one reference. Returns NULL if there isn't enough memory. */
+static corrMaps_t *allocCorrMaps(unsigned long x, unsigned long y, 
+                                 unsigned long width, unsigned long height,
+                                 NDDataType_t dataType) {
+  size_t numPixels = width * height;
+  size_t index;
+  corrMaps_t *pMaps = (corrMaps_t *)calloc(1, sizeof(corrMaps_t));
+  
+  if (!pMaps) {
+    return NULL;
+  }
+  pMaps->pDark = (epicsUInt16 *)calloc(numPixels, sizeof(epicsUInt16));
+  pMaps->pGain = (epicsUInt16 *)malloc(numPixels * sizeof(epicsUInt16));
+  if (!pMaps->pDark || !pMaps->pGain) {
+    free(pMaps->pDark);
+    free(pMaps->pGain);
+    free(pMaps);
+    return NULL;
+  }
+  for (index=0; index<numPixels; index++) {
+    pMaps->pGain[index] = CORR_GAIN_ONE;
+  }
+  pMaps->refCount = 1;
+  pMaps->x = x;
+  pMaps->y = y;
+  pMaps->width = width;
+  pMaps->height = height;
+  pMaps->dataType = dataType;
+  return pMaps;
+}
+
+
+/* Drops a reference to the maps and frees them with the last one. Called 
+   with corrMutex held. */
+static void releaseCorrMaps(corrMaps_t *pMaps) {
+  if (pMaps && (--pMaps->refCount == 0)) {
+    free(pMaps->pDark);
+    free(pMaps->pGain);
+    free(pMaps);
+  }
+}
+
+
+/* Returns the shared entry of the camera at cameraId, creating it for the 
+   first port. Called with cameraListLock held. */
+static photronDevice_t *findDevice(const char *cameraId) {
+  photronDevice_t *pDevice;
+  
+  if (!deviceList) {
+    deviceList = new ELLLIST;
+    ellInit(deviceList);
+  }
+  pDevice = (photronDevice_t *)ellFirst(deviceList);
+  while (pDevice) {
+    if (strcmp(pDevice->cameraId, cameraId) == 0) {
+      return pDevice;
+    }
+    pDevice = (photronDevice_t *)ellNext(&pDevice->node);
+  }
+  pDevice = new photronDevice_t;
+  pDevice->cameraId = epicsStrDup(cameraId);
+  pDevice->sdkLock = epicsMutexMustCreate();
+  pDevice->linkLock = epicsMutexMustCreate();
+  pDevice->numReading = 0;
+  ellAdd(deviceList, &pDevice->node);
+  return pDevice;
+}
 
 
 /** Constructor for Photron; most parameters are simply passed to ADDriver::ADDriver.
@@ -54,11 +182,18 @@ static ELLLIST *cameraList;
   *            allowed to allocate. Set this to -1 to allow an unlimited amount of memory.
   * \param[in] priority The thread priority for the asyn port driver thread if ASYN_CANBLOCK is set in asynFlags.
   * \param[in] stackSize The stack size for the asyn port driver thread if ASYN_CANBLOCK is set in asynFlags.
+  * \param[in] childNo The head of a multi-head camera read by this port, starting from 1. Ports with the
+  *            same ipAddress share the camera and take turns on its link, one frame at a time.
+  * \param[in] linkIpAddress The address of the camera's second gigabit interface, or an empty string.
+  *            When it is given, PhotronStripedReadout downloads alternate frames over both interfaces.
   */
 Photron::Photron(const char *portName, const char *ipAddress, int autoDetect,
-                 int maxBuffers, size_t maxMemory, int priority, int stackSize)
+                 int maxBuffers, size_t maxMemory, int priority, int stackSize,
+                 int childNo, const char *linkIpAddress)
     : ADDriver(portName, 1, NUM_PHOTRON_PARAMS, maxBuffers, maxMemory,
-               asynEnumMask, asynEnumMask, /* asynEnum interface for dynamic mbbi/o */
+               /* asynEnum interface for dynamic mbbi/o, arrays for the index */
+               asynEnumMask | asynInt32ArrayMask | asynFloat64ArrayMask,
+               asynEnumMask | asynInt32ArrayMask | asynFloat64ArrayMask,
                0, 0, /* ASYN_CANBLOCK=0, ASYN_MULTIDEVICE=0, autoConnect=1 */
                priority, stackSize),
       pRaw(NULL) {
@@ -70,16 +205,33 @@ Photron::Photron(const char *portName, const char *ipAddress, int autoDetect,
  
   this->cameraId = epicsStrDup(ipAddress);
   this->autoDetect = autoDetect;
+  this->childNo = (childNo < 1) ? 1 : childNo;
+  this->deviceOpen = 0;
+  if (linkIpAddress && (strlen(linkIpAddress) > 0)) {
+    this->linkCameraId = epicsStrDup(linkIpAddress);
+  } else {
+    this->linkCameraId = NULL;
+  }
+  this->linkOpen = 0;
+  this->readingMemory = 0;
+  this->recordWait = 0;
   // Initialize the bitDepth for asynReport in case the feature isn't supported
   this->bitDepth = 0;
 
   // If this is the first camera we need to initialize the camera list
+  // Ports that share a multi-head camera look each other up in the list
+  if (!cameraListLock) {
+    cameraListLock = epicsMutexMustCreate();
+  }
+  epicsMutexMustLock(cameraListLock);
   if (!cameraList) {
     cameraList = new ELLLIST;
     ellInit(cameraList);
   }
   pNode->pCamera = this;
   ellAdd(cameraList, (ELLNODE *)pNode);
+  this->pDevice = findDevice(this->cameraId);
+  epicsMutexUnlock(cameraListLock);
 
   // CREATE PARAMS HERE
   createParam(PhotronStatusString,        asynParamInt32, &PhotronStatus);
@@ -163,6 +315,73 @@ Photron::Photron(const char *portName, const char *ipAddress, int autoDetect,
   createParam(PhotronExtOut4SigString,    asynParamInt32, &PhotronExtOut4Sig);
   createParam(PhotronShadingModeString,   asynParamInt32, &PhotronShadingMode);
   createParam(PhotronBurstTransString,    asynParamInt32, &PhotronBurstTrans);
+  createParam(PhotronReadoutRateString,   asynParamFloat64, &PhotronReadoutRate);
+  createParam(PhotronReadoutBandwidthString, asynParamFloat64, &PhotronReadoutBandwidth);
+  createParam(PhotronReadoutDepthString,  asynParamInt32, &PhotronReadoutDepth);
+  createParam(PhotronReadoutOccupancyString, asynParamInt32, &PhotronReadoutOccupancy);
+  createParam(PhotronTransferBufAllocsString, asynParamInt32, &PhotronTransferBufAllocs);
+  createParam(PhotronTransferBufSizeString, asynParamInt32, &PhotronTransferBufSize);
+  createParam(PhotronRefreshCallsString, asynParamInt32, &PhotronRefreshCalls);
+  createParam(PhotronPollRateString, asynParamFloat64, &PhotronPollRate);
+  createParam(PhotronTransLatencyString, asynParamFloat64, &PhotronTransLatency);
+  createParam(PhotronRawEnableString, asynParamInt32, &PhotronRawEnable);
+  createParam(PhotronRawFileString, asynParamOctet, &PhotronRawFile);
+  createParam(PhotronRawDirectIOString, asynParamInt32, &PhotronRawDirectIO);
+  createParam(PhotronRawWriteRateString, asynParamFloat64, &PhotronRawWriteRate);
+  createParam(PhotronStripedReadoutString, asynParamInt32, &PhotronStripedReadout);
+  createParam(PhotronLinkConnectedString, asynParamInt32, &PhotronLinkConnected);
+  createParam(PhotronCheckpointFileString, asynParamOctet, &PhotronCheckpointFile);
+  createParam(PhotronResumeReadoutString, asynParamInt32, &PhotronResumeReadout);
+  createParam(PhotronResumeFrameString, asynParamInt32, &PhotronResumeFrame);
+  createParam(PhotronResumeValidString, asynParamInt32, &PhotronResumeValid);
+  createParam(PhotronReadoutStrideString, asynParamInt32, &PhotronReadoutStride);
+  createParam(PhotronReadoutRangesString, asynParamOctet, &PhotronReadoutRanges);
+  createParam(PhotronReadoutFramesString, asynParamInt32, &PhotronReadoutFrames);
+  createParam(PhotronEventReadoutString, asynParamInt32, &PhotronEventReadout);
+  createParam(PhotronEventPreFramesString, asynParamInt32, &PhotronEventPreFrames);
+  createParam(PhotronEventPostFramesString, asynParamInt32, &PhotronEventPostFrames);
+  createParam(PhotronEventCountString, asynParamInt32, &PhotronEventCount);
+  createParam(PhotronReadoutMinXString, asynParamInt32, &PhotronReadoutMinX);
+  createParam(PhotronReadoutMinYString, asynParamInt32, &PhotronReadoutMinY);
+  createParam(PhotronReadoutSizeXString, asynParamInt32, &PhotronReadoutSizeX);
+  createParam(PhotronReadoutSizeYString, asynParamInt32, &PhotronReadoutSizeY);
+  createParam(PhotronReadoutFormatString, asynParamInt32, &PhotronReadoutFormat);
+  createParam(PhotronReadoutShiftString, asynParamInt32, &PhotronReadoutShift);
+  createParam(PhotronCorrEnableString, asynParamInt32, &PhotronCorrEnable);
+  createParam(PhotronCorrCaptureDarkString, asynParamInt32, &PhotronCorrCaptureDark);
+  createParam(PhotronCorrCaptureFlatString, asynParamInt32, &PhotronCorrCaptureFlat);
+  createParam(PhotronCorrFramesString, asynParamInt32, &PhotronCorrFrames);
+  createParam(PhotronCorrDarkValidString, asynParamInt32, &PhotronCorrDarkValid);
+  createParam(PhotronCorrFlatValidString, asynParamInt32, &PhotronCorrFlatValid);
+  createParam(PhotronCorrThreadsString, asynParamInt32, &PhotronCorrThreads);
+  createParam(PhotronCorrFileString, asynParamOctet, &PhotronCorrFile);
+  createParam(PhotronCorrTimeString, asynParamFloat64, &PhotronCorrTime);
+  createParam(PhotronReadoutWorkersString, asynParamInt32, &PhotronReadoutWorkers);
+  createParam(PhotronAttrSnapshotString, asynParamInt32, &PhotronAttrSnapshot);
+  createParam(PhotronPreviewCacheSizeString, asynParamInt32, &PhotronPreviewCacheSize);
+  createParam(PhotronPreviewReadAheadString, asynParamInt32, &PhotronPreviewReadAhead);
+  createParam(PhotronPreviewCachedString, asynParamInt32, &PhotronPreviewCached);
+  createParam(PhotronPreviewHitRateString, asynParamFloat64, &PhotronPreviewHitRate);
+  createParam(PhotronIndexEnableString, asynParamInt32, &PhotronIndexEnable);
+  createParam(PhotronIndexStrideString, asynParamInt32, &PhotronIndexStride);
+  createParam(PhotronIndexBinString, asynParamInt32, &PhotronIndexBin);
+  createParam(PhotronIndexBusyString, asynParamInt32, &PhotronIndexBusy);
+  createParam(PhotronIndexPointsString, asynParamInt32, &PhotronIndexPoints);
+  createParam(PhotronIndexFramesString, asynParamInt32Array, &PhotronIndexFrames);
+  createParam(PhotronIndexMeanString, asynParamFloat64Array, &PhotronIndexMean);
+  createParam(PhotronIndexThumbFrameString, asynParamInt32, &PhotronIndexThumbFrame);
+  createParam(PhotronIndexThumbString, asynParamInt32Array, &PhotronIndexThumb);
+  createParam(PhotronIndexThumbWidthString, asynParamInt32, &PhotronIndexThumbWidth);
+  createParam(PhotronIndexThumbHeightString, asynParamInt32, &PhotronIndexThumbHeight);
+  createParam(PhotronPMPlayDepthString, asynParamInt32, &PhotronPMPlayDepth);
+  createParam(PhotronPMPlayRateString, asynParamFloat64, &PhotronPMPlayRate);
+  createParam(PhotronPMPlayDroppedString, asynParamInt32, &PhotronPMPlayDropped);
+  createParam(PhotronLiveDeliveryString, asynParamInt32, &PhotronLiveDelivery);
+  createParam(PhotronLiveGrabbedString, asynParamInt32, &PhotronLiveGrabbed);
+  createParam(PhotronLivePublishedString, asynParamInt32, &PhotronLivePublished);
+  createParam(PhotronLiveDroppedString, asynParamInt32, &PhotronLiveDropped);
+  createParam(PhotronLiveBinString, asynParamInt32, &PhotronLiveBin);
+  createParam(PhotronLiveBinModeString, asynParamInt32, &PhotronLiveBinMode);
   
   PhotronExtInSig[0] = &PhotronExtIn1Sig;
   PhotronExtInSig[1] = &PhotronExtIn2Sig;
@@ -187,6 +406,162 @@ Photron::Photron(const char *portName, const char *ipAddress, int autoDetect,
   
   this->abortFlag = 0;
   this->forceWait = 0;
+  setIntegerParam(PhotronReadoutDepth, 4);
+  setIntegerParam(PhotronReadoutOccupancy, 0);
+  
+  // The transfer buffers are allocated once the geometry is known
+  for (int index=0; index<NUM_TRANSFER_BUFFERS; index++) {
+    this->transferBuf[index] = NULL;
+  }
+  this->transferBufSize = 0;
+  this->transferBufAllocs = 0;
+  this->irigTable = NULL;
+  this->irigTableFirst = 0;
+  this->irigTableSize = 0;
+  this->irigStride = 1;
+  this->numReadoutRanges = 0;
+  this->roiEnable = 0;
+  this->readoutFormat = READOUT_FORMAT_NATIVE;
+  this->readoutShift = 0;
+  this->memWidth = 0;
+  this->memHeight = 0;
+  setIntegerParam(PhotronTransferBufAllocs, 0);
+  setIntegerParam(PhotronTransferBufSize, 0);
+  setIntegerParam(PhotronRefreshCalls, 0);
+  setDoubleParam(PhotronPollRate, 0.0);
+  setDoubleParam(PhotronTransLatency, 0.0);
+  setIntegerParam(PhotronRawEnable, 0);
+  setStringParam(PhotronRawFile, "");
+  setIntegerParam(PhotronRawDirectIO, 0);
+  setDoubleParam(PhotronRawWriteRate, 0.0);
+  setIntegerParam(PhotronStripedReadout, 0);
+  setIntegerParam(PhotronLinkConnected, 0);
+  setStringParam(PhotronCheckpointFile, "");
+  setIntegerParam(PhotronResumeReadout, 0);
+  setIntegerParam(PhotronResumeFrame, 0);
+  setIntegerParam(PhotronResumeValid, 0);
+  setIntegerParam(PhotronReadoutStride, 1);
+  setStringParam(PhotronReadoutRanges, "");
+  setIntegerParam(PhotronReadoutFrames, 0);
+  setIntegerParam(PhotronEventReadout, 0);
+  setIntegerParam(PhotronEventPreFrames, 10);
+  setIntegerParam(PhotronEventPostFrames, 10);
+  setIntegerParam(PhotronEventCount, 0);
+  setIntegerParam(PhotronReadoutMinX, 0);
+  setIntegerParam(PhotronReadoutMinY, 0);
+  setIntegerParam(PhotronReadoutSizeX, 0);
+  setIntegerParam(PhotronReadoutSizeY, 0);
+  setIntegerParam(PhotronReadoutFormat, READOUT_FORMAT_NATIVE);
+  setIntegerParam(PhotronReadoutShift, 4);
+  this->corrMutex = epicsMutexMustCreate();
+  this->corrMaps = NULL;
+  this->corrDarkValid = 0;
+  this->corrFlatValid = 0;
+  this->corrEnable = 0;
+  this->corrThreads = epicsThreadGetCPUs();
+  if (this->corrThreads > MAX_CORR_THREADS) {
+    this->corrThreads = MAX_CORR_THREADS;
+  } else if (this->corrThreads < 1) {
+    this->corrThreads = 1;
+  }
+  this->corrWarned = 0;
+  this->corrFile[0] = 0;
+  this->corrSum = NULL;
+  this->corrCapture = 0;
+  this->corrCaptureFrames = 16;
+  this->corrCaptureCount = 0;
+  // Room for a frame's bands from each readout worker and the live path
+  this->corrQueueId = epicsMessageQueueCreate(
+      MAX_CORR_THREADS * (MAX_READOUT_WORKERS + 1), sizeof(corrBand_t *));
+  this->numCorrWorkers = 0;
+  setIntegerParam(PhotronCorrEnable, 0);
+  setIntegerParam(PhotronCorrCaptureDark, 0);
+  setIntegerParam(PhotronCorrCaptureFlat, 0);
+  setIntegerParam(PhotronCorrFrames, this->corrCaptureFrames);
+  setIntegerParam(PhotronCorrDarkValid, 0);
+  setIntegerParam(PhotronCorrFlatValid, 0);
+  setIntegerParam(PhotronCorrThreads, this->corrThreads);
+  setStringParam(PhotronCorrFile, "");
+  setDoubleParam(PhotronCorrTime, 0.0);
+  setIntegerParam(PhotronReadoutWorkers, 2);
+  setIntegerParam(PhotronAttrSnapshot, 1);
+  this->readoutAttributes = new NDAttributeList;
+  this->attrSnapshot = 0;
+  setIntegerParam(PhotronPreviewCacheSize, 16);
+  setIntegerParam(PhotronPreviewReadAhead, 4);
+  setIntegerParam(PhotronPreviewCached, 0);
+  setDoubleParam(PhotronPreviewHitRate, 0.0);
+  memset(this->previewCache, 0, sizeof(this->previewCache));
+  this->previewUseCount = 0;
+  this->previewGeneration = 0;
+  this->previewLastIndex = -1;
+  this->previewDirection = 1;
+  this->previewFetching = -1;
+  this->previewLookups = 0.0;
+  this->previewHits = 0.0;
+  setIntegerParam(PhotronIndexEnable, 1);
+  setIntegerParam(PhotronIndexStride, 100);
+  setIntegerParam(PhotronIndexBin, 8);
+  setIntegerParam(PhotronIndexBusy, 0);
+  setIntegerParam(PhotronIndexPoints, 0);
+  setIntegerParam(PhotronIndexThumbFrame, 0);
+  setIntegerParam(PhotronIndexThumbWidth, 0);
+  setIntegerParam(PhotronIndexThumbHeight, 0);
+  this->indexGeneration = 0;
+  this->indexCount = 0;
+  this->indexThumbs = NULL;
+  this->indexThumbBuf = NULL;
+  this->indexThumbWidth = 0;
+  this->indexThumbHeight = 0;
+  setIntegerParam(PhotronPMPlayDepth, 4);
+  setDoubleParam(PhotronPMPlayRate, 0.0);
+  setIntegerParam(PhotronPMPlayDropped, 0);
+  setIntegerParam(PhotronLiveDelivery, 0);
+  setIntegerParam(PhotronLiveGrabbed, 0);
+  setIntegerParam(PhotronLivePublished, 0);
+  setIntegerParam(PhotronLiveDropped, 0);
+  setIntegerParam(PhotronLiveBin, 1);
+  setIntegerParam(PhotronLiveBinMode, 0);
+  this->liveLatest = NULL;
+  this->liveGrabbing = 0;
+  this->liveStatus = asynSuccess;
+  this->liveGrabbed = 0;
+  this->livePublished = 0;
+  this->liveDropped = 0;
+  this->rawIndexFile = NULL;
+  this->rawNumBuffers = 0;
+  this->checkpointFile[0] = 0;
+  epicsTimeGetCurrent(&this->checkpointTime);
+  this->resumeFlag = 0;
+  this->recPollPeriod = PHOTRON_POLL_MIN;
+  
+  /* Create the SDK command queues */
+  this->sdkThreadId = NULL;
+  for (int priority=0; priority<NUM_SDK_PRIORITIES; priority++) {
+    this->sdkQueueId[priority] = epicsMessageQueueCreate(SDK_QUEUE_SIZE,
+                                                         sizeof(sdkCommand_t *));
+    if (!this->sdkQueueId[priority]) {
+      printf("%s:%s epicsMessageQueueCreate failure for SDK queue\n",
+             driverName, functionName);
+      return;
+    }
+  }
+  
+  this->sdkWakeEventId = epicsEventCreate(epicsEventEmpty);
+  if (!this->sdkWakeEventId) {
+    printf("%s:%s epicsEventCreate failure for SDK wake event\n",
+           driverName, functionName);
+    return;
+  }
+  
+  this->linkThreadId = NULL;
+  this->linkQueueId = epicsMessageQueueCreate(SDK_QUEUE_SIZE, 
+                                              sizeof(sdkCommand_t *));
+  if (!this->linkQueueId) {
+    printf("%s:%s epicsMessageQueueCreate failure for link queue\n",
+           driverName, functionName);
+    return;
+  }
   
   /* Create the epicsEvents for signaling to the acquisition task when 
      acquisition starts and stops */
@@ -255,9 +630,92 @@ Photron::Photron(const char *portName, const char *ipAddress, int autoDetect,
     return;
   }
   
+  // Create the first processing worker and the events used between the
+  // memory transfer and publish stages of a readout. The publish stage waits
+  // on the first worker between readouts; readImageRange starts the others.
+  this->numReadoutWorkers = 0;
+  this->activeReadoutWorkers = 1;
+  this->readoutInFlight = 0;
+  if (startReadoutWorker() != asynSuccess) {
+    return;
+  }
+  
+  this->readoutSpaceEventId = epicsEventCreate(epicsEventEmpty);
+  if (!this->readoutSpaceEventId) {
+    printf("%s:%s epicsEventCreate failure for readout space event\n",
+           driverName, functionName);
+    return;
+  }
+  
+  this->readoutDoneEventId = epicsEventCreate(epicsEventEmpty);
+  if (!this->readoutDoneEventId) {
+    printf("%s:%s epicsEventCreate failure for readout done event\n",
+           driverName, functionName);
+    return;
+  }
+  
+  this->previewEventId = epicsEventCreate(epicsEventEmpty);
+  if (!this->previewEventId) {
+    printf("%s:%s epicsEventCreate failure for preview event\n",
+           driverName, functionName);
+    return;
+  }
+  
+  this->previewDoneEventId = epicsEventCreate(epicsEventEmpty);
+  if (!this->previewDoneEventId) {
+    printf("%s:%s epicsEventCreate failure for preview done event\n",
+           driverName, functionName);
+    return;
+  }
+  
+  this->grabStartEventId = epicsEventCreate(epicsEventEmpty);
+  if (!this->grabStartEventId) {
+    printf("%s:%s epicsEventCreate failure for grab start event\n",
+           driverName, functionName);
+    return;
+  }
+  
+  this->liveFrameEventId = epicsEventCreate(epicsEventEmpty);
+  if (!this->liveFrameEventId) {
+    printf("%s:%s epicsEventCreate failure for live frame event\n",
+           driverName, functionName);
+    return;
+  }
+  
+  this->indexEventId = epicsEventCreate(epicsEventEmpty);
+  if (!this->indexEventId) {
+    printf("%s:%s epicsEventCreate failure for index event\n",
+           driverName, functionName);
+    return;
+  }
+  
   /* Register the shutdown function for epicsAtExit */
   epicsAtExit(shutdown, (void*)this);
 
+  /* Create the thread that makes all of the SDK calls */
+  this->sdkThreadId = epicsThreadCreate("PhotronSDKTask", 
+                epicsThreadPriorityMedium,
+                epicsThreadGetStackSize(epicsThreadStackMedium),
+                (EPICSTHREADFUNC)PhotronSDKTaskC, this);
+  if (!this->sdkThreadId) {
+    printf("%s:%s epicsThreadCreate failure for SDK task\n",
+           driverName, functionName);
+    return;
+  }
+  
+  /* Create the thread that transfers frames over the second interface */
+  if (this->linkCameraId) {
+    this->linkThreadId = epicsThreadCreate("PhotronLinkTask", 
+                  epicsThreadPriorityMedium,
+                  epicsThreadGetStackSize(epicsThreadStackMedium),
+                  (EPICSTHREADFUNC)PhotronLinkTaskC, this);
+    if (!this->linkThreadId) {
+      printf("%s:%s epicsThreadCreate failure for link task\n",
+             driverName, functionName);
+      return;
+    }
+  }
+  
   /* Create the thread that updates the images */
   status = (epicsThreadCreate("PhotronTask", epicsThreadPriorityMedium,
                 epicsThreadGetStackSize(epicsThreadStackMedium),
@@ -268,6 +726,16 @@ Photron::Photron(const char *portName, const char *ipAddress, int autoDetect,
     return;
   }
   
+  /* Create the thread that grabs live frames for latest-frame delivery */
+  status = (epicsThreadCreate("PhotronGrabTask", epicsThreadPriorityMedium,
+                epicsThreadGetStackSize(epicsThreadStackMedium),
+                (EPICSTHREADFUNC)PhotronGrabTaskC, this) == NULL);
+  if (status) {
+    printf("%s:%s epicsThreadCreate failure for grab task\n",
+           driverName, functionName);
+    return;
+  }
+  
   /* Create the thread that polls status while saving shading data */
   status = (epicsThreadCreate("PhotronWaitTask", epicsThreadPriorityMedium,
                 epicsThreadGetStackSize(epicsThreadStackMedium),
@@ -298,11 +766,41 @@ Photron::Photron(const char *portName, const char *ipAddress, int autoDetect,
     return;
   }
   
+  /* Create the thread that posts frames read from memory to the plugins */
+  status = (epicsThreadCreate("PhotronPublishTask", epicsThreadPriorityMedium,
+                epicsThreadGetStackSize(epicsThreadStackMedium),
+                (EPICSTHREADFUNC)PhotronPublishTaskC, this) == NULL);
+  if (status) {
+    printf("%s:%s epicsThreadCreate failure for publish task\n",
+           driverName, functionName);
+    return;
+  }
+  
+  /* Create the thread that reads preview frames ahead of the index */
+  status = (epicsThreadCreate("PhotronPreviewTask", epicsThreadPriorityMedium,
+                epicsThreadGetStackSize(epicsThreadStackMedium),
+                (EPICSTHREADFUNC)PhotronPreviewTaskC, this) == NULL);
+  if (status) {
+    printf("%s:%s epicsThreadCreate failure for preview task\n",
+           driverName, functionName);
+    return;
+  }
+  
+  /* Create the thread that builds the thumbnail index of a recording */
+  status = (epicsThreadCreate("PhotronIndexTask", epicsThreadPriorityLow,
+                epicsThreadGetStackSize(epicsThreadStackMedium),
+                (EPICSTHREADFUNC)PhotronIndexTaskC, this) == NULL);
+  if (status) {
+    printf("%s:%s epicsThreadCreate failure for index task\n",
+           driverName, functionName);
+    return;
+  }
+  
   /* Try to connect to the camera.  
    * It is not a fatal error if we cannot now, the camera may be off or owned by
    * someone else. It may connect later. */
   this->lock();
-  status = connectCamera();
+  status = sdkCall(&Photron::connectCamera, SDK_PRIORITY_NORMAL);
   this->unlock();
   if (status) {
     printf("%s:%s: cannot connect to camera %s, manually connect later\n", 
@@ -317,7 +815,7 @@ Photron::Photron(const char *portName, const char *ipAddress, int autoDetect,
 
 
 Photron::~Photron() {
-  cameraNode *pNode = (cameraNode *)ellFirst(cameraList);
+  cameraNode *pNode;
   static const char *functionName = "~Photron";
 
   // Attempt to stop the recording thread
@@ -326,10 +824,12 @@ Photron::~Photron() {
   
   this->lock();
   printf("Disconnecting camera %s\n", this->portName);
-  disconnectCamera();
+  sdkCall(&Photron::disconnectCamera, SDK_PRIORITY_NORMAL);
   this->unlock();
 
   // Find this camera in the list:
+  epicsMutexMustLock(cameraListLock);
+  pNode = (cameraNode *)ellFirst(cameraList);
   while (pNode) {
     if (pNode->pCamera == this)
       break;
@@ -344,7 +844,19 @@ Photron::~Photron() {
      uninitialize */
   if (ellCount(cameraList) == 0) {
     delete cameraList;
+    cameraList = NULL;
+  }
+  epicsMutexUnlock(cameraListLock);
+  
+  for (int index=0; index<NUM_TRANSFER_BUFFERS; index++) {
+    transferBufFree(this->transferBuf[index]);
   }
+  free(this->irigTable);
+  releaseCorrMaps(this->corrMaps);
+  free(this->corrSum);
+  free(this->indexThumbs);
+  free(this->indexThumbBuf);
+  delete this->readoutAttributes;
 }
 
 
@@ -365,16 +877,61 @@ static void PhotronPlayTaskC(void *drvPvt) {
   pPvt->PhotronPlayTask();
 }
 
+/** Returns the frame playback shows after index, stepping PMPlayMult frames
+  * in the play direction and wrapping around with PMRepeat, or -1 when 
+  * playback stops after index. Must be called with the port lock held.
+  */
+int Photron::nextPlayFrame(int index, int start, int end) {
+  epicsInt32 repeat, multiplier;
+  int nextIndex;
+  
+  // Allow repeat and multiplier to be changed during playback
+  getIntegerParam(PhotronPMRepeat, &repeat);
+  getIntegerParam(PhotronPMPlayMult, &multiplier);
+  
+  if (this->dirFlag == 1) {
+    // forward direction
+    if (index == end) {
+      nextIndex = (repeat == 1) ? start : -1;
+    } else {
+      nextIndex = index + multiplier;
+      if (nextIndex > end) {
+        nextIndex = end;
+      }
+    }
+  } else {
+    // reverse direction
+    if (index == start) {
+      nextIndex = (repeat == 1) ? end : -1;
+    } else {
+      nextIndex = index - multiplier;
+      if (nextIndex < start) {
+        nextIndex = start;
+      }
+    }
+  }
+  return nextIndex;
+}
+
+
 /** This thread retrieves the image data efficiently when play is pressed in
-  * playback mode.
+  * playback mode. Up to PMPlayDepth frames are queued to the SDK thread 
+  * ahead of the frame being shown, so a slow transfer doesn't hold up the
+  * display. Each frame is due one period of PMPlayFPS after the previous 
+  * one on the monotonic clock. A frame that is more than a period late is
+  * dropped if the next one is already transferred, which keeps playback in
+  * time when the plugins fall behind or a transfer stalls. When the 
+  * transfers themselves are slower than PMPlayFPS, every frame is shown 
+  * as it arrives. A frame whose transfer fails is dropped as well.
+  * PMPlayRate is the achieved rate and PMPlayDropped counts the frames 
+  * dropped since play was pressed.
   */
 void Photron::PhotronPlayTask() {
   //unsigned long status;
-  unsigned long nRet;
-  unsigned long nErrorCode;
-  epicsInt32 phostat, start, end, repeat, current;
-  epicsInt32 fps, multiplier;
+  epicsInt32 phostat, start, end, current;
+  epicsInt32 fps, depth;
   int index, nextIndex, stop;
+  int head, count, slot, dropped, published;
   //
   int transferBitDepth;
   PDC_IRIG_INFO tData;
@@ -382,21 +939,18 @@ void Photron::PhotronPlayTask() {
   NDArray *pImage;
   NDArrayInfo_t arrayInfo;
   int colorMode = NDColorModeMono;
-  //
-  void *pBuf;  /* Memory sequence pointer for storing a live image */
+  playFrame_t *pFrame;
   //
   NDDataType_t dataType;
   int pixelSize;
   size_t dims[2];
-  size_t dataSize;
   //
   int imageCounter;
   int numImagesCounter;
   int arrayCallbacks;
   double updatePeriod, delay;
-  double elapsedTime;
+  double now, due, rateStart;
   double tRel, tStart, tNow;
-  epicsTimeStamp startTime, endTime;
   //
   const char *functionName = "PhotronPlayTask";
   
@@ -437,8 +991,6 @@ void Photron::PhotronPlayTask() {
       
       //
       transferBitDepth = 8 * pixelSize;
-      dataSize = this->memWidth * this->memHeight * pixelSize;
-      pBuf = malloc(dataSize);
       
       // Start with the current start frame. If we're at the end, restart from
       // the beginning.
@@ -450,34 +1002,106 @@ void Photron::PhotronPlayTask() {
         index = current;
       }
       
-      // Preload the first frame
-      nRet = PDC_GetMemImageDataStart(this->nDeviceNo, this->nChildNo, index,
-                                      transferBitDepth, pBuf, &nErrorCode);
-      if (nRet == PDC_FAILED) {
-        printf("PDC_GetMemImageDataStart Error %d; index = %d\n", nErrorCode, index);
-      }
-      
-      epicsTimeGetCurrent(&startTime);
+      nextIndex = index;
+      head = 0;
+      count = 0;
+      dropped = 0;
+      published = 0;
+      setIntegerParam(PhotronPMPlayDropped, 0);
+      setDoubleParam(PhotronPMPlayRate, 0.0);
+      due = epicsMonotonicGet() / 1.e9;
+      rateStart = due;
       
       while (1) {
-        // Acquire the image data
-        nRet = PDC_GetMemImageDataEnd(this->nDeviceNo, this->nChildNo,
-                                        transferBitDepth, pBuf, &nErrorCode);
-        if (nRet == PDC_FAILED) {
-          printf("PDC_GetMemImageDataEnd Error %d\n", nErrorCode);
+        // Queue frames until PMPlayDepth are in flight. The SDK transfers 
+        // each frame directly into the NDArray that is passed to the plugins.
+        getIntegerParam(PhotronPMPlayDepth, &depth);
+        while ((count < depth) && (nextIndex >= 0) && !this->stopFlag) {
+          slot = (head + count) % MAX_PLAY_DEPTH;
+          pFrame = &(this->playRing[slot]);
+          pFrame->pImage = this->pNDArrayPool->alloc(2, dims, dataType, 0, 
+                                                     NULL);
+          if (!pFrame->pImage) {
+            asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                      "%s:%s: error allocating buffer\n", driverName, 
+                      functionName);
+            break;
+          }
+          pFrame->index = nextIndex;
+          pFrame->cmd.type = SDK_CMD_MEM_IMAGE;
+          pFrame->cmd.arg = nextIndex;
+          pFrame->cmd.bitDepth = transferBitDepth;
+          pFrame->cmd.pData = pFrame->pImage->pData;
+          pFrame->cmd.pIRIG = (this->tMode == 1) ? &(pFrame->tData) : NULL;
+          pFrame->cmd.roiWidth = 0;
+          pFrame->cmd.format = READOUT_FORMAT_NATIVE;
+          this->sdkSubmit(&(pFrame->cmd), SDK_PRIORITY_NORMAL, 0);
+          count++;
+          nextIndex = nextPlayFrame(nextIndex, start, end);
+        }
+        if (count == 0) {
+          // Nothing was queued; the buffers ran out
+          break;
+        }
+        
+        // Acquire the image data and frame time without holding the port lock
+        pFrame = &(this->playRing[head]);
+        this->unlock();
+        this->sdkWait(&(pFrame->cmd));
+        this->lock();
+        head = (head + 1) % MAX_PLAY_DEPTH;
+        count--;
+        pImage = pFrame->pImage;
+        index = pFrame->index;
+        tData = pFrame->tData;
+        
+        // Check to see if the user requested playback to stop
+        stop = (this->stopFlag == 1) || 
+               ((count == 0) && (nextIndex < 0));
+        
+        if (pFrame->cmd.status != asynSuccess) {
+          // The transfer failed; the buffer doesn't hold the frame
+          asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                    "%s:%s: error reading memory frame %d\n", driverName, 
+                    functionName, index);
+          pImage->release();
+          dropped++;
+          setIntegerParam(PhotronPMPlayDropped, dropped);
+          if (stop) break;
+          continue;
+        }
+        
+        // Allow the speed to be changed during playback
+        getIntegerParam(PhotronPMPlayFPS, &fps);
+        updatePeriod = 1.0 / fps;
+        
+        now = epicsMonotonicGet() / 1.e9;
+        if (!stop && (count > 0) && (now > due + updatePeriod) && 
+            sdkDone(&(this->playRing[head].cmd))) {
+          // Behind time with the next frame ready; skip this one
+          pImage->release();
+          dropped++;
+          setIntegerParam(PhotronPMPlayDropped, dropped);
+          due += updatePeriod;
+          continue;
         }
+        if (now > due + updatePeriod) {
+          // The transfers can't keep up; show frames as they arrive
+          due = now;
+        }
+        
+        // delay if possible and necessary
+        delay = due - now;
+        if ((delay > 0) && !stop) {
+          this->unlock();
+          epicsEventWaitWithTimeout(this->stopPlayEventId, delay);
+          this->lock();
+        }
+        due += updatePeriod;
         
         setIntegerParam(PhotronPMIndex, index);
         
-        // Retrieve frame time
         if (this->tMode == 1) {
-          //
-          nRet = PDC_GetMemIRIGData(this->nDeviceNo, this->nChildNo, index,
-                                    &tData, &nErrorCode);
-          if (nRet == PDC_FAILED) {
-            printf("PDC_GetMemIRIGData Error %d\n", nErrorCode);
-          }
-          
           setIntegerParam(PhotronMemIRIGDay, tData.m_nDayOfYear);
           setIntegerParam(PhotronMemIRIGHour, tData.m_nHour);
           setIntegerParam(PhotronMemIRIGMin, tData.m_nMinute);
@@ -494,92 +1118,17 @@ void Photron::PhotronPlayTask() {
          * function. Now release it before getting a new version. */
         if (this->pArrays[0]) 
           this->pArrays[0]->release();
-  
-        /* Allocate the raw buffer */
-        pImage = this->pNDArrayPool->alloc(2, dims, dataType, 0, NULL);
-        if (!pImage) {
-          asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
-                    "%s:%s: error allocating buffer\n", driverName, functionName);
-        }
-        
-        //
-        memcpy(pImage->pData, pBuf, dataSize);
-        
-        // Allow repeat and multiplier to be changed during playback
-        getIntegerParam(PhotronPMRepeat, &repeat);
-        getIntegerParam(PhotronPMPlayMult, &multiplier);
-        
-        // Determine if another frame should start preloading based on index
-        if (this->dirFlag == 1) {
-          // forward direction
-          if (index == end) {
-            if (repeat == 1) {
-              printf("It is time to REPEAT\n");
-              printf("\tindex=%d, start=%d, end=%d\n", index, start, end);
-              nextIndex = start;
-              stop = 0;
-            } else {
-              nextIndex = end;
-              stop = 1;
-            }
-          } else {
-            nextIndex = index + multiplier;
-            if (nextIndex > end) {
-              nextIndex = end;
-            }
-            stop = 0;
-          }
-        } else {
-          // reverse direction
-          if (index == start) {
-            if (repeat == 1) {
-              printf("It is time to REPEAT\n");
-              printf("\tindex=%d, start=%d, end=%d\n", index, start, end);
-              nextIndex = end;
-              stop = 0;
-            } else {
-              nextIndex = start;
-              stop = 1;
-            }
-          } else {
-            nextIndex = index - multiplier;
-            if (nextIndex < start) {
-              nextIndex = start;
-            }
-            stop = 0;
-          }
-        }
-        
-        // Allow the speed to be changed during playback
-        getIntegerParam(PhotronPMPlayFPS, &fps);
-        updatePeriod = 1.0 / fps;
         
-        // delay if possible and necessary
-        epicsTimeGetCurrent(&endTime);
-        elapsedTime = epicsTimeDiffInSeconds(&endTime, &startTime);
-        delay = updatePeriod - elapsedTime;
-        if (delay > 0) {
-          //printf("delay = %f\n", delay);
-          this->unlock();
-          epicsEventWaitWithTimeout(this->stopPlayEventId, delay);
-          this->lock();
+        // The achieved frame rate, updated about once a second
+        published++;
+        now = epicsMonotonicGet() / 1.e9;
+        if (now - rateStart >= 1.0) {
+          setDoubleParam(PhotronPMPlayRate, published / (now - rateStart));
+          published = 0;
+          rateStart = now;
         }
-        epicsTimeGetCurrent(&startTime);
         
-        // Check to see if the user requested playback to stop
-        if (this->stopFlag == 1) {
-          stop = 1;
-        }
-        
-        //
-        if (stop == 0) {
-          // Start preloading the next frame
-          nRet = PDC_GetMemImageDataStart(this->nDeviceNo, this->nChildNo, nextIndex,
-                                          transferBitDepth, pBuf, &nErrorCode);
-          if (nRet == PDC_FAILED) {
-            printf("PDC_GetMemImageDataStart Error %d; nextIndex = %d\n", nErrorCode, nextIndex);
-          }
-        } else {
+        if (stop == 1) {
           printf("Stopping after posting this last image to plugins\n");
         }
         
@@ -640,12 +1189,20 @@ void Photron::PhotronPlayTask() {
         if (stop == 1) {
           printf("Breaking\n");
           break;
-        } else {
-          index = nextIndex;
         }
       }
       
-      free(pBuf);
+      // Discard the frames still in flight
+      while (count > 0) {
+        pFrame = &(this->playRing[head]);
+        this->unlock();
+        this->sdkWait(&(pFrame->cmd));
+        this->lock();
+        pFrame->pImage->release();
+        head = (head + 1) % MAX_PLAY_DEPTH;
+        count--;
+      }
+      callParamCallbacks();
       
     } else {
       printf("Play was request but camera isn't in playback mode!\n");
@@ -654,81 +1211,658 @@ void Photron::PhotronPlayTask() {
 }
 
 
-static void PhotronWaitTaskC(void *drvPvt) {
+static void PhotronPublishTaskC(void *drvPvt) {
   Photron *pPvt = (Photron *)drvPvt;
-  pPvt->PhotronWaitTask();
+  pPvt->PhotronPublishTask();
 }
 
-/** Saving the shading data takes a long time. Spawn a task to poll the status
+/** Publish stage of the memory readout. This thread collects the frames from
+  * the processing workers in the order readImageRange dealt them out, sets 
+  * the counters and uniqueId, and does the plugin callbacks or writes the raw
+  * file, while the transfer stage keeps reading camera memory.
   */
-void Photron::PhotronWaitTask() {
-  unsigned long status = 0;
-  unsigned long nRet;
-  unsigned long nErrorCode;
-  int eStatus;
-  const char *functionName = "PhotronWaitTask";
+void Photron::PhotronPublishTask() {
+  readoutFrame_t frame;
+  NDArray *pImage;
+  NDArrayInfo_t arrayInfo;
+  int next = 0;
+  int committed;
+  //
+  int imageCounter;
+  int numImagesCounter;
+  int arrayCallbacks;
+  //
+  const char *functionName = "PhotronPublishTask";
   
-  this->lock();
   /* Loop forever */
   while (1) {
-    /* Wait for a semaphore that is given when shading data is being saved */
-    /* Release the lock while we wait for an event that says acquire has 
-       started, then lock again */
-    asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW,
-              "%s:%s: waiting for long operation to start\n", driverName, 
-              functionName);
-    this->unlock();
-    epicsEventWait(this->startWaitEventId);
+    // A readout deals frame n to worker n % activeReadoutWorkers, which it
+    // sets before the first frame, and each worker keeps them in order
+    epicsMessageQueueReceive(
+        this->readoutWorkers[next % this->activeReadoutWorkers].outQueueId, 
+        &frame, sizeof(frame));
+    next++;
+    
     this->lock();
+    // Record the frames committed so far
+    saveCheckpoint(0);
     
-    // Wait until long operaion (saving/loading) is done
-    while (1) {
-      printf("Waiting for long operation to be done...\n");
-      // Get camera status
-      nRet = PDC_GetStatus(this->nDeviceNo, &status, &nErrorCode);
-      if (nRet == PDC_FAILED) {
-        printf("PDC_GetStatus (#1) failed %d\n", nErrorCode);
-      }
-      setIntegerParam(PhotronStatus, status);
-      eStatus = statusToEPICS(status);
-      setIntegerParam(PhotronStatusName, eStatus);
+    if (!frame.pImage && !frame.pRaw) {
+      // The transfer stage is done and every frame has been published
+      next = 0;
       callParamCallbacks();
-      
-      if ((status == PDC_STATUS_SAVE) || (status == PDC_STATUS_LOAD)) {
-        // the state we've been waiting for has occurred
-        this->forceWait = 0;
-      }
-      
-      if ((status != PDC_STATUS_SAVE) && (status != PDC_STATUS_LOAD) && this->forceWait == 0) {
-        break;
+      this->unlock();
+      epicsEventSignal(this->readoutDoneEventId);
+      continue;
+    }
+    pImage = frame.pImage;
+    
+    if (frame.status != asynSuccess) {
+      // The transfer failed, so the frame is neither published nor committed
+      if (pImage) {
+        pImage->release();
       }
-      
-      // release the lock so other things can happen, even though they shouldn't
+      this->readoutInFlight--;
+      setIntegerParam(PhotronReadoutOccupancy, this->readoutInFlight);
+      callParamCallbacks();
       this->unlock();
-      epicsEventWaitWithTimeout(this->stopWaitEventId, 1.0);
-      this->lock();
+      epicsEventSignal(this->readoutSpaceEventId);
+      continue;
     }
     
-    // update parameters here since they weren't updated in writeInt32
-    readParameters();
-  }
-}
-
-
-static void PhotronRecTaskC(void *drvPvt) {
-  Photron *pPvt = (Photron *)drvPvt;
-  pPvt->PhotronRecTask();
-}
-
-/** This thread puts the camera in playback mode and reads recorded image data
-  * from the camera after recording is done.
-  */
-void Photron::PhotronRecTask() {
-  unsigned long status;
-  unsigned long nRet;
+    if (this->tMode == 1) {
+      setIntegerParam(PhotronMemIRIGDay, frame.tData.m_nDayOfYear);
+      setIntegerParam(PhotronMemIRIGHour, frame.tData.m_nHour);
+      setIntegerParam(PhotronMemIRIGMin, frame.tData.m_nMinute);
+      setIntegerParam(PhotronMemIRIGSec, frame.tData.m_nSecond);
+      setIntegerParam(PhotronMemIRIGUsec, frame.tData.m_nMicroSecond);
+      setIntegerParam(PhotronMemIRIGSigEx, frame.tData.m_ExistSignal);
+    }
+    
+    /* Get the current parameters */
+    getIntegerParam(NDArrayCounter, &imageCounter);
+    getIntegerParam(ADNumImagesCounter, &numImagesCounter);
+    getIntegerParam(NDArrayCallbacks, &arrayCallbacks);
+    imageCounter++;
+    numImagesCounter++;
+    setIntegerParam(NDArrayCounter, imageCounter);
+    setIntegerParam(ADNumImagesCounter, numImagesCounter);
+    
+    if (frame.pRaw) {
+      // Count the frame as if it had been published, then write it to the
+      // raw file without the port lock
+      callParamCallbacks();
+      this->unlock();
+      this->writeRawFrame(&frame, imageCounter);
+      committed = !this->rawError;
+    } else {
+      /* We save the most recent image buffer so it can be used in the read() 
+       * function. Now release it before getting a new version. */
+      if (this->pArrays[0]) 
+        this->pArrays[0]->release();
+      
+      this->pArrays[0] = pImage;
+      pImage->getInfo(&arrayInfo);
+      setIntegerParam(NDArraySize,  (int)arrayInfo.totalBytes);
+      setIntegerParam(NDArraySizeX, (int)pImage->dims[0].size);
+      setIntegerParam(NDArraySizeY, (int)pImage->dims[1].size);
+      
+      /* Put the frame number and time stamp into the buffer */
+      pImage->uniqueId = imageCounter;
+      updateTimeStamp(&pImage->epicsTS);
+      updateCounterAttributes(pImage->pAttributeList, imageCounter, 
+                              numImagesCounter);
+      
+      /* Call the callbacks to update any changes */
+      callParamCallbacks();
+      this->unlock();
+      
+      if (arrayCallbacks) {
+        /* Call the NDArray callback */
+        /* The lock is not held here, or we can get into a deadlock, because we
+         * can block on the plugin lock, and the plugin can be calling us */
+        asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW,
+                  "%s:%s: calling imageData callback\n", driverName,
+                  functionName);
+        doCallbacksGenericPointer(pImage, NDArrayData, 0);
+      }
+      committed = 1;
+    }
+    
+    // Let the transfer stage start another frame
+    this->lock();
+    if (committed) {
+      this->checkpoint.frame = frame.index;
+    }
+    this->readoutInFlight--;
+    setIntegerParam(PhotronReadoutOccupancy, this->readoutInFlight);
+    this->unlock();
+    epicsEventSignal(this->readoutSpaceEventId);
+  }
+}
+
+
+static void PhotronProcessTaskC(void *drvPvt) {
+  readoutWorker_t *pWorker = (readoutWorker_t *)drvPvt;
+  pWorker->pPvt->PhotronProcessTask(pWorker);
+}
+
+/** Processing stage of the memory readout, run by PhotronReadoutWorkers 
+  * threads. Each one time stamps, attaches the attributes to and corrects 
+  * the frames dealt to it, and passes them on in the order it got them.
+  * With PhotronAttrSnapshot the attributes are copied from the list 
+  * readImageRange evaluated when the readout started, so the port lock 
+  * isn't needed. The frame's index in camera memory and its IRIG time are
+  * added to each frame. Raw frames, frames whose transfer failed and the 
+  * end-of-readout marker are passed straight on.
+  */
+void Photron::PhotronProcessTask(readoutWorker_t *pWorker) {
+  readoutFrame_t frame;
+  NDArray *pImage;
+  int colorMode = NDColorModeMono;
+  epicsUInt32 irigSeconds;
+  double irigTime;
+  
+  /* Loop forever */
+  while (1) {
+    epicsMessageQueueReceive(pWorker->inQueueId, &frame, sizeof(frame));
+    pImage = frame.pImage;
+    
+    if (pImage && (frame.status == asynSuccess)) {
+      pImage->pAttributeList->add("ColorMode", "Color mode", NDAttrInt32, 
+                                  &colorMode);
+      if (this->tMode == 1) {
+        irigSeconds = (((((frame.tData.m_nDayOfYear * 24) + frame.tData.m_nHour) * 60) + frame.tData.m_nMinute) * 60) + frame.tData.m_nSecond;
+        pImage->timeStamp = (this->postIRIGStartTime).secPastEpoch + irigSeconds + (this->postIRIGStartTime).nsec / 1.e9 + frame.tData.m_nMicroSecond / 1.e6;
+      }
+      else {
+        pImage->timeStamp = (this->readoutStartTime).secPastEpoch + (this->readoutStartTime).nsec / 1.e9;
+      }
+      
+      /* Get any attributes that have been defined for this driver */
+      if (this->attrSnapshot) {
+        this->readoutAttributes->copy(pImage->pAttributeList);
+      } else {
+        this->lock();
+        this->getAttributes(pImage->pAttributeList);
+        this->unlock();
+      }
+      pImage->pAttributeList->add("MemFrame", "Frame number in camera memory",
+                                  NDAttrInt32, &(frame.index));
+      if (this->tMode == 1) {
+        // Seconds since the start of the year
+        irigTime = irigSeconds + frame.tData.m_nMicroSecond / 1.e6;
+        pImage->pAttributeList->add("IRIGTime", "IRIG time of the frame (s)",
+                                    NDAttrFloat64, &irigTime);
+      }
+      
+      this->correctImage(pImage);
+    }
+    
+    epicsMessageQueueSend(pWorker->outQueueId, &frame, sizeof(frame));
+  }
+}
+
+
+/** Starts another memory readout processing thread, with its queues. The 
+  * queues hold every frame a readout can have in flight plus the end marker.
+  */
+asynStatus Photron::startReadoutWorker() {
+  readoutWorker_t *pWorker;
+  char name[32];
+  static const char *functionName = "startReadoutWorker";
+  
+  if (this->numReadoutWorkers >= MAX_READOUT_WORKERS) {
+    return asynError;
+  }
+  pWorker = &(this->readoutWorkers[this->numReadoutWorkers]);
+  pWorker->pPvt = this;
+  pWorker->inQueueId = epicsMessageQueueCreate(
+                         MAX_READOUT_DEPTH + MAX_READOUT_LINKS + 1, 
+                         sizeof(readoutFrame_t));
+  pWorker->outQueueId = epicsMessageQueueCreate(
+                          MAX_READOUT_DEPTH + MAX_READOUT_LINKS + 1, 
+                          sizeof(readoutFrame_t));
+  if (!pWorker->inQueueId || !pWorker->outQueueId) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: epicsMessageQueueCreate failure for readout worker\n",
+              driverName, functionName);
+    return asynError;
+  }
+  epicsSnprintf(name, sizeof(name), "PhotronProcess%d", 
+                this->numReadoutWorkers);
+  if (epicsThreadCreate(name, epicsThreadPriorityMedium,
+                        epicsThreadGetStackSize(epicsThreadStackMedium),
+                        (EPICSTHREADFUNC)PhotronProcessTaskC, 
+                        pWorker) == NULL) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: epicsThreadCreate failure for readout worker\n",
+              driverName, functionName);
+    return asynError;
+  }
+  this->numReadoutWorkers++;
+  return asynSuccess;
+}
+
+
+/** Sets the PARAM attributes of a published frame that read the frame 
+  * counters. The workers attach the attributes before the frames are 
+  * counted, and a snapshot holds the counters of the start of the readout.
+  */
+void Photron::updateCounterAttributes(NDAttributeList *pList, 
+                                      int imageCounter, int numImagesCounter) {
+  NDAttribute *pAttribute;
+  NDAttrSource_t sourceType;
+  const char *source;
+  
+  for (pAttribute = pList->next(NULL); pAttribute; 
+       pAttribute = pList->next(pAttribute)) {
+    pAttribute->getSourceInfo(&sourceType);
+    source = pAttribute->getSource();
+    if ((sourceType != NDAttrSourceParam) || !source) {
+      continue;
+    }
+    if (strcmp(source, NDArrayCounterString) == 0) {
+      pAttribute->setValue(&imageCounter);
+    } else if (strcmp(source, ADNumImagesCounterString) == 0) {
+      pAttribute->setValue(&numImagesCounter);
+    }
+  }
+}
+
+
+static void PhotronSDKTaskC(void *drvPvt) {
+  Photron *pPvt = (Photron *)drvPvt;
+  pPvt->PhotronSDKTask();
+}
+
+
+static void PhotronLinkTaskC(void *drvPvt) {
+  Photron *pPvt = (Photron *)drvPvt;
+  pPvt->PhotronLinkTask();
+}
+
+/** Runs the queued SDK commands, highest priority first. Once the driver is
+  * constructed this is the only thread of the port that calls PDCLIB, apart
+  * from the transfers over the second interface, so the other threads don't
+  * contend for the camera and a trigger or stop request only 
+  * waits for the command in progress.
+  */
+void Photron::PhotronSDKTask() {
+  sdkCommand_t *pCmd;
+  int priority;
+  
+  while (1) {
+    epicsEventWait(this->sdkWakeEventId);
+    
+    while (1) {
+      for (priority=0; priority<NUM_SDK_PRIORITIES; priority++) {
+        if (epicsMessageQueueTryReceive(this->sdkQueueId[priority], &pCmd, 
+                                        sizeof(pCmd)) == sizeof(pCmd)) {
+          break;
+        }
+      }
+      if (priority == NUM_SDK_PRIORITIES) {
+        // All of the queues are empty
+        break;
+      }
+      
+      this->runSDKCommand(pCmd);
+      epicsEventSignal(pCmd->doneEventId);
+    }
+  }
+}
+
+
+/** Runs one SDK command. Only called on the SDK thread. The other heads of
+  * the camera have their own SDK threads, so the device is locked while the
+  * command runs.
+  */
+void Photron::runSDKCommand(sdkCommand_t *pCmd) {
+  pCmd->status = asynSuccess;
+  
+  epicsMutexMustLock(this->pDevice->sdkLock);
+  switch (pCmd->type) {
+    case SDK_CMD_GET_STATUS:
+      pCmd->nRet = PDC_GetStatus(this->nDeviceNo, &(pCmd->result), 
+                                 &(pCmd->nErrorCode));
+      if (pCmd->nRet == PDC_FAILED) {
+        pCmd->status = asynError;
+      }
+      break;
+    
+    case SDK_CMD_LIVE_IMAGE:
+      pCmd->status = this->readLiveImage(pCmd);
+      break;
+    
+    case SDK_CMD_MEM_IMAGE:
+      pCmd->status = this->readMemFrame(pCmd);
+      break;
+    
+    case SDK_CMD_CALL:
+      pCmd->status = (this->*(pCmd->method))();
+      break;
+    
+    case SDK_CMD_WRITE_INT32:
+      pCmd->status = this->writeInt32Camera(pCmd);
+      break;
+    
+    case SDK_CMD_WRITE_FLOAT64:
+      pCmd->status = this->writeFloat64Camera(pCmd);
+      break;
+    
+    case SDK_CMD_REFRESH:
+      pCmd->status = this->readParameters((int)pCmd->arg);
+      break;
+  }
+  epicsMutexUnlock(this->pDevice->sdkLock);
+}
+
+
+/** Returns 1 if a command queued by sdkSubmit is done, without waiting. 
+  * sdkWait then returns its status at once.
+  */
+int Photron::sdkDone(sdkCommand_t *pCmd) {
+  if (pCmd->doneEventId && 
+      (epicsEventTryWait(pCmd->doneEventId) == epicsEventWaitOK)) {
+    epicsEventDestroy(pCmd->doneEventId);
+    pCmd->doneEventId = NULL;
+  }
+  return (pCmd->doneEventId == NULL);
+}
+
+
+/** Queues an SDK command and waits for the SDK thread to run it.
+  * \param[in] pCmd The command; results are returned in it
+  * \param[in] priority One of the sdkPriority_t values
+  */
+asynStatus Photron::sdkExecute(sdkCommand_t *pCmd, int priority) {
+  this->sdkSubmit(pCmd, priority, 0);
+  return this->sdkWait(pCmd);
+}
+
+
+/** Queues an SDK command without waiting for it; sdkWait collects it.
+  * \param[in] pCmd The command; it must stay valid until sdkWait returns
+  * \param[in] priority One of the sdkPriority_t values; ignored for link 1
+  * \param[in] link 0 for the SDK thread, 1 for a SDK_CMD_MEM_IMAGE over the
+  *            camera's second interface
+  */
+asynStatus Photron::sdkSubmit(sdkCommand_t *pCmd, int priority, int link) {
+  epicsThreadId threadId = link ? this->linkThreadId : this->sdkThreadId;
+  static const char *functionName = "sdkSubmit";
+  
+  pCmd->link = link;
+  pCmd->doneEventId = NULL;
+  
+  // Commands from the target thread itself (or before it exists) run directly
+  if (!threadId || (epicsThreadGetIdSelf() == threadId)) {
+    if (link) {
+      epicsMutexMustLock(this->pDevice->linkLock);
+      pCmd->status = this->readMemFrame(pCmd);
+      epicsMutexUnlock(this->pDevice->linkLock);
+    } else {
+      this->runSDKCommand(pCmd);
+    }
+    return pCmd->status;
+  }
+  
+  pCmd->doneEventId = epicsEventCreate(epicsEventEmpty);
+  if (!pCmd->doneEventId) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: epicsEventCreate failure\n", driverName, functionName);
+    pCmd->status = asynError;
+    return asynError;
+  }
+  
+  if (link) {
+    epicsMessageQueueSend(this->linkQueueId, &pCmd, sizeof(pCmd));
+  } else {
+    epicsMessageQueueSend(this->sdkQueueId[priority], &pCmd, sizeof(pCmd));
+    epicsEventSignal(this->sdkWakeEventId);
+  }
+  return asynSuccess;
+}
+
+
+/** Waits for a command queued by sdkSubmit and returns its status */
+asynStatus Photron::sdkWait(sdkCommand_t *pCmd) {
+  if (pCmd->doneEventId) {
+    epicsEventWait(pCmd->doneEventId);
+    epicsEventDestroy(pCmd->doneEventId);
+    pCmd->doneEventId = NULL;
+  }
+  return pCmd->status;
+}
+
+
+/** Runs the memory transfers queued for the camera's second interface. Only
+  * SDK_CMD_MEM_IMAGE is queued here, so it runs in parallel with the SDK 
+  * thread's transfer on the first interface.
+  */
+void Photron::PhotronLinkTask() {
+  sdkCommand_t *pCmd;
+  
+  while (1) {
+    epicsMessageQueueReceive(this->linkQueueId, &pCmd, sizeof(pCmd));
+    // The second interface is shared by the heads too
+    epicsMutexMustLock(this->pDevice->linkLock);
+    pCmd->status = this->readMemFrame(pCmd);
+    epicsMutexUnlock(this->pDevice->linkLock);
+    epicsEventSignal(pCmd->doneEventId);
+  }
+}
+
+
+/** Transfers one memory frame, and its IRIG time if pCmd->pIRIG is set, over
+  * the interface selected by pCmd->link. The IRIG table belongs to the SDK
+  * thread, so frames on the second interface fetch their time directly after
+  * the image. When the command has an ROI or converts the 
+  * pixels the frame goes to the link's transfer buffer, and each row of the 
+  * ROI is copied or converted to pCmd->format in pCmd->pData.
+  */
+asynStatus Photron::readMemFrame(sdkCommand_t *pCmd) {
+  unsigned long nDevice = pCmd->link ? this->nLinkDeviceNo : this->nDeviceNo;
+  void *pBuf = pCmd->pData;
+  int staged = pCmd->roiWidth || (pCmd->format != READOUT_FORMAT_NATIVE);
+  const char *pSrc;
+  char *pDst;
+  size_t pixelSize, rowBytes, srcPitch;
+  unsigned long row;
+  
+  pCmd->nErrorCode = 0;
+  // Fetch the IRIG times of the coming frames before the image transfer. No 
+  // other PDCLIB call is made between PDC_GetMemImageDataStart and End.
+  if (pCmd->pIRIG && !pCmd->link) {
+    this->prefetchIRIG(pCmd->arg);
+  }
+  if (staged) {
+    // The SDK only transfers whole frames in the camera's format
+    pBuf = this->transferBuf[pCmd->link];
+    if (!pBuf) {
+      printf("No transfer buffer for the readout ROI\n");
+      return asynError;
+    }
+  }
+  
+  pCmd->nRet = PDC_GetMemImageDataStart(nDevice, this->nChildNo, pCmd->arg,
+                                        pCmd->bitDepth, pBuf, 
+                                        &(pCmd->nErrorCode));
+  if (pCmd->nRet == PDC_FAILED) {
+    printf("PDC_GetMemImageDataStart Error %d; index = %d\n", 
+           pCmd->nErrorCode, pCmd->arg);
+    return asynError;
+  }
+  pCmd->nRet = PDC_GetMemImageDataEnd(nDevice, this->nChildNo, pCmd->bitDepth,
+                                      pBuf, &(pCmd->nErrorCode));
+  if (pCmd->nRet == PDC_FAILED) {
+    printf("PDC_GetMemImageDataEnd Error %d\n", pCmd->nErrorCode);
+    return asynError;
+  }
+  if (staged) {
+    pixelSize = pCmd->bitDepth / 8;
+    srcPitch = this->memWidth * pixelSize;
+    pSrc = (const char *)pBuf + pCmd->roiY * srcPitch + pCmd->roiX * pixelSize;
+    pDst = (char *)pCmd->pData;
+    switch (pCmd->format) {
+      case READOUT_FORMAT_8BIT:
+        for (row=0; row<pCmd->roiHeight; row++) {
+          photronConvert8((const epicsUInt16 *)pSrc, (epicsUInt8 *)pDst, 
+                          pCmd->roiWidth, pCmd->shift);
+          pSrc += srcPitch;
+          pDst += pCmd->roiWidth;
+        }
+        break;
+      case READOUT_FORMAT_PACKED12:
+        // Rows start on a byte boundary, so an odd width pads each row
+        rowBytes = PACKED12_BYTES(pCmd->roiWidth);
+        for (row=0; row<pCmd->roiHeight; row++) {
+          photronPack12((const epicsUInt16 *)pSrc, (epicsUInt8 *)pDst, 
+                        pCmd->roiWidth);
+          pSrc += srcPitch;
+          pDst += rowBytes;
+        }
+        break;
+      default:
+        rowBytes = pCmd->roiWidth * pixelSize;
+        for (row=0; row<pCmd->roiHeight; row++) {
+          memcpy(pDst, pSrc, rowBytes);
+          pSrc += srcPitch;
+          pDst += rowBytes;
+        }
+        break;
+    }
+  }
+  if (pCmd->pIRIG && 
+      (pCmd->link || !this->lookupIRIG(pCmd->arg, pCmd->pIRIG))) {
+    pCmd->nRet = PDC_GetMemIRIGData(nDevice, this->nChildNo, pCmd->arg, 
+                                    pCmd->pIRIG, &(pCmd->nErrorCode));
+    if (pCmd->nRet == PDC_FAILED) {
+      printf("PDC_GetMemIRIGData Error %d\n", pCmd->nErrorCode);
+      return asynError;
+    }
+  }
+  return asynSuccess;
+}
+
+
+/** Runs a method on the SDK thread. Must be called with the port lock held. */
+asynStatus Photron::sdkCall(sdkMethod_t method, int priority) {
+  sdkCommand_t cmd;
+  
+  cmd.type = SDK_CMD_CALL;
+  cmd.method = method;
+  return this->sdkExecute(&cmd, priority);
+}
+
+
+/** Runs readParameters on the SDK thread at low priority. Must be called with
+  * the port lock held. */
+asynStatus Photron::sdkRefresh(int groups) {
+  sdkCommand_t cmd;
+  
+  cmd.type = SDK_CMD_REFRESH;
+  cmd.arg = groups;
+  return this->sdkExecute(&cmd, SDK_PRIORITY_LOW);
+}
+
+
+/** Reads the camera status on the SDK thread */
+asynStatus Photron::sdkGetStatus(unsigned long *pStatus, unsigned long *pErrorCode) {
+  sdkCommand_t cmd;
+  
+  cmd.type = SDK_CMD_GET_STATUS;
+  this->sdkExecute(&cmd, SDK_PRIORITY_NORMAL);
+  *pStatus = cmd.result;
+  *pErrorCode = cmd.nErrorCode;
+  return cmd.status;
+}
+
+
+static void PhotronWaitTaskC(void *drvPvt) {
+  Photron *pPvt = (Photron *)drvPvt;
+  pPvt->PhotronWaitTask();
+}
+
+/** Saving the shading data takes a long time. Spawn a task to poll the status
+  */
+void Photron::PhotronWaitTask() {
+  unsigned long status = 0;
+  unsigned long nErrorCode;
+  int eStatus;
+  const char *functionName = "PhotronWaitTask";
+  
+  this->lock();
+  /* Loop forever */
+  while (1) {
+    /* Wait for a semaphore that is given when shading data is being saved */
+    /* Release the lock while we wait for an event that says acquire has 
+       started, then lock again */
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW,
+              "%s:%s: waiting for long operation to start\n", driverName, 
+              functionName);
+    this->unlock();
+    epicsEventWait(this->startWaitEventId);
+    this->lock();
+    
+    // Wait until long operaion (saving/loading) is done
+    while (1) {
+      printf("Waiting for long operation to be done...\n");
+      // Get camera status
+      if (this->sdkGetStatus(&status, &nErrorCode) != asynSuccess) {
+        printf("PDC_GetStatus (#1) failed %d\n", nErrorCode);
+      }
+      setIntegerParam(PhotronStatus, status);
+      eStatus = statusToEPICS(status);
+      setIntegerParam(PhotronStatusName, eStatus);
+      callParamCallbacks();
+      
+      if ((status == PDC_STATUS_SAVE) || (status == PDC_STATUS_LOAD)) {
+        // the state we've been waiting for has occurred
+        this->forceWait = 0;
+      }
+      
+      if ((status != PDC_STATUS_SAVE) && (status != PDC_STATUS_LOAD) && this->forceWait == 0) {
+        break;
+      }
+      
+      // release the lock so other things can happen, even though they shouldn't
+      this->unlock();
+      epicsEventWaitWithTimeout(this->stopWaitEventId, 1.0);
+      this->lock();
+    }
+    
+    // update parameters here since they weren't updated in writeInt32
+    this->sdkRefresh(PHOTRON_REFRESH_ALL);
+  }
+}
+
+
+static void PhotronRecTaskC(void *drvPvt) {
+  Photron *pPvt = (Photron *)drvPvt;
+  pPvt->PhotronRecTask();
+}
+
+/** Monitors the camera status while in record mode and reads out the memory
+  * when a recording finishes. The status is polled quickly only when a 
+  * transition is expected: just after a trigger and near the expected end 
+  * of a recording. While the camera waits for a trigger the poll period 
+  * backs off to PHOTRON_POLL_MAX. Parameter callbacks are only done when the
+  * status changes.
+  */
+void Photron::PhotronRecTask() {
+  unsigned long status, lastStatus;
+  asynStatus sdkStatus;
   unsigned long nErrorCode;
   int acqMode, previewMode;
   int eStatus;
+  int numPolls;
+  int adstatus;
+  asynStatus readoutStatus;
+  double delay, elapsed;
+  epicsTimeStamp pollTime, lastPollTime, rateTime, recStartTime;
+  // Not a valid camera status; forces an update on the next poll
+  const unsigned long unknownStatus = 0xFFFFFFFF;
   
   const char *functionName = "PhotronRecTask";
 
@@ -757,39 +1891,95 @@ void Photron::PhotronRecTask() {
       
       // Reset the stopRecFlag
       this->stopRecFlag = 0;
+      
+      if (this->resumeFlag) {
+        // Finish an interrupted readout instead of recording
+        this->resumeReadout();
+        this->resumeFlag = 0;
+        continue;
+      }
     }
     
+    lastStatus = unknownStatus;
+    this->recPollPeriod = PHOTRON_POLL_MIN;
+    numPolls = 0;
+    epicsTimeGetCurrent(&rateTime);
+    lastPollTime = rateTime;
+    recStartTime = rateTime;
+    
     // Wait for triggered recording
+    this->setRecordWait(1);
     while (acqMode == 1) {
       // Get camera status
-      nRet = PDC_GetStatus(this->nDeviceNo, &status, &nErrorCode);
-      if (nRet == PDC_FAILED) {
+      sdkStatus = this->sdkGetStatus(&status, &nErrorCode);
+      epicsTimeGetCurrent(&pollTime);
+      numPolls++;
+      if (sdkStatus != asynSuccess) {
         printf("PDC_GetStatus (#2) failed %d\n", nErrorCode);
+        status = lastStatus;
       }
-      setIntegerParam(PhotronStatus, status);
-      if (status == PDC_STATUS_REC) {
-        setIntegerParam(ADStatus, ADStatusAcquire);
+      
+      if (status != lastStatus) {
+        // The transition happened at some point since the previous poll
+        if (lastStatus != unknownStatus) {
+          setDoubleParam(PhotronTransLatency, 
+                         1000.0 * epicsTimeDiffInSeconds(&pollTime, &lastPollTime));
+        }
+        
+        setIntegerParam(PhotronStatus, status);
+        if (status == PDC_STATUS_REC) {
+          setIntegerParam(ADStatus, ADStatusAcquire);
+          setStringParam(ADStatusMessage, "");
+          recStartTime = pollTime;
+          // The recording a saved checkpoint refers to is being overwritten
+          clearCheckpoint();
+        } else if ((status == PDC_STATUS_ENDLESS) || (status == PDC_STATUS_RECREADY)) {
+          // A failed readout stays reported until the next recording
+          getIntegerParam(ADStatus, &adstatus);
+          if (adstatus != ADStatusError) {
+            setIntegerParam(ADStatus, ADStatusWaiting);
+          }
+          // Reset the acquire button -- THIS HAPPENS TOO SOON. The status hasn't changed to record yet
+          //setIntegerParam(ADAcquire, 0);
+        }
+        eStatus = statusToEPICS(status);
+        setIntegerParam(PhotronStatusName, eStatus);
+        callParamCallbacks();
+        
+        lastStatus = status;
+        this->recPollPeriod = PHOTRON_POLL_MIN;
       } else if ((status == PDC_STATUS_ENDLESS) || (status == PDC_STATUS_RECREADY)) {
-        setIntegerParam(ADStatus, ADStatusWaiting);
-        // Reset the acquire button -- THIS HAPPENS TOO SOON. The status hasn't changed to record yet
-        //setIntegerParam(ADAcquire, 0);
+        // Back off while waiting for a trigger
+        this->recPollPeriod *= 2.0;
+        if (this->recPollPeriod > PHOTRON_POLL_MAX) {
+          this->recPollPeriod = PHOTRON_POLL_MAX;
+        }
+      }
+      lastPollTime = pollTime;
+      
+      // Update the poll rate about once per second
+      elapsed = epicsTimeDiffInSeconds(&pollTime, &rateTime);
+      if (elapsed >= 1.0) {
+        setDoubleParam(PhotronPollRate, numPolls / elapsed);
+        callParamCallbacks();
+        numPolls = 0;
+        rateTime = pollTime;
       }
-      eStatus = statusToEPICS(status);
-      setIntegerParam(PhotronStatusName, eStatus);
-      callParamCallbacks();
       
-      // Triggered acquisition is done when camera status returns to live
-      if (status == PDC_STATUS_LIVE) {
+      // Triggered acquisition is done when camera status returns to live, or
+      // when another head whose recording ended put the camera in playback
+      if ((status == PDC_STATUS_LIVE) || 
+          ((status == PDC_STATUS_PLAYBACK) && this->readingMemory)) {
         //
         printf("!!!\tAcquisition is done\n");
         //epicsThreadSleep(1.0);
         //
         printf("Put camera in playback mode\n");
-        setPlayback();
+        sdkCall(&Photron::setPlayback, SDK_PRIORITY_NORMAL);
         //
         printf("Read info from camera\n");
         // readMem should set the readout params to the max?
-        readMem();
+        sdkCall(&Photron::readMem, SDK_PRIORITY_NORMAL);
         
         getIntegerParam(PhotronPreviewMode, &previewMode);
         
@@ -800,6 +1990,9 @@ void Photron::PhotronRecTask() {
           // Signal that previewing is in progress
           this->previewDone = 0;
           
+          // Index the recording while the user looks through it
+          epicsEventSignal(this->indexEventId);
+          
           // Wait until user is done previewing the data
           this->unlock();
           epicsEventWait(this->resumeRecEventId);
@@ -816,21 +2009,50 @@ void Photron::PhotronRecTask() {
         callParamCallbacks();
         
         // Read specified image range here
-        this->readImageRange();
+        readoutStatus = this->readImageRange();
         
         // Reset Acquire
         setIntegerParam(ADAcquire, 0);
         callParamCallbacks();
         
-        //
+        // The camera leaves playback once every head has its frames
+        this->waitForOtherHeads();
         printf("Return camera to ready-to-trigger state\n");
-        setRecReady();
+        sdkCall(&Photron::setRecReady, SDK_PRIORITY_NORMAL);
+        
+        // Report a failed readout until the camera records again
+        if (readoutStatus != asynSuccess) {
+          setIntegerParam(ADStatus, ADStatusError);
+          setStringParam(ADStatusMessage, "Readout failed");
+        } else {
+          setStringParam(ADStatusMessage, "");
+        }
+        callParamCallbacks();
+        
+        // The readout changed the status; don't count it as a transition
+        lastStatus = unknownStatus;
+        this->recPollPeriod = PHOTRON_POLL_MIN;
+        epicsTimeGetCurrent(&lastPollTime);
+      }
+      
+      if (lastStatus == PDC_STATUS_REC) {
+        // Poll slowly until the recording is about to end
+        epicsTimeGetCurrent(&pollTime);
+        delay = (this->expectedRecordTime() - 
+                 epicsTimeDiffInSeconds(&pollTime, &recStartTime)) / 2.0;
+        if (delay < PHOTRON_POLL_MIN) {
+          delay = PHOTRON_POLL_MIN;
+        } else if (delay > PHOTRON_POLL_MAX) {
+          delay = PHOTRON_POLL_MAX;
+        }
+      } else {
+        delay = this->recPollPeriod;
       }
       
-      // release the lock so the trigger PV can be used
+      // release the lock so the trigger PV can be used. Triggers signal 
+      // stopRecEventId to cut the wait short.
       this->unlock();
-      //epicsThreadSleep(0.001);
-      epicsEventWaitWithTimeout(this->stopRecEventId, 0.001);
+      epicsEventWaitWithTimeout(this->stopRecEventId, delay);
       this->lock();
       
       if (this->stopRecFlag == 1) {
@@ -840,6 +2062,8 @@ void Photron::PhotronRecTask() {
       // Update the acq mode
       getIntegerParam(PhotronAcquireMode, &acqMode);
     }
+    this->setRecordWait(0);
+    this->releasePlayback();
   }
 }
   
@@ -858,6 +2082,7 @@ void Photron::PhotronTask() {
   int imageMode;
   int arrayCallbacks;
   int acquire;
+  int delivery;
   NDArray *pImage;
   double acquirePeriod, delay;
   epicsTimeStamp startTime, endTime;
@@ -885,6 +2110,12 @@ void Photron::PhotronTask() {
       epicsEventWait(this->startEventId);
       this->lock();
       setIntegerParam(ADNumImagesCounter, 0);
+      this->liveGrabbed = 0;
+      this->livePublished = 0;
+      this->liveDropped = 0;
+      setIntegerParam(PhotronLiveGrabbed, 0);
+      setIntegerParam(PhotronLivePublished, 0);
+      setIntegerParam(PhotronLiveDropped, 0);
     }
 
     /* We are acquiring. */
@@ -904,8 +2135,13 @@ void Photron::PhotronTask() {
 
     //printf("I should do something\n");
     
-    /* Read the image */
-    imageStatus = readImage();
+    /* Read the image, or take the newest one from PhotronGrabTask */
+    getIntegerParam(PhotronLiveDelivery, &delivery);
+    if (delivery) {
+      imageStatus = readLatestImage();
+    } else {
+      imageStatus = readImage();
+    }
 
     /* Close the shutter */
     //setShutter(ADShutterClosed);
@@ -927,10 +2163,13 @@ void Photron::PhotronTask() {
       setIntegerParam(NDArrayCounter, imageCounter);
       setIntegerParam(ADNumImagesCounter, numImagesCounter);
 
-      /* Put the frame number and time stamp into the buffer */
+      /* Put the frame number and time stamp into the buffer. PhotronGrabTask
+       * stamped the newest frame when it was grabbed. */
       pImage->uniqueId = imageCounter;
-      pImage->timeStamp = startTime.secPastEpoch + startTime.nsec / 1.e9;
-      updateTimeStamp(&pImage->epicsTS);
+      if (!delivery) {
+        pImage->timeStamp = startTime.secPastEpoch + startTime.nsec / 1.e9;
+        updateTimeStamp(&pImage->epicsTS);
+      }
 
       /* Get any attributes that have been defined for this driver */
       this->getAttributes(pImage->pAttributeList);
@@ -982,56 +2221,237 @@ void Photron::PhotronTask() {
 
 /* From asynPortDriver: Disconnects driver from device; */
 asynStatus Photron::disconnect(asynUser* pasynUser) {
-  return disconnectCamera();
+  return sdkCall(&Photron::disconnectCamera, SDK_PRIORITY_NORMAL);
 }
 
 
 asynStatus Photron::disconnectCamera() {
   int status = asynSuccess;
   static const char *functionName = "disconnectCamera";
+
+  /* Ensure that PDC library has been initialised */
+  if (!PDCLibInitialized) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
+        "%s:%s: Connecting to camera %s while PDC library is uninitialized.\n", 
+        driverName, functionName, this->cameraId);
+    return asynError;
+  }
+  
+  this->closeDevice();
+  
+  /* Camera is disconnected. Signal to asynManager that it is disconnected. */
+  status = pasynManager->exceptionDisconnect(this->pasynUserSelf);
+  if (status) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s:%s: error calling pasynManager->exceptionDisconnect, error=%s\n",
+      driverName, functionName, pasynUserSelf->errorMessage);
+  }
+  asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW, 
+    "%s:%s: Camera disconnected; camera id: %s\n", 
+    driverName, functionName, this->cameraId);
+
+  return((asynStatus)status);
+}
+
+
+/** Closes the camera's second interface and the device, unless another head
+  * of the camera still uses the device. Called on disconnect and when a
+  * connect fails after the device was opened.
+  */
+void Photron::closeDevice() {
   unsigned long nRet;
   unsigned long nErrorCode;
+  Photron *pShared;
+  
+  if (this->linkOpen) {
+    // The other heads read over the same second interface
+    pShared = findSharedDevice();
+    if (!pShared || !pShared->linkOpen) {
+      nRet = PDC_CloseDevice(this->nLinkDeviceNo, &nErrorCode);
+      if (nRet == PDC_FAILED){
+        printf("PDC_CloseDevice for device #%d did not succeed. Error code = %d\n", 
+               this->nLinkDeviceNo, nErrorCode);
+      }
+    }
+    this->linkOpen = 0;
+    setIntegerParam(PhotronLinkConnected, 0);
+  }
+  
+  if (!this->deviceOpen) {
+    return;
+  }
+  
+  // Leave the device open while other heads of the camera are connected
+  this->deviceOpen = 0;
+  pShared = findSharedDevice();
+  if (pShared) {
+    printf("Device #%d is still used by %s\n", this->nDeviceNo, 
+           pShared->portName);
+  } else {
+    nRet = PDC_CloseDevice(this->nDeviceNo, &nErrorCode);
+    if (nRet == PDC_FAILED){
+      printf("PDC_CloseDevice for device #%d did not succeed. Error code = %d\n", 
+             this->nDeviceNo, nErrorCode);
+    } else {
+      printf("PDC_CloseDevice succeeded for device #%d\n", this->nDeviceNo);
+    }
+  }
+}
+
 
+/* From asynPortDriver: Connects driver to device; */
+asynStatus Photron::connect(asynUser* pasynUser) {
+  return sdkCall(&Photron::connectCamera, SDK_PRIORITY_NORMAL);
+}
+
+
+asynStatus Photron::connectCamera() {
+  int status = asynSuccess;
+  static const char *functionName = "connectCamera";
+  //
+  unsigned long nRet;
+  unsigned long nErrorCode;
+  unsigned long childCount;
+  Photron *pShared;
+  
   /* Ensure that PDC library has been initialised */
   if (!PDCLibInitialized) {
     asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
-        "%s:%s: Connecting to camera %s while PDC library is uninitialized.\n", 
-        driverName, functionName, this->cameraId);
+      "%s:%s: Connecting to camera %s while PDC library is uninitialized.\n", 
+      driverName, functionName, this->cameraId);
+    return asynError;
+  }
+  
+  //printf("Connecting to the camera\n");
+  
+  // The Prosilica driver does this, but it isn't obvious why
+  /* First disconnect from the camera */
+  //disconnectCamera();
+
+  /* Another head of this camera may already have opened the device */
+  pShared = findSharedDevice();
+  if (pShared) {
+    this->nDeviceNo = pShared->nDeviceNo;
+    printf("Sharing device #%i with %s\n", this->nDeviceNo, pShared->portName);
+  } else {
+    status = openDevice(this->cameraId, this->autoDetect, &(this->nDeviceNo));
+    if (status) {
+      return((asynStatus)status);
+    }
+  }
+  
+  /* Check the head before the port claims the device */
+  this->nChildNo = this->childNo;
+  nRet = PDC_GetChildDeviceCount(this->nDeviceNo, &childCount, &nErrorCode);
+  if ((nRet == PDC_SUCCEEDED) && (this->nChildNo > childCount)) {
+    printf("Device #%i has %d heads; child %d does not exist\n", 
+           this->nDeviceNo, childCount, this->nChildNo);
+    if (!pShared) {
+      PDC_CloseDevice(this->nDeviceNo, &nErrorCode);
+    }
+    return asynError;
+  }
+  this->deviceOpen = 1;
+  
+  /* The camera's second interface carries half of a striped readout */
+  if (this->linkCameraId && !this->linkOpen) {
+    if (pShared && pShared->linkOpen) {
+      this->nLinkDeviceNo = pShared->nLinkDeviceNo;
+      this->linkOpen = 1;
+    } else if (openDevice(this->linkCameraId, PDC_DETECT_NORMAL, 
+                          &(this->nLinkDeviceNo)) == asynSuccess) {
+      this->linkOpen = 1;
+    } else {
+      printf("Second interface %s unavailable; readout will use one link\n",
+             this->linkCameraId);
+    }
+  }
+  setIntegerParam(PhotronLinkConnected, this->linkOpen);
+  
+  /* PDC_GetStatus is also called in readParameters(), but it is called here
+     so that the camera can be put into live mode--will remove this after
+     making the mode a PV */
+  nRet = PDC_GetStatus(this->nDeviceNo, &(this->nStatus), &nErrorCode);
+  if (nRet == PDC_FAILED) {
+    printf("PDC_GetStatus (#3) failed %d\n", nErrorCode);
+    this->closeDevice();
+    return asynError;
+  } else {
+    // Don't interrupt a download of another head
+    if ((this->nStatus == PDC_STATUS_PLAYBACK) && !pShared) {
+      nRet = PDC_SetStatus(this->nDeviceNo, PDC_STATUS_LIVE, &nErrorCode);
+      if (nRet == PDC_FAILED) {
+        printf("PDC_SetStatus failed. error = %d\n", nErrorCode);
+      }
+    }
+  }
+  /* Get information from the camera */
+  //printf("Getting camera info\n");
+  status = getCameraInfo();
+  if (status) {
+    this->closeDevice();
+    return((asynStatus)status);
+  }
+  
+  /* Set some initial values for other parameters */
+  status =  setStringParam (ADManufacturer, "Photron");
+  status |= setStringParam (ADModel, this->deviceName);
+  status |= setIntegerParam(ADSizeX, this->sensorWidth);
+  status |= setIntegerParam(ADSizeY, this->sensorHeight);
+  status |= setIntegerParam(ADMaxSizeX, this->sensorWidth);
+  status |= setIntegerParam(ADMaxSizeY, this->sensorHeight);
+  //
+  status |= setIntegerParam(PhotronVarChan, 1);
+  status |= setIntegerParam(PhotronMemIRIGDay, 0);
+  status |= setIntegerParam(PhotronMemIRIGHour, 0);
+  status |= setIntegerParam(PhotronMemIRIGMin, 0);
+  status |= setIntegerParam(PhotronMemIRIGSec, 0);
+  status |= setIntegerParam(PhotronMemIRIGUsec, 0);
+  status |= setIntegerParam(PhotronMemIRIGSigEx, 0);
+  status |= setDoubleParam(PhotronReadoutRate, 0.0);
+  status |= setDoubleParam(PhotronReadoutBandwidth, 0.0);
+  
+  if (status) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
+              "%s:%s: unable to set camera parameters on camera %s\n",
+              driverName, functionName, this->cameraId);
+    this->closeDevice();
     return asynError;
   }
   
-  nRet = PDC_CloseDevice(this->nDeviceNo, &nErrorCode);
-  if (nRet == PDC_FAILED){
-    printf("PDC_CloseDevice for device #%d did not succeed. Error code = %d\n", 
-           this->nDeviceNo, nErrorCode);
-  } else {
-    printf("PDC_CloseDevice succeeded for device #%d\n", this->nDeviceNo);
+  /* Read the current camera settings */
+  //printf("Reading camera parameters\n");
+  status = readParameters();
+  if (status) {
+    this->closeDevice();
+    return((asynStatus)status);
   }
   
-  /* Camera is disconnected. Signal to asynManager that it is disconnected. */
-  status = pasynManager->exceptionDisconnect(this->pasynUserSelf);
+  /* We found the camera. Everything is OK. Signal to asynManager that we are 
+     connected. */
+  status = pasynManager->exceptionConnect(this->pasynUserSelf);
   if (status) {
     asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
-      "%s:%s: error calling pasynManager->exceptionDisconnect, error=%s\n",
+      "%s:%s: error calling pasynManager->exceptionConnect, error=%s\n",
       driverName, functionName, pasynUserSelf->errorMessage);
+    return asynError;
   }
   asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW, 
-    "%s:%s: Camera disconnected; camera id: %s\n", 
-    driverName, functionName, this->cameraId);
-
-  return((asynStatus)status);
-}
-
-
-/* From asynPortDriver: Connects driver to device; */
-asynStatus Photron::connect(asynUser* pasynUser) {
-  return connectCamera();
+    "%s:%s: Camera connected; camera id: %ld\n", driverName,
+    functionName, this->cameraId);
+  return asynSuccess;
 }
 
 
-asynStatus Photron::connectCamera() {
+/** Detects the camera at address and opens it.
+  * \param[in] address IP address or name of the camera interface
+  * \param[in] autoDetect 0=PDC_DETECT_NORMAL; 1=PDC_DETECT_AUTO
+  * \param[out] pDeviceNo The PDCLIB device number of the opened camera
+  */
+asynStatus Photron::openDevice(const char *address, int autoDetect, 
+                               unsigned long *pDeviceNo) {
   int status = asynSuccess;
-  static const char *functionName = "connectCamera";
+  static const char *functionName = "openDevice";
   //
   struct in_addr ipAddr;
   unsigned long ipNumWire;
@@ -1047,26 +2467,12 @@ asynStatus Photron::connectCamera() {
   /* default IP for auto-detection is "192.168.0.0" */
   //IPList[0] = 0xC0A80000;
   
-  /* Ensure that PDC library has been initialised */
-  if (!PDCLibInitialized) {
-    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
-      "%s:%s: Connecting to camera %s while PDC library is uninitialized.\n", 
-      driverName, functionName, this->cameraId);
-    return asynError;
-  }
-  
-  //printf("Connecting to the camera\n");
-  
-  // The Prosilica driver does this, but it isn't obvious why
-  /* First disconnect from the camera */
-  //disconnectCamera();
-
   /* We have been given an IP address or IP name */
-  status = hostToIPAddr(this->cameraId, &ipAddr);
+  status = hostToIPAddr(address, &ipAddr);
   if (status) {
     asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
       "%s:%s: Cannot find IP address %s\n", 
-      driverName, functionName, this->cameraId);
+      driverName, functionName, address);
     //return asynError;
   }
   ipNumWire = (unsigned long) ipAddr.s_addr;
@@ -1074,20 +2480,20 @@ asynStatus Photron::connectCamera() {
   ipNumHost = ntohl(ipNumWire);
 
   IPList[0] = ipNumHost;
-  
+
   // Attempt to detect the type of detector at the specified ip addr
   nRet = PDC_DetectDevice(
               PDC_INTTYPE_G_ETHER, /* Gigabit ethernet interface */
               IPList,              /* IP address */
               1,                   /* Max number of searched devices */
-              this->autoDetect,    /* 0=PDC_DETECT_NORMAL;1=PDC_DETECT_AUTO */
+              autoDetect,          /* 0=PDC_DETECT_NORMAL;1=PDC_DETECT_AUTO */
               &DetectNumInfo,
               &nErrorCode);
   if (nRet == PDC_FAILED) {
     printf("PDC_DetectDevice Error %d\n", nErrorCode);
     return asynError;
   }
-  
+
   printf("PDC_DetectDevice \"Successful\"\n");
   printf("\tdevice index: %d\n", DetectNumInfo.m_nDeviceNum);
   printf("\tdevice code: %d\n", DetectNumInfo.m_DetectInfo[0].m_nDeviceCode);
@@ -1099,7 +2505,7 @@ asynStatus Photron::connectCamera() {
   }
 
   /* only do this if not auto-searching for devices */
-  if ((this->autoDetect == PDC_DETECT_NORMAL) && 
+  if ((autoDetect == PDC_DETECT_NORMAL) && 
      (DetectNumInfo.m_DetectInfo[0].m_nTmpDeviceNo != IPList[0])) {
     printf("The specified and detected IP addresses differ:\n");
     printf("\tIPList[0] = %x\n", IPList[0]);
@@ -1108,89 +2514,145 @@ asynStatus Photron::connectCamera() {
     return asynError;
   }
 
-  nRet = PDC_OpenDevice(&(DetectNumInfo.m_DetectInfo[0]), &(this->nDeviceNo),
+  nRet = PDC_OpenDevice(&(DetectNumInfo.m_DetectInfo[0]), pDeviceNo,
                         &nErrorCode);
   /* When should PDC_OpenDevice2 be used instead of PDC_OpenDevice? */
   //nRet = PDC_OpenDevice2(&(DetectNumInfo.m_DetectInfo[0]), 
   //            10,  /* nMaxRetryCount */
   //            0,  /* nConnectMode -- 1=normal, 0=safe */
-  //            &(this->nDeviceNo),
+  //            pDeviceNo,
   //            &nErrorCode);
   if (nRet == PDC_FAILED) {
     printf("PDC_OpenDeviceError %d\n", nErrorCode);
     return asynError;
   } else {
-    printf("Device #%i opened successfully\n", this->nDeviceNo);
+    printf("Device #%i opened successfully\n", *pDeviceNo);
   }
+  return asynSuccess;
+}
 
-  /* Assume only one child, for now */
-  this->nChildNo = 1;
+
+/** Returns another port that has opened the same camera, or NULL. The heads
+  * of a multi-head camera are read by separate ports with the same IP address.
+  */
+Photron *Photron::findSharedDevice() {
+  cameraNode *pNode;
+  Photron *pShared = NULL;
   
-  /* PDC_GetStatus is also called in readParameters(), but it is called here
-     so that the camera can be put into live mode--will remove this after
-     making the mode a PV */
-  nRet = PDC_GetStatus(this->nDeviceNo, &(this->nStatus), &nErrorCode);
-  if (nRet == PDC_FAILED) {
-    printf("PDC_GetStatus (#3) failed %d\n", nErrorCode);
-    return asynError;
-  } else {
-    if (this->nStatus == PDC_STATUS_PLAYBACK) {
-      nRet = PDC_SetStatus(this->nDeviceNo, PDC_STATUS_LIVE, &nErrorCode);
-      if (nRet == PDC_FAILED) {
-        printf("PDC_SetStatus failed. error = %d\n", nErrorCode);
-      }
+  epicsMutexMustLock(cameraListLock);
+  pNode = (cameraNode *)ellFirst(cameraList);
+  while (pNode) {
+    if ((pNode->pCamera != this) && pNode->pCamera->deviceOpen &&
+        (strcmp(pNode->pCamera->cameraId, this->cameraId) == 0)) {
+      pShared = pNode->pCamera;
+      break;
     }
+    pNode = (cameraNode *)ellNext(&pNode->node);
   }
-  /* Get information from the camera */
-  //printf("Getting camera info\n");
-  status = getCameraInfo();
-  if (status) {
-    return((asynStatus)status);
+  epicsMutexUnlock(cameraListLock);
+  return pShared;
+}
+
+
+/** Counts this head as reading the camera memory. Playback is camera-wide, so
+  * when a head finishing a recording is the first to read, the heads still 
+  * waiting for that recording to end are counted too and woken to read it.
+  * Returns 1 if another head already put the camera in playback.
+  */
+int Photron::claimPlayback() {
+  cameraNode *pNode;
+  Photron *pOther;
+  int shared;
+  
+  epicsMutexMustLock(cameraListLock);
+  shared = (this->pDevice->numReading > this->readingMemory);
+  if (!this->readingMemory) {
+    this->readingMemory = 1;
+    this->pDevice->numReading++;
+  }
+  if (!shared && this->recordWait) {
+    pNode = (cameraNode *)ellFirst(cameraList);
+    while (pNode) {
+      pOther = pNode->pCamera;
+      if ((pOther != this) && (pOther->pDevice == this->pDevice) && 
+          pOther->recordWait && !pOther->readingMemory) {
+        pOther->readingMemory = 1;
+        this->pDevice->numReading++;
+        epicsEventSignal(pOther->stopRecEventId);
+      }
+      pNode = (cameraNode *)ellNext(&pNode->node);
+    }
   }
-  
-  /* Set some initial values for other parameters */
-  status =  setStringParam (ADManufacturer, "Photron");
-  status |= setStringParam (ADModel, this->deviceName);
-  status |= setIntegerParam(ADSizeX, this->sensorWidth);
-  status |= setIntegerParam(ADSizeY, this->sensorHeight);
-  status |= setIntegerParam(ADMaxSizeX, this->sensorWidth);
-  status |= setIntegerParam(ADMaxSizeY, this->sensorHeight);
-  //
-  status |= setIntegerParam(PhotronVarChan, 1);
-  status |= setIntegerParam(PhotronMemIRIGDay, 0);
-  status |= setIntegerParam(PhotronMemIRIGHour, 0);
-  status |= setIntegerParam(PhotronMemIRIGMin, 0);
-  status |= setIntegerParam(PhotronMemIRIGSec, 0);
-  status |= setIntegerParam(PhotronMemIRIGUsec, 0);
-  status |= setIntegerParam(PhotronMemIRIGSigEx, 0);
-  
-  if (status) {
-    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
-              "%s:%s: unable to set camera parameters on camera %s\n",
-              driverName, functionName, this->cameraId);
-    return asynError;
+  epicsMutexUnlock(cameraListLock);
+  return shared;
+}
+
+
+/** Stops counting this head as reading the camera memory, and wakes the other
+  * heads once none is left. Returns the number of heads still reading.
+  */
+int Photron::releasePlayback() {
+  cameraNode *pNode;
+  int numReading;
+  
+  epicsMutexMustLock(cameraListLock);
+  if (this->readingMemory) {
+    this->readingMemory = 0;
+    this->pDevice->numReading--;
+    if (this->pDevice->numReading == 0) {
+      pNode = (cameraNode *)ellFirst(cameraList);
+      while (pNode) {
+        if ((pNode->pCamera != this) && 
+            (pNode->pCamera->pDevice == this->pDevice)) {
+          epicsEventSignal(pNode->pCamera->stopRecEventId);
+        }
+        pNode = (cameraNode *)ellNext(&pNode->node);
+      }
+    }
   }
+  numReading = this->pDevice->numReading;
+  epicsMutexUnlock(cameraListLock);
+  return numReading;
+}
+
+
+/** Returns the number of other heads reading the camera memory. Leaving 
+  * playback while it is nonzero would end their downloads.
+  */
+int Photron::otherHeadsReading() {
+  int numOther;
   
-  /* Read the current camera settings */
-  //printf("Reading camera parameters\n");
-  status = readParameters();
-  if (status) {
-    return((asynStatus)status);
-  }
+  epicsMutexMustLock(cameraListLock);
+  numOther = this->pDevice->numReading - this->readingMemory;
+  epicsMutexUnlock(cameraListLock);
+  return numOther;
+}
+
+
+/** Marks PhotronRecTask as waiting for a recording to end */
+void Photron::setRecordWait(int value) {
+  epicsMutexMustLock(cameraListLock);
+  this->recordWait = value;
+  epicsMutexUnlock(cameraListLock);
+}
+
+
+/** Releases the camera memory and waits for the other heads to finish reading
+  * it, so the camera can leave playback. Called on PhotronRecTask with the 
+  * lock held; a stop request ends the wait.
+  */
+void Photron::waitForOtherHeads() {
+  int waiting = 0;
   
-  /* We found the camera. Everything is OK. Signal to asynManager that we are 
-     connected. */
-  status = pasynManager->exceptionConnect(this->pasynUserSelf);
-  if (status) {
-    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
-      "%s:%s: error calling pasynManager->exceptionConnect, error=%s\n",
-      driverName, functionName, pasynUserSelf->errorMessage);
-    return asynError;
+  while ((this->releasePlayback() > 0) && !this->stopRecFlag) {
+    if (!waiting) {
+      printf("Waiting for the other heads to finish reading the recording\n");
+      waiting = 1;
+    }
+    this->unlock();
+    epicsEventWaitWithTimeout(this->stopRecEventId, PHOTRON_POLL_MAX);
+    this->lock();
   }
-  asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW, 
-    "%s:%s: Camera connected; camera id: %ld\n", driverName,
-    functionName, this->cameraId);
-  return asynSuccess;
 }
 
 
@@ -1384,28 +2846,233 @@ asynStatus Photron::getCameraInfo() {
 }
 
 asynStatus Photron::readImage() {
-  int status = asynSuccess;
-  //
+  sdkCommand_t cmd;
+  int bin, binSum;
+  static const char *functionName = "readImage";
+
+  getIntegerParam(PhotronLiveBin, &bin);
+  getIntegerParam(PhotronLiveBinMode, &binSum);
+
+  /* The SDK thread reads the image into a transfer buffer and copies it into
+   * a new NDArray. The port lock isn't needed for that. */
+  cmd.type = SDK_CMD_LIVE_IMAGE;
+  this->unlock();
+  this->sdkExecute(&cmd, SDK_PRIORITY_NORMAL);
+  if (cmd.status == asynSuccess) {
+    this->correctImage(cmd.pImage);
+    cmd.pImage = binLiveImage(cmd.pImage, bin, binSum);
+  }
+  this->lock();
+  if (cmd.status != asynSuccess) {
+    return asynError;
+  }
+  this->liveGrabbed++;
+  setIntegerParam(PhotronLiveGrabbed, this->liveGrabbed);
+  storeLiveImage(cmd.pImage);
+  
+  return asynSuccess;
+}
+
+
+/** Takes the newest frame grabbed by PhotronGrabTask, waiting for one if 
+  * there is none, and starts the grabber if it isn't running. Frames the 
+  * grabber replaced before they were taken are counted as dropped. Must be
+  * called with the port lock held.
+  */
+asynStatus Photron::readLatestImage() {
+  NDArray *pImage;
+  int acquire;
+  
+  if (!this->liveGrabbing) {
+    this->liveGrabbing = 1;
+    this->liveStatus = asynSuccess;
+    epicsEventSignal(this->grabStartEventId);
+  }
+  
+  while (!this->liveLatest && (this->liveStatus == asynSuccess)) {
+    getIntegerParam(ADAcquire, &acquire);
+    if (!acquire) {
+      return asynError;
+    }
+    this->unlock();
+    epicsEventWaitWithTimeout(this->liveFrameEventId, 0.1);
+    this->lock();
+  }
+  if (!this->liveLatest) {
+    return asynError;
+  }
+  pImage = this->liveLatest;
+  this->liveLatest = NULL;
+  storeLiveImage(pImage);
+  
+  return asynSuccess;
+}
+
+
+/** Bins a corrected live frame bin x bin into a smaller array for viewing,
+  * with block means or, with sum, block sums (8-bit frames then become 
+  * 16-bit). Releases pImage and returns the binned frame, or returns pImage
+  * itself if bin is 1 or there is no free buffer. Doesn't need the port lock.
+  */
+NDArray *Photron::binLiveImage(NDArray *pImage, int bin, int sum) {
+  NDArray *pBinned;
+  NDDataType_t dataType;
+  size_t dims[2];
+  int dim;
+  static const char *functionName = "binLiveImage";
+  
+  dims[0] = pImage->dims[0].size / bin;
+  dims[1] = pImage->dims[1].size / bin;
+  if ((bin <= 1) || (dims[0] < 1) || (dims[1] < 1)) {
+    return pImage;
+  }
+  dataType = (sum || (pImage->dataType == NDUInt16)) ? NDUInt16 : NDUInt8;
+  pBinned = this->pNDArrayPool->alloc(2, dims, dataType, 0, NULL);
+  if (!pBinned) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: error allocating buffer\n", driverName, functionName);
+    return pImage;
+  }
+  for (dim=0; dim<2; dim++) {
+    pBinned->dims[dim].offset = pImage->dims[dim].offset;
+    pBinned->dims[dim].binning = pImage->dims[dim].binning * bin;
+  }
+  
+  if (pImage->dataType == NDUInt16) {
+    photronBin16((const epicsUInt16 *)pImage->pData, pImage->dims[0].size,
+                 pImage->dims[1].size, bin, !sum, 
+                 (epicsUInt16 *)pBinned->pData);
+  } else if (sum) {
+    photronBinSum8((const epicsUInt8 *)pImage->pData, pImage->dims[0].size,
+                   pImage->dims[1].size, bin, (epicsUInt16 *)pBinned->pData);
+  } else {
+    photronBin8((const epicsUInt8 *)pImage->pData, pImage->dims[0].size,
+                pImage->dims[1].size, bin, (epicsUInt8 *)pBinned->pData);
+  }
+  pImage->release();
+  return pBinned;
+}
+
+
+/** Makes a live frame the driver's current array, ready for the callbacks.
+  * Must be called with the port lock held.
+  */
+void Photron::storeLiveImage(NDArray *pImage) {
+  NDArrayInfo_t arrayInfo;
+  int colorMode = NDColorModeMono;
+  
+  /* We save the most recent image buffer so it can be used in the read() 
+   * function. Now release it before getting a new version. */
+  if (this->pArrays[0]) 
+    this->pArrays[0]->release();
+  
+  this->pArrays[0] = pImage;
+  pImage->pAttributeList->add("ColorMode", "Color mode", NDAttrInt32, 
+                              &colorMode);
+  pImage->getInfo(&arrayInfo);
+  setIntegerParam(NDArraySize,  (int)arrayInfo.totalBytes);
+  setIntegerParam(NDArraySizeX, (int)pImage->dims[0].size);
+  setIntegerParam(NDArraySizeY, (int)pImage->dims[1].size);
+  
+  this->livePublished++;
+  setIntegerParam(PhotronLivePublished, this->livePublished);
+}
+
+
+static void PhotronGrabTaskC(void *drvPvt) {
+  Photron *pPvt = (Photron *)drvPvt;
+  pPvt->PhotronGrabTask();
+}
+
+/** Grabs live frames back to back while live acquisition runs with 
+  * PhotronLiveDelivery set, independently of how fast the plugins take 
+  * them. Only the newest frame is kept for PhotronTask; a frame it hasn't
+  * taken yet is dropped when the next one arrives. Each frame is time 
+  * stamped when its transfer completes, so the stamps don't include the 
+  * time it waited for PhotronTask. Started by readLatestImage.
+  */
+void Photron::PhotronGrabTask() {
+  sdkCommand_t cmd;
+  int acquire, delivery;
+  int bin, binSum;
+  epicsTimeStamp grabTime, grabTS;
+  
+  this->lock();
+  
+  /* Loop forever */
+  while (1) {
+    this->unlock();
+    epicsEventWait(this->grabStartEventId);
+    this->lock();
+    
+    while (1) {
+      getIntegerParam(ADAcquire, &acquire);
+      getIntegerParam(PhotronLiveDelivery, &delivery);
+      if (!acquire || !delivery) {
+        break;
+      }
+      getIntegerParam(PhotronLiveBin, &bin);
+      getIntegerParam(PhotronLiveBinMode, &binSum);
+      
+      /* The SDK thread reads the image into a new NDArray */
+      cmd.type = SDK_CMD_LIVE_IMAGE;
+      this->unlock();
+      this->sdkExecute(&cmd, SDK_PRIORITY_NORMAL);
+      epicsTimeGetCurrent(&grabTime);
+      this->lock();
+      updateTimeStamp(&grabTS);
+      this->unlock();
+      if (cmd.status == asynSuccess) {
+        this->correctImage(cmd.pImage);
+        cmd.pImage = binLiveImage(cmd.pImage, bin, binSum);
+        cmd.pImage->timeStamp = grabTime.secPastEpoch + grabTime.nsec / 1.e9;
+        cmd.pImage->epicsTS = grabTS;
+      }
+      this->lock();
+      if (cmd.status != asynSuccess) {
+        this->liveStatus = asynError;
+        epicsEventSignal(this->liveFrameEventId);
+        break;
+      }
+      
+      this->liveGrabbed++;
+      setIntegerParam(PhotronLiveGrabbed, this->liveGrabbed);
+      if (this->liveLatest) {
+        this->liveLatest->release();
+        this->liveDropped++;
+        setIntegerParam(PhotronLiveDropped, this->liveDropped);
+      }
+      this->liveLatest = cmd.pImage;
+      epicsEventSignal(this->liveFrameEventId);
+    }
+    
+    // A frame left over when acquisition stops is never published
+    if (this->liveLatest) {
+      this->liveLatest->release();
+      this->liveLatest = NULL;
+    }
+    this->liveGrabbing = 0;
+  }
+}
+
+
+/** Reads a live image on the SDK thread. The geometry, pixel format and 
+  * transfer buffers are only changed by this thread, so they can be used 
+  * without the port lock.
+  */
+asynStatus Photron::readLiveImage(sdkCommand_t *pCmd) {
   int sizeX, sizeY;
   size_t dims[2];
-  double gain;
-  //
   NDArray *pImage;
-  NDArrayInfo_t arrayInfo;
-  int colorMode = NDColorModeMono;
-  //
   unsigned long nRet;
   unsigned long nErrorCode;
-  void *pBuf;  /* Memory sequence pointer for storing a live image */
-  //
+  void *pBuf;  /* Transfer buffer for storing a live image */
   NDDataType_t dataType;
   int pixelSize;
   size_t dataSize;
-  static const char *functionName = "readImage";
-
-  getIntegerParam(ADSizeX,  &sizeX);
-  getIntegerParam(ADSizeY,  &sizeY);
-  getDoubleParam (ADGain,   &gain);
+  static const char *functionName = "readLiveImage";
+  
+  pCmd->pImage = NULL;
   
   if (this->pixelBits == 8) {
     // 8 bits
@@ -1420,22 +3087,27 @@ asynStatus Photron::readImage() {
   //printf("sizeof(epicsUInt8) = %d\n", sizeof(epicsUInt8));
   //printf("sizeof(epicsUInt16) = %d\n", sizeof(epicsUInt16));
   
+  sizeX = this->width;
+  sizeY = this->height;
   dataSize = sizeX * sizeY * pixelSize;
-  pBuf = malloc(dataSize);
+  
+  // The transfer buffers are sized for the camera's current resolution
+  pBuf = this->transferBuf[0];
+  if (!pBuf || (dataSize > this->transferBufSize)) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: transfer buffer too small (%lu < %lu bytes)\n", 
+              driverName, functionName, (unsigned long)this->transferBufSize,
+              (unsigned long)dataSize);
+    return asynError;
+  }
   
   nRet = PDC_GetLiveImageData(this->nDeviceNo, this->nChildNo,
                               this->pixelBits,
                               pBuf, &nErrorCode);
   if (nRet == PDC_FAILED) {
     printf("PDC_GetLiveImageData Failed. Error %d\n", nErrorCode);
-    free(pBuf);
     return asynError;
   }
-
-  /* We save the most recent image buffer so it can be used in the read() 
-   * function. Now release it before getting a new version. */
-  if (this->pArrays[0]) 
-    this->pArrays[0]->release();
   
   /* Allocate the raw buffer */
   dims[0] = sizeX;
@@ -1448,18 +3120,144 @@ asynStatus Photron::readImage() {
   }
   
   memcpy(pImage->pData, pBuf, dataSize);
+  pCmd->pImage = pImage;
   
-  this->pArrays[0] = pImage;
-  pImage->pAttributeList->add("ColorMode", "Color mode", NDAttrInt32, 
-                              &colorMode);
-  pImage->getInfo(&arrayInfo);
-  setIntegerParam(NDArraySize,  (int)arrayInfo.totalBytes);
-  setIntegerParam(NDArraySizeX, (int)pImage->dims[0].size);
-  setIntegerParam(NDArraySizeY, (int)pImage->dims[1].size);
+  return asynSuccess;
+}
 
-  free(pBuf);
+
+/** Sizes the SDK transfer buffers for the larger of the live and memory
+  * geometries. The buffers are only rebuilt when that size changes, so the 
+  * live loop does not allocate memory in steady state.
+  */
+asynStatus Photron::resizeTransferBuffers() {
+  size_t size, memSize;
+  int index;
+  static const char *functionName = "resizeTransferBuffers";
   
-  return asynSuccess;
+  // Images are transferred with at most 2 bytes per pixel
+  size = this->width * this->height * 2;
+  memSize = this->memWidth * this->memHeight * 2;
+  if (memSize > size) {
+    size = memSize;
+  }
+  
+  if (size == this->transferBufSize) {
+    return asynSuccess;
+  }
+  
+  // Only the SDK thread uses the buffers, so they can be replaced here
+  for (index=0; index<NUM_TRANSFER_BUFFERS; index++) {
+    transferBufFree(this->transferBuf[index]);
+    this->transferBuf[index] = transferBufAlloc(size);
+    if (!this->transferBuf[index]) {
+      asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                "%s:%s: error allocating %lu byte transfer buffer\n",
+                driverName, functionName, (unsigned long)size);
+      size = 0;
+    }
+    this->transferBufAllocs++;
+  }
+  this->transferBufSize = size;
+  
+  setIntegerParam(PhotronTransferBufAllocs, this->transferBufAllocs);
+  setIntegerParam(PhotronTransferBufSize, (int)this->transferBufSize);
+  
+  return (size == 0) ? asynError : asynSuccess;
+}
+
+
+/** Discards the IRIG times of the previous recording and makes room for the
+  * frames first..last. The table is only used by the SDK thread.
+  */
+void Photron::resetIRIGTable(long first, long last) {
+  static const char *functionName = "resetIRIGTable";
+  
+  free(this->irigTable);
+  this->irigTable = NULL;
+  this->irigTableFirst = first;
+  this->irigTableSize = 0;
+  
+  if (last < first) {
+    return;
+  }
+  this->irigTable = (irigEntry_t *)calloc(last - first + 1, sizeof(irigEntry_t));
+  if (!this->irigTable) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: error allocating IRIG table for %ld frames\n",
+              driverName, functionName, last - first + 1);
+    return;
+  }
+  this->irigTableSize = last - first + 1;
+}
+
+
+/** Fills the IRIG table for the IRIG_PREFETCH_FRAMES frames starting at frame,
+  * irigStride frames apart to match a strided readout. Called before 
+  * PDC_GetMemImageDataStart, since the SDK isn't known to accept other calls
+  * while an image transfer is open. The first call of a readout fetches a 
+  * whole chunk; after that the window only advances by one frame per 
+  * transfer.
+  */
+void Photron::prefetchIRIG(long frame) {
+  unsigned long nRet, nErrorCode;
+  long offset, last, index;
+  PDC_IRIG_INFO tData;
+  irigEntry_t *pEntry;
+  
+  offset = frame - this->irigTableFirst;
+  if ((offset < 0) || (offset >= this->irigTableSize)) {
+    return;
+  }
+  last = offset + IRIG_PREFETCH_FRAMES * this->irigStride;
+  if (last > this->irigTableSize) {
+    last = this->irigTableSize;
+  }
+  for (index=offset; index<last; index+=this->irigStride) {
+    pEntry = &(this->irigTable[index]);
+    if (pEntry->loaded) {
+      continue;
+    }
+    nRet = PDC_GetMemIRIGData(this->nDeviceNo, this->nChildNo,
+                              this->irigTableFirst + index, &tData, &nErrorCode);
+    if (nRet == PDC_FAILED) {
+      printf("PDC_GetMemIRIGData Error %d; index = %ld\n", nErrorCode,
+             this->irigTableFirst + index);
+      break;
+    }
+    pEntry->microSecond = (epicsUInt32)tData.m_nMicroSecond;
+    pEntry->dayOfYear = (epicsUInt16)tData.m_nDayOfYear;
+    pEntry->hour = (epicsUInt8)tData.m_nHour;
+    pEntry->minute = (epicsUInt8)tData.m_nMinute;
+    pEntry->second = (epicsUInt8)tData.m_nSecond;
+    pEntry->existSignal = (epicsUInt8)tData.m_ExistSignal;
+    pEntry->loaded = 1;
+  }
+}
+
+
+/** Copies the IRIG time of frame out of the table. Returns 0 if it has not
+  * been fetched.
+  */
+int Photron::lookupIRIG(long frame, PDC_IRIG_INFO *pData) {
+  long offset = frame - this->irigTableFirst;
+  irigEntry_t *pEntry;
+  
+  if ((offset < 0) || (offset >= this->irigTableSize)) {
+    return 0;
+  }
+  pEntry = &(this->irigTable[offset]);
+  if (!pEntry->loaded) {
+    return 0;
+  }
+  memset(pData, 0, sizeof(PDC_IRIG_INFO));
+  pData->m_nDayOfYear = pEntry->dayOfYear;
+  pData->m_nHour = pEntry->hour;
+  pData->m_nMinute = pEntry->minute;
+  pData->m_nSecond = pEntry->second;
+  pData->m_nMicroSecond = pEntry->microSecond;
+  pData->m_ExistSignal = pEntry->existSignal;
+  return 1;
 }
 
 
@@ -1473,12 +3271,40 @@ asynStatus Photron::writeFloat64(asynUser *pasynUser, epicsFloat64 value)
 {
     asynStatus status = asynSuccess;
     int function = pasynUser->reason;
-    double tempVal;
+    sdkCommand_t cmd;
     static const char *functionName = "writeFloat64";
     
     /* Set the value in the parameter library.  This may change later but that's OK */
     status = setDoubleParam(function, value);
     
+    /* Make the camera changes on the SDK thread */
+    cmd.type = SDK_CMD_WRITE_FLOAT64;
+    cmd.pasynUser = pasynUser;
+    cmd.function = function;
+    cmd.dvalue = value;
+    cmd.refresh = PHOTRON_REFRESH_STATUS;
+    status = sdkExecute(&cmd, SDK_PRIORITY_NORMAL);
+    
+    asynPrint(pasynUser, ASYN_TRACEIO_DRIVER, 
+              "%s::%s function=%d, value=%f, status=%d\n",
+              driverName, functionName, function, value, status);
+    
+    /* Read the camera parameters this write can change and do callbacks */
+    sdkRefresh(cmd.refresh);
+    
+    return status;
+}
+
+
+/** The part of writeFloat64 that changes camera settings; runs on the SDK 
+  * thread on behalf of writeFloat64, which holds the port lock. */
+asynStatus Photron::writeFloat64Camera(sdkCommand_t *pCmd)
+{
+    asynStatus status = asynSuccess;
+    int function = pCmd->function;
+    epicsFloat64 value = pCmd->dvalue;
+    double tempVal;
+    
     if (function == ADAcquireTime) {
       // setRecordRate already does what we want
       if (value == 0.0) {
@@ -1488,17 +3314,60 @@ asynStatus Photron::writeFloat64(asynUser *pasynUser, epicsFloat64 value)
         tempVal = 1.0 / value;
       }
       setRecordRate((int)tempVal, 0);
+      pCmd->refresh = PHOTRON_REFRESH_MODE | PHOTRON_REFRESH_RATE;
     } else {
       /* If this parameter belongs to a base class call its method */
-      if (function < FIRST_PHOTRON_PARAM) status = ADDriver::writeFloat64(pasynUser, value);
+      if (function < FIRST_PHOTRON_PARAM) status = ADDriver::writeFloat64(pCmd->pasynUser, value);
     }
     
-    asynPrint(pasynUser, ASYN_TRACEIO_DRIVER, 
-              "%s::%s function=%d, value=%f, status=%d\n",
-              driverName, functionName, function, value, status);
+    return status;
+}
+
+/** Called when asyn clients call pasynOctet->write(). Setting 
+  * PhotronCheckpointFile looks for a readout to resume in that file, 
+  * PhotronCorrFile loads the correction maps saved in that file, and
+  * PhotronReadoutRanges is checked before the next readout uses it. */
+asynStatus Photron::writeOctet(asynUser *pasynUser, const char *value, 
+                               size_t nChars, size_t *nActual)
+{
+    asynStatus status;
+    int function = pasynUser->reason;
+    readoutCheckpoint_t saved;
+    readoutRange_t ranges[MAX_READOUT_RANGES];
+    char spec[MAX_RANGES_STRING];
+    int numRanges;
     
-    /* Read the camera parameters and do callbacks */
-    readParameters();
+    /* The base class stores the string and does the callbacks */
+    status = ADDriver::writeOctet(pasynUser, value, nChars, nActual);
+    
+    if (function == PhotronReadoutRanges) {
+      getStringParam(PhotronReadoutRanges, sizeof(spec), spec);
+      status = parseReadoutRanges(spec, 1, ranges, &numRanges);
+    }
+    
+    if (function == PhotronCheckpointFile) {
+      if (loadCheckpoint(&saved) == asynSuccess) {
+        printf("Readout of frames %d to %d can be resumed at frame %d\n",
+               saved.rangeStart, saved.rangeEnd, saved.frame + 1);
+        setIntegerParam(PhotronResumeFrame, saved.frame + 1);
+        setIntegerParam(PhotronResumeValid, 1);
+      } else {
+        setIntegerParam(PhotronResumeValid, 0);
+      }
+      callParamCallbacks();
+    }
+    
+    if (function == PhotronCorrFile) {
+      epicsMutexMustLock(this->corrMutex);
+      getStringParam(PhotronCorrFile, sizeof(this->corrFile), this->corrFile);
+      if (this->corrFile[0]) {
+        loadCorrMaps();
+      }
+      setIntegerParam(PhotronCorrDarkValid, this->corrDarkValid);
+      setIntegerParam(PhotronCorrFlatValid, this->corrFlatValid);
+      epicsMutexUnlock(this->corrMutex);
+      callParamCallbacks();
+    }
     
     return status;
 }
@@ -1511,9 +3380,10 @@ asynStatus Photron::writeFloat64(asynUser *pasynUser, epicsFloat64 value)
 asynStatus Photron::writeInt32(asynUser *pasynUser, epicsInt32 value) {
   int function = pasynUser->reason;
   int status = asynSuccess;
-  int adstatus, acqMode, chan, syncPulse;
-  int index;
+  int priority;
   int skipReadParams = 0;
+  int refresh = PHOTRON_REFRESH_ALL;
+  sdkCommand_t cmd;
   epicsInt32 oldValue;
   epicsInt32 phostat, functionToAllow, functionToReject;
   static const char *functionName = "writeInt32";
@@ -1533,7 +3403,9 @@ asynStatus Photron::writeInt32(asynUser *pasynUser, epicsInt32 value) {
   // Determine if function is one of the preview-mode functions
   // NOTE: The ranges are carefully chosed so that PhotronPMPlayFPS, 
   //       PhotronPMPlayMult and PhotronPMRepeat can be changed at any time
-  functionToAllow = ((function >= PhotronPMStart) && (function <= PhotronPMRepeat));
+  functionToAllow = ((function >= PhotronPMStart) && (function <= PhotronPMRepeat)) ||
+                    (function == PhotronIndexThumbFrame) ||
+                    (function == PhotronPMPlayDepth);
   functionToReject = ((function >= PhotronPMStart) && (function <= PhotronPMCancel));
   
   if ((phostat == PDC_STATUS_SAVE) || (phostat == PDC_STATUS_LOAD) || (this->forceWait == 1)) {
@@ -1560,23 +3432,103 @@ asynStatus Photron::writeInt32(asynUser *pasynUser, epicsInt32 value) {
     // Revert requested change
     setIntegerParam(function, oldValue);
     skipReadParams = 1;
-  } else if ((function == ADBinX) || (function == ADBinY) || (function == ADMinX) ||
+  } else {
+    cmd.type = SDK_CMD_WRITE_INT32;
+    cmd.pasynUser = pasynUser;
+    cmd.function = function;
+    cmd.value = value;
+    cmd.oldValue = oldValue;
+    cmd.refresh = PHOTRON_REFRESH_ALL;
+    cmd.skipReadParams = 0;
+    if (functionToAllow) {
+      // The preview-mode functions release the port lock in readMemImage, so
+      // they run here and queue their own transfers
+      status |= writeInt32Camera(&cmd);
+    } else {
+      // Triggering and stopping go ahead of other queued SDK commands
+      if ((function == ADAcquire) || (function == PhotronSoftTrig) || 
+          (function == PhotronLiveMode)) {
+        priority = SDK_PRIORITY_HIGH;
+      } else {
+        priority = SDK_PRIORITY_NORMAL;
+      }
+      status |= sdkExecute(&cmd, priority);
+    }
+    refresh = cmd.refresh;
+    skipReadParams = cmd.skipReadParams;
+  }
+  
+  // see if returning before calling param callbacks helps restore last good value
+  /*if (status != asynSuccess) {
+    return asynError;
+  }*/
+  
+  if (skipReadParams == 1) {
+    // Don't call readParameters() for PVs that can be changed during preview
+    // Calling readParameters here results in locking issues
+    setIntegerParam(PhotronRefreshCalls, 0);
+    callParamCallbacks();
+  } else {
+    // Only read the camera parameters this write can change, then do callbacks
+    status |= sdkRefresh(refresh);
+  }
+  
+  if (status) 
+    asynPrint(pasynUser, ASYN_TRACE_ERROR, 
+              "%s:%s: error, status=%d function=%d, value=%d\n", 
+              driverName, functionName, status, function, value);
+  else        
+    asynPrint(pasynUser, ASYN_TRACEIO_DRIVER, 
+              "%s:%s: function=%d, value=%d\n",
+              driverName, functionName, function, value);
+  return((asynStatus)status);
+}
+
+
+/** The part of writeInt32 that changes camera settings. Runs on the SDK thread
+  * on behalf of writeInt32, which holds the port lock, except for the 
+  * preview-mode functions. Sets pCmd->refresh to the PHOTRON_REFRESH_* groups
+  * the write can change.
+  */
+asynStatus Photron::writeInt32Camera(sdkCommand_t *pCmd) {
+  asynUser *pasynUser = pCmd->pasynUser;
+  int function = pCmd->function;
+  epicsInt32 value = pCmd->value;
+  epicsInt32 oldValue = pCmd->oldValue;
+  int status = asynSuccess;
+  int adstatus, acqMode, chan, syncPulse;
+  int index;
+  int skipReadParams = 0;
+  int refresh = PHOTRON_REFRESH_ALL;
+  
+  if ((function == ADBinX) || (function == ADBinY) || (function == ADMinX) ||
      (function == ADMinY)) {
     /* These commands change the chip readout geometry.  We need to cache them 
      * and apply them in the correct order */
     //printf("calling setGeometry. function=%d, value=%d\n", function, value);
     status |= setGeometry();
+    refresh = PHOTRON_REFRESH_RATE;
   } else if (function == ADSizeX) {
     status |= setValidWidth(value);
+    refresh = PHOTRON_REFRESH_RATE;
   } else if (function == ADSizeY) {
     status |= setValidHeight(value);
+    refresh = PHOTRON_REFRESH_RATE;
   } else if (function == PhotronResIndex) {
     status |= setResolution(value);
+    refresh = PHOTRON_REFRESH_RATE;
   } else if (function == PhotronChangeResIdx) {
     status |= changeResIndex(value);
+    refresh = PHOTRON_REFRESH_RATE;
   } else if (function == ADAcquire) {
+    // Starting or stopping only changes the camera status
+    refresh = PHOTRON_REFRESH_STATUS;
     getIntegerParam(PhotronAcquireMode, &acqMode);
     getIntegerParam(ADStatus, &adstatus);
+    if (!value && (adstatus == ADStatusReadout)) {
+      // Stop the readout in progress. A resumed readout runs in live mode.
+      this->abortFlag = 1;
+    }
     if (acqMode == 0) {
       // For Live mode, signal the PhotronTask
       if (value && (adstatus == ADStatusIdle)) {
@@ -1589,6 +3541,7 @@ asynStatus Photron::writeInt32(asynUser *pasynUser, epicsInt32 value) {
         /* This was a command to stop acquisition */
         /* Send the stop event */
         epicsEventSignal(this->stopEventId);
+        epicsEventSignal(this->liveFrameEventId);
       }
     } else {
       // For Record mode
@@ -1597,8 +3550,9 @@ asynStatus Photron::writeInt32(asynUser *pasynUser, epicsInt32 value) {
         softwareTrigger();
         setIntegerParam(ADAcquire, 1);
       } else {
-        // Ignore the stop request if status == waiting
-        if (adstatus != ADStatusWaiting) {
+        // Ignore the stop request if status == waiting, which a failed 
+        // readout reports as an error
+        if ((adstatus != ADStatusWaiting) && (adstatus != ADStatusError)) {
           // Stop current (or next) readout
           this->abortFlag = 1;
           setIntegerParam(ADAcquire, 0);
@@ -1613,6 +3567,7 @@ asynStatus Photron::writeInt32(asynUser *pasynUser, epicsInt32 value) {
     }
   } else if (function == NDDataType) {
     status = setPixelFormat();
+    refresh = PHOTRON_REFRESH_PIXEL;
   } else if (function == PhotronAcquireMode) {
     // should the acquire state be checked?
     if (value == 0) {
@@ -1667,48 +3622,66 @@ asynStatus Photron::writeInt32(asynUser *pasynUser, epicsInt32 value) {
     changeVariableChannel(value);
   } else if (function == PhotronVarEditRate) {
     setVariableRecordRate(value);
+    refresh = PHOTRON_REFRESH_STATUS;
   } else if (function == PhotronChangeVarEditRate) {
     changeVariableRecordRate(value);
+    refresh = PHOTRON_REFRESH_STATUS;
   } else if (function == PhotronVarChanApply) {
     applyVariableChannel();
   } else if (function == PhotronVarChanErase) {
     eraseVariableChannel();
   } else if (function == PhotronVarEditXSize) {
     setVariableXSize(value);
+    refresh = PHOTRON_REFRESH_STATUS;
   } else if (function == PhotronVarEditYSize) {
     setVariableYSize(value);
+    refresh = PHOTRON_REFRESH_STATUS;
   } else if (function == PhotronVarEditXPos) {
     setVariableXPos(value);
+    refresh = PHOTRON_REFRESH_STATUS;
   } else if (function == PhotronVarEditYPos) {
     setVariableYPos(value);
+    refresh = PHOTRON_REFRESH_STATUS;
   } else if (function == PhotronChangeVarEditXSize) {
     changeVariableXSize(value);
+    refresh = PHOTRON_REFRESH_STATUS;
   } else if (function == PhotronChangeVarEditYSize) {
     changeVariableYSize(value);
+    refresh = PHOTRON_REFRESH_STATUS;
   } else if (function == PhotronChangeVarEditXPos) {
     changeVariableXPos(value);
+    refresh = PHOTRON_REFRESH_STATUS;
   } else if (function == PhotronChangeVarEditYPos) {
     changeVariableYPos(value);
+    refresh = PHOTRON_REFRESH_STATUS;
   } else if (function == PhotronVarEditMaxRes) {
     setVariableMaxRes();
+    refresh = PHOTRON_REFRESH_STATUS;
   } else if (function == Photron8BitSel) {
     /* Specifies the bit position during 8-bit transfer from a device of more 
        than 8 bits. */
     setTransferOption();
+    refresh = PHOTRON_REFRESH_STATUS;
   } else if (function == PhotronRecRate) {
     setRecordRate(value, 0);
+    refresh = PHOTRON_REFRESH_MODE | PHOTRON_REFRESH_RATE;
   } else if (function == PhotronChangeRecRate) {
     changeRecordRate(value);
+    refresh = PHOTRON_REFRESH_MODE | PHOTRON_REFRESH_RATE;
   } else if (function == PhotronShutterFps) {
     setShutterSpeedFps(value);
+    refresh = PHOTRON_REFRESH_SHUTTER;
   } else if (function == PhotronChangeShutterFps) {
     changeShutterSpeedFps(value);
+    refresh = PHOTRON_REFRESH_SHUTTER;
   } else if (function == PhotronJumpShutterFps) {
     jumpShutterSpeedFps(value);
+    refresh = PHOTRON_REFRESH_SHUTTER;
   } else if (function == PhotronStatus) {
     setStatus(value);
   } else if (function == PhotronSoftTrig) {
     //printf("Soft Trigger changed. value = %d\n", value);
+    refresh = PHOTRON_REFRESH_STATUS;
     if (value == 1) {
       softwareTrigger();
     } else {
@@ -1722,12 +3695,15 @@ asynStatus Photron::writeInt32(asynUser *pasynUser, epicsInt32 value) {
     if (value == 1) {
       setLive();
     }
+    refresh = PHOTRON_REFRESH_STATUS;
   } else if ((function == ADTriggerMode) || (function == PhotronAfterFrames) ||
             (function == PhotronRandomFrames) || (function == PhotronRecCount)) {
     //printf("function = %d\n", function);
     setTriggerMode();
+    refresh = PHOTRON_REFRESH_TRIGGER;
   } else if (function == PhotronPreviewMode) {
     // Do nothing
+    refresh = PHOTRON_REFRESH_STATUS;
   } else if (function == PhotronPMIndex) {
     // grab and display an image from memory
     setPMIndex(value);
@@ -1798,6 +3774,14 @@ asynStatus Photron::writeInt32(asynUser *pasynUser, epicsInt32 value) {
       setIntegerParam(PhotronPMPlayFPS, 1);
     }
     skipReadParams = 1;
+  } else if (function == PhotronPMPlayDepth) {
+    // Takes effect as the playback ring is refilled
+    if (value < 1) {
+      setIntegerParam(PhotronPMPlayDepth, 1);
+    } else if (value > MAX_PLAY_DEPTH) {
+      setIntegerParam(PhotronPMPlayDepth, MAX_PLAY_DEPTH);
+    }
+    skipReadParams = 1;
   } else if (function == PhotronPMPlayMult) {
     if (value < 1) {
       setIntegerParam(PhotronPMPlayMult, 1);
@@ -1821,30 +3805,46 @@ asynStatus Photron::writeInt32(asynUser *pasynUser, epicsInt32 value) {
     epicsEventSignal(this->resumeRecEventId);
     skipReadParams = 1;
   } else if (function == PhotronIRIG) {
+    // IRIG can limit the available recording rates
     setIRIG(value);
+    refresh = PHOTRON_REFRESH_IRIG | PHOTRON_REFRESH_MODE | PHOTRON_REFRESH_RATE;
   } else if (function == PhotronSyncPriority) {
     setSyncPriority(value);
+    refresh = PHOTRON_REFRESH_IRIG | PHOTRON_REFRESH_EXTIO;
   } else if (function == PhotronExtIn1Sig) {
     setExternalInMode(1, value);
+    // Sync input changes the camera mode and recording rate
+    refresh = PHOTRON_REFRESH_EXTIO | PHOTRON_REFRESH_MODE | PHOTRON_REFRESH_RATE;
   } else if (function == PhotronExtIn2Sig) {
     setExternalInMode(2, value);
+    // Sync input changes the camera mode and recording rate
+    refresh = PHOTRON_REFRESH_EXTIO | PHOTRON_REFRESH_MODE | PHOTRON_REFRESH_RATE;
   } else if (function == PhotronExtIn3Sig) {
     setExternalInMode(3, value);
+    // Sync input changes the camera mode and recording rate
+    refresh = PHOTRON_REFRESH_EXTIO | PHOTRON_REFRESH_MODE | PHOTRON_REFRESH_RATE;
   } else if (function == PhotronExtIn4Sig) {
     setExternalInMode(4, value);
+    // Sync input changes the camera mode and recording rate
+    refresh = PHOTRON_REFRESH_EXTIO | PHOTRON_REFRESH_MODE | PHOTRON_REFRESH_RATE;
   } else if (function == PhotronExtOut1Sig) {
     setExternalOutMode(1, value);
+    refresh = PHOTRON_REFRESH_EXTIO;
   } else if (function == PhotronExtOut2Sig) {
     setExternalOutMode(2, value);
+    refresh = PHOTRON_REFRESH_EXTIO;
   } else if (function == PhotronExtOut3Sig) {
     setExternalOutMode(3, value);
+    refresh = PHOTRON_REFRESH_EXTIO;
   } else if (function == PhotronExtOut4Sig) {
     setExternalOutMode(4, value);
+    refresh = PHOTRON_REFRESH_EXTIO;
   } else if (function == PhotronShadingMode) {
     // Only allow shading to be changed in live mode
     getIntegerParam(PhotronAcquireMode, &acqMode);
     if (acqMode == 0) {
       setShadingMode(value);
+      refresh = PHOTRON_REFRESH_SHADING;
     } else {
       // Restore the old value
       setIntegerParam(function, oldValue);
@@ -1852,6 +3852,158 @@ asynStatus Photron::writeInt32(asynUser *pasynUser, epicsInt32 value) {
     }
   } else if (function == PhotronBurstTrans) {
     setBurstTransfer(value);
+    refresh = PHOTRON_REFRESH_TRANSFER;
+  } else if ((function == PhotronRawEnable) || (function == PhotronRawDirectIO) ||
+             (function == PhotronStripedReadout)) {
+    // Used when the next memory readout starts
+    skipReadParams = 1;
+  } else if (function == PhotronReadoutStride) {
+    if (value < 1) {
+      setIntegerParam(PhotronReadoutStride, 1);
+    }
+    skipReadParams = 1;
+  } else if ((function == PhotronEventPreFrames) || 
+             (function == PhotronEventPostFrames)) {
+    if (value < 0) {
+      setIntegerParam(function, 0);
+    }
+    skipReadParams = 1;
+  } else if (function == PhotronEventReadout) {
+    // Used when the next memory readout starts
+    skipReadParams = 1;
+  } else if ((function == PhotronReadoutMinX) || 
+             (function == PhotronReadoutMinY) ||
+             (function == PhotronReadoutSizeX) || 
+             (function == PhotronReadoutSizeY)) {
+    // Limited to the memory frame size when the next readout starts
+    if (value < 0) {
+      setIntegerParam(function, 0);
+    }
+    skipReadParams = 1;
+  } else if (function == PhotronReadoutFormat) {
+    // Used when the next memory readout starts
+    skipReadParams = 1;
+  } else if (function == PhotronReadoutShift) {
+    // The 8-bit window is bits shift to shift+7 of the 12-bit pixels
+    if (value < 0) {
+      setIntegerParam(PhotronReadoutShift, 0);
+    } else if (value > 8) {
+      setIntegerParam(PhotronReadoutShift, 8);
+    }
+    skipReadParams = 1;
+  } else if (function == PhotronCorrEnable) {
+    this->corrEnable = value;
+    this->corrWarned = 0;
+    skipReadParams = 1;
+  } else if ((function == PhotronCorrCaptureDark) || 
+             (function == PhotronCorrCaptureFlat)) {
+    // The next PhotronCorrFrames frames are averaged, uncorrected, into the
+    // map; a put of 0 cancels the capture
+    epicsMutexMustLock(this->corrMutex);
+    free(this->corrSum);
+    this->corrSum = NULL;
+    this->corrCapture = 0;
+    if (value) {
+      this->corrCapture = (function == PhotronCorrCaptureDark) ? 
+                          CORR_CAPTURE_DARK : CORR_CAPTURE_FLAT;
+      getIntegerParam(PhotronCorrFrames, &(this->corrCaptureFrames));
+      this->corrCaptureCount = 0;
+    }
+    epicsMutexUnlock(this->corrMutex);
+    setIntegerParam(PhotronCorrCaptureDark, 
+                    this->corrCapture == CORR_CAPTURE_DARK);
+    setIntegerParam(PhotronCorrCaptureFlat, 
+                    this->corrCapture == CORR_CAPTURE_FLAT);
+    skipReadParams = 1;
+  } else if (function == PhotronAttrSnapshot) {
+    // Used when the next memory readout starts
+    skipReadParams = 1;
+  } else if (function == PhotronReadoutWorkers) {
+    // Threads are started by the next memory readout
+    if (value < 1) {
+      setIntegerParam(PhotronReadoutWorkers, 1);
+    } else if (value > MAX_READOUT_WORKERS) {
+      setIntegerParam(PhotronReadoutWorkers, MAX_READOUT_WORKERS);
+    }
+    skipReadParams = 1;
+  } else if (function == PhotronPreviewCacheSize) {
+    if (value < 0) {
+      setIntegerParam(PhotronPreviewCacheSize, 0);
+    } else if (value > MAX_PREVIEW_CACHE) {
+      setIntegerParam(PhotronPreviewCacheSize, MAX_PREVIEW_CACHE);
+    }
+    clearPreviewCache();
+    skipReadParams = 1;
+  } else if (function == PhotronIndexStride) {
+    // Used by the next index
+    if (value < 1) {
+      setIntegerParam(PhotronIndexStride, 1);
+    }
+    skipReadParams = 1;
+  } else if (function == PhotronIndexBin) {
+    if (value < 1) {
+      setIntegerParam(PhotronIndexBin, 1);
+    } else if (value > 64) {
+      setIntegerParam(PhotronIndexBin, 64);
+    }
+    skipReadParams = 1;
+  } else if (function == PhotronIndexEnable) {
+    skipReadParams = 1;
+  } else if (function == PhotronLiveDelivery) {
+    // PhotronTask switches at its next frame
+    skipReadParams = 1;
+  } else if (function == PhotronLiveBin) {
+    if (value < 1) {
+      setIntegerParam(PhotronLiveBin, 1);
+    } else if (value > 8) {
+      setIntegerParam(PhotronLiveBin, 8);
+    }
+    skipReadParams = 1;
+  } else if (function == PhotronLiveBinMode) {
+    skipReadParams = 1;
+  } else if (function == PhotronIndexThumbFrame) {
+    publishIndexThumb();
+    skipReadParams = 1;
+  } else if (function == PhotronPreviewReadAhead) {
+    if (value < 0) {
+      setIntegerParam(PhotronPreviewReadAhead, 0);
+    }
+    skipReadParams = 1;
+  } else if (function == PhotronCorrFrames) {
+    if (value < 1) {
+      setIntegerParam(PhotronCorrFrames, 1);
+    }
+    skipReadParams = 1;
+  } else if (function == PhotronCorrThreads) {
+    if (value < 1) {
+      value = 1;
+    } else if (value > MAX_CORR_THREADS) {
+      value = MAX_CORR_THREADS;
+    }
+    setIntegerParam(PhotronCorrThreads, value);
+    this->corrThreads = value;
+    skipReadParams = 1;
+  } else if (function == PhotronResumeReadout) {
+    // Entering record mode would clear the camera memory, so an interrupted
+    // readout is resumed from live mode
+    getIntegerParam(PhotronAcquireMode, &acqMode);
+    getIntegerParam(PhotronResumeValid, &index);
+    if (value && (acqMode == 0) && index) {
+      this->resumeFlag = 1;
+      epicsEventSignal(this->startRecEventId);
+    } else if (value) {
+      printf("No readout to resume, or not in live mode\n");
+    }
+    setIntegerParam(PhotronResumeReadout, 0);
+    skipReadParams = 1;
+  } else if (function == PhotronReadoutDepth) {
+    // Number of transferred frames that may wait for the plugins
+    if (value < 1) {
+      setIntegerParam(PhotronReadoutDepth, 1);
+    } else if (value > MAX_READOUT_DEPTH) {
+      setIntegerParam(PhotronReadoutDepth, MAX_READOUT_DEPTH);
+    }
+    skipReadParams = 1;
   } else if (function == PhotronTest) {
     // Set status to asynSuccess if value is divisible by 4, asynError otherwise
     if ((value % 4) == 0) {
@@ -1868,30 +4020,12 @@ asynStatus Photron::writeInt32(asynUser *pasynUser, epicsInt32 value) {
   } else {
     /* If this is not a parameter we have handled call the base class */
     status = ADDriver::writeInt32(pasynUser, value);
+    // The base class parameters don't change the camera settings
+    refresh = PHOTRON_REFRESH_STATUS;
   }
   
-  // see if returning before calling param callbacks helps restore last good value
-  /*if (status != asynSuccess) {
-    return asynError;
-  }*/
-  
-  if (skipReadParams == 1) {
-    // Don't call readParameters() for PVs that can be changed during preview
-    // Calling readParameters here results in locking issues
-    callParamCallbacks();
-  } else {
-    // Read the camera parameters and do callbacks
-    status |= readParameters();
-  }
-  
-  if (status) 
-    asynPrint(pasynUser, ASYN_TRACE_ERROR, 
-              "%s:%s: error, status=%d function=%d, value=%d\n", 
-              driverName, functionName, status, function, value);
-  else        
-    asynPrint(pasynUser, ASYN_TRACEIO_DRIVER, 
-              "%s:%s: function=%d, value=%d\n",
-              driverName, functionName, function, value);
+  pCmd->refresh = refresh;
+  pCmd->skipReadParams = skipReadParams;
   return((asynStatus)status);
 }
 
@@ -2298,6 +4432,10 @@ asynStatus Photron::softwareTrigger() {
       printf("PDC_TriggerIn failed. error = %d\n", nErrorCode);
       return asynError;
     }
+    
+    // Wake the status monitor so it sees the recording start right away
+    this->recPollPeriod = PHOTRON_POLL_MIN;
+    epicsEventSignal(this->stopRecEventId);
   } else {
     printf("Ignoring software trigger\n");
   }
@@ -2314,6 +4452,11 @@ asynStatus Photron::setRecReady() {
   
   status = getIntegerParam(PhotronAcquireMode, &acqMode);
   
+  if (this->otherHeadsReading()) {
+    printf("Other heads are reading the recording; not setting rec ready\n");
+    return asynError;
+  }
+  
   // Only set rec ready if in record mode
   if (acqMode == 1) {
     nRet = PDC_SetRecReady(nDeviceNo, &nErrorCode);
@@ -2390,6 +4533,11 @@ asynStatus Photron::setLive() {
   
   status = getIntegerParam(PhotronAcquireMode, &acqMode);
   
+  if (this->otherHeadsReading()) {
+    printf("Other heads are reading the recording; not setting live\n");
+    return asynError;
+  }
+  
   // Put the camera in live mode
   nRet = PDC_SetStatus(this->nDeviceNo, PDC_STATUS_LIVE, &nErrorCode);
   if (nRet == PDC_FAILED) {
@@ -2400,10 +4548,45 @@ asynStatus Photron::setLive() {
   setIntegerParam(ADStatus, ADStatusIdle);
   callParamCallbacks();
   
+  // Wake the status monitor so it sees the end of recording right away
+  this->recPollPeriod = PHOTRON_POLL_MIN;
+  epicsEventSignal(this->stopRecEventId);
+  
   return status;
 }
 
 
+/** Returns the expected time (seconds) between the start of recording and 
+  * the camera returning to live, based on the trigger mode. Used by the 
+  * status monitor to decide when to poll quickly.
+  */
+double Photron::expectedRecordTime() {
+  double frames;
+  
+  if (this->nRate == 0) {
+    return 0.0;
+  }
+  
+  switch (this->triggerMode) {
+    case PDC_TRIGGER_CENTER:
+      frames = this->nMaxFrames / 2.0;
+      break;
+    case PDC_TRIGGER_END:
+      frames = 0.0;
+      break;
+    case PDC_TRIGGER_MANUAL:
+      frames = this->trigAFrames;
+      break;
+    default:
+      // The whole memory is an upper bound for the other modes
+      frames = this->nMaxFrames;
+      break;
+  }
+  
+  return frames / this->nRate;
+}
+
+
 asynStatus Photron::setIRIG(epicsInt32 value) {
   asynStatus status = asynSuccess;
   unsigned long nRet, nErrorCode;
@@ -2572,13 +4755,16 @@ asynStatus Photron::setPlayback() {
   
   status = getIntegerParam(PhotronAcquireMode, &acqMode);
   
-  // Only set playback if in record mode
-  if (acqMode == 1) {
-    // Put the camera in playback mode
-    nRet = PDC_SetStatus(this->nDeviceNo, PDC_STATUS_PLAYBACK, &nErrorCode);
-    if (nRet == PDC_FAILED) {
-      printf("PDC_SetStatus failed. error = %d\n", nErrorCode);
-      return asynError;
+  // Only set playback if in record mode or resuming a readout
+  if ((acqMode == 1) || this->resumeFlag) {
+    // Put the camera in playback mode, unless another head already did
+    if (!this->claimPlayback()) {
+      nRet = PDC_SetStatus(this->nDeviceNo, PDC_STATUS_PLAYBACK, &nErrorCode);
+      if (nRet == PDC_FAILED) {
+        printf("PDC_SetStatus failed. error = %d\n", nErrorCode);
+        this->releasePlayback();
+        return asynError;
+      }
     }
     
     // Confirm that the camera is in playback mode
@@ -2623,14 +4809,20 @@ asynStatus Photron::readMem() {
   
   // Zero image counter
   setIntegerParam(ADNumImagesCounter, 0);
+  
+  // Frames cached and indexed for the previous recording are stale
+  clearPreviewCache();
+  this->indexGeneration++;
+  this->indexCount = 0;
+  publishIndex();
   callParamCallbacks();
   
   // Save the image counter (user can reset it whenever they want)
   getIntegerParam(NDArrayCounter, &(this->NDArrayCounterBackup));
   
-  // Only read memory if in record mode
+  // Only read memory if in record mode (or resuming a readout)
   // AND status is playback
-  if (acqMode == 1) {
+  if ((acqMode == 1) || this->resumeFlag) {
     if (phostat == PDC_STATUS_PLAYBACK) {
       // Retrieves frame information 
       nRet = PDC_GetMemFrameInfo(this->nDeviceNo, this->nChildNo, &FrameInfo,
@@ -2653,6 +4845,7 @@ asynStatus Photron::readMem() {
       printf("\tEvent count:\t%d\n", FrameInfo.m_nEventCount);
       printf("\tRecorded Frames:\t%d\n", FrameInfo.m_nRecordedFrames);
       this->FrameInfo = FrameInfo;
+      setIntegerParam(PhotronEventCount, FrameInfo.m_nEventCount);
       
       setIntegerParam(PhotronFrameStart, FrameInfo.m_nStart);
       setIntegerParam(PhotronFrameEnd, FrameInfo.m_nEnd);
@@ -2670,6 +4863,7 @@ asynStatus Photron::readMem() {
       printf("Memory Resolution: %d x %d\n", memWidth, memHeight);
       this->memWidth = memWidth;
       this->memHeight = memHeight;
+      resizeTransferBuffers();
       
       // PDC_GetMemRecordRate
       nRet = PDC_GetMemRecordRate(this->nDeviceNo, this->nChildNo, &memRate,
@@ -2710,6 +4904,11 @@ asynStatus Photron::readMem() {
         setIntegerParam(PhotronMemIRIGSigEx, 0);
       }
       this->tMode = tMode;
+      if (this->tMode == 1) {
+        resetIRIGTable(FrameInfo.m_nStart, FrameInfo.m_nEnd);
+      } else {
+        resetIRIGTable(0, -1);
+      }
       
       // Retrieve frame time
       if (this->tMode == 1) {
@@ -2847,7 +5046,7 @@ asynStatus Photron::changePMIndex(epicsInt32 value) {
 asynStatus Photron::readMemImage(epicsInt32 value) {
   asynStatus status = asynSuccess;
   int transferBitDepth;
-  unsigned long nRet, nErrorCode;
+  sdkCommand_t cmd;
   PDC_IRIG_INFO tData;
   double tRel, tStart, tNow;
   //
@@ -2855,12 +5054,11 @@ asynStatus Photron::readMemImage(epicsInt32 value) {
   NDArrayInfo_t arrayInfo;
   int colorMode = NDColorModeMono;
   //
-  void *pBuf;  /* Memory sequence pointer for storing a live image */
-  //
   NDDataType_t dataType;
   int pixelSize;
   size_t dims[2];
-  size_t dataSize;
+  int slot, generation;
+  int stamp = 1;
   //
   int imageCounter;
   int numImagesCounter;
@@ -2887,28 +5085,85 @@ asynStatus Photron::readMemImage(epicsInt32 value) {
   }
   
   transferBitDepth = 8 * pixelSize;
-  dataSize = this->memWidth * this->memHeight * pixelSize;
-  pBuf = malloc(dataSize);
   
   epicsTimeGetCurrent(&startTime);
   
-  // Retrieve a frame
-  nRet = PDC_GetMemImageData(this->nDeviceNo, this->nChildNo, value,
-                             transferBitDepth, pBuf, &nErrorCode);
-  if (nRet == PDC_FAILED) {
-    printf("PDC_GetMemImageData Error %d\n", nErrorCode);
-  } else {
-    printf("PDC_GetMemImageData Succeeded\n");
+  // Note the direction of travel for the read-ahead
+  if ((this->previewLastIndex >= 0) && (value != this->previewLastIndex)) {
+    this->previewDirection = (value > this->previewLastIndex) ? 1 : -1;
   }
-    
-  // Retrieve frame time
-  if (this->tMode == 1) {
-    nRet = PDC_GetMemIRIGData(this->nDeviceNo, this->nChildNo, value,
-                              &tData, &nErrorCode);
-    if (nRet == PDC_FAILED) {
-      printf("PDC_GetMemIRIGData Error %d\n", nErrorCode);
+  this->previewLastIndex = value;
+  
+  // Wait for the read-ahead if it is transferring this frame
+  while (this->previewFetching == value) {
+    this->unlock();
+    epicsEventWaitWithTimeout(this->previewDoneEventId, 0.1);
+    this->lock();
+  }
+  
+  // The counters the frame would have if saved with the current settings
+  getIntegerParam(PhotronPMStart, &start);
+  imageCounter = this->NDArrayCounterBackup + value - start;
+  
+  slot = findPreviewFrame(value, 1);
+  if ((slot >= 0) && this->previewCache[slot].published && 
+      (this->previewCache[slot].pImage->uniqueId != imageCounter)) {
+    /* Shown before PMStart changed; plugins may hold the array, so it 
+     * can't be stamped again. Read the frame again instead. */
+    this->previewCache[slot].pImage->release();
+    this->previewCache[slot].pImage = NULL;
+    slot = -1;
+  }
+  this->previewLookups++;
+  if (slot >= 0) {
+    /* Publish the cached array itself. A frame read ahead is stamped the
+     * first time it is shown; after that plugins may hold it, so it is 
+     * published again as it is. */
+    this->previewHits++;
+    pImage = this->previewCache[slot].pImage;
+    pImage->reserve();
+    tData = this->previewCache[slot].tData;
+    stamp = !this->previewCache[slot].published;
+    this->previewCache[slot].published = 1;
+  } else {
+    /* Allocate the raw buffer; the SDK transfers the frame directly into it */
+    dims[0] = memWidth;
+    dims[1] = memHeight;
+    pImage = this->pNDArrayPool->alloc(2, dims, dataType, 0, NULL);
+    if (!pImage) {
+      asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                "%s:%s: error allocating buffer\n", driverName, functionName);
+      return(asynError);
     }
     
+    // Retrieve a frame and its time without holding the port lock
+    memset(&tData, 0, sizeof(tData));
+    generation = this->previewGeneration;
+    cmd.type = SDK_CMD_MEM_IMAGE;
+    cmd.arg = value;
+    cmd.bitDepth = transferBitDepth;
+    cmd.pData = pImage->pData;
+    cmd.pIRIG = (this->tMode == 1) ? &tData : NULL;
+    cmd.roiWidth = 0;
+    cmd.format = READOUT_FORMAT_NATIVE;
+    this->unlock();
+    this->sdkExecute(&cmd, SDK_PRIORITY_NORMAL);
+    this->lock();
+    
+    // The cache shares the array unless the memory was read again meanwhile
+    if ((cmd.status == asynSuccess) && 
+        (generation == this->previewGeneration)) {
+      pImage->reserve();
+      storePreviewFrame(value, pImage, &tData, 1);
+    }
+  }
+  setDoubleParam(PhotronPreviewHitRate, 
+                 100.0 * this->previewHits / this->previewLookups);
+  
+  // Read the next frames in the background
+  epicsEventSignal(this->previewEventId);
+  
+  if (this->tMode == 1) {
     setIntegerParam(PhotronMemIRIGDay, tData.m_nDayOfYear);
     setIntegerParam(PhotronMemIRIGHour, tData.m_nHour);
     setIntegerParam(PhotronMemIRIGMin, tData.m_nMinute);
@@ -2922,21 +5177,7 @@ asynStatus Photron::readMemImage(epicsInt32 value) {
   if (this->pArrays[0]) 
     this->pArrays[0]->release();
   
-  /* Allocate the raw buffer */
-  dims[0] = memWidth;
-  dims[1] = memHeight;
-  pImage = this->pNDArrayPool->alloc(2, dims, dataType, 0, NULL);
-  if (!pImage) {
-    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
-              "%s:%s: error allocating buffer\n", driverName, functionName);
-    return(asynError);
-  }
-  
-  memcpy(pImage->pData, pBuf, dataSize);
-  
   this->pArrays[0] = pImage;
-  pImage->pAttributeList->add("ColorMode", "Color mode", NDAttrInt32, 
-                              &colorMode);
   pImage->getInfo(&arrayInfo);
   setIntegerParam(NDArraySize,  (int)arrayInfo.totalBytes);
   setIntegerParam(NDArraySizeX, (int)pImage->dims[0].size);
@@ -2947,35 +5188,38 @@ asynStatus Photron::readMemImage(epicsInt32 value) {
   
   // Get the current parameters
   getIntegerParam(NDArrayCallbacks, &arrayCallbacks);
-  getIntegerParam(PhotronPMStart, &start);
   
   // Set the image counters during playback to the values they would have
   // if the frames were saved with the current settings
-  imageCounter = this->NDArrayCounterBackup + value - start;
   setIntegerParam(NDArrayCounter, imageCounter);
   numImagesCounter = value - start;
   setIntegerParam(ADNumImagesCounter, numImagesCounter);
   
-  /* Put the frame number and time stamp into the buffer */
-  pImage->uniqueId = imageCounter;
-  if (tMode == 1) {
-    // Absolute time
-    //irigSeconds = (((((tData.m_nDayOfYear * 24) + tData.m_nHour) * 60) + tData.m_nMinute) * 60) + tData.m_nSecond;
-    //pImage->timeStamp = (this->postIRIGStartTime).secPastEpoch + irigSeconds + (this->postIRIGStartTime).nsec / 1.e9 + tData.m_nMicroSecond / 1.e6;
-    // Relative time
-    this->timeDataToSec(&tData, &tNow);
-    this->timeDataToSec(&(this->tDataStart), &tStart);
-    tRel = tNow - tStart;
-    pImage->timeStamp = tRel;
-  }
-  else {
-    // Use theoretical time
-    pImage->timeStamp = 1.0 * value / this->memRate;
+  /* Put the frame number and time stamp into the buffer, unless the 
+   * plugins may already hold it */
+  if (stamp) {
+    pImage->pAttributeList->add("ColorMode", "Color mode", NDAttrInt32, 
+                                &colorMode);
+    pImage->uniqueId = imageCounter;
+    if (tMode == 1) {
+      // Absolute time
+      //irigSeconds = (((((tData.m_nDayOfYear * 24) + tData.m_nHour) * 60) + tData.m_nMinute) * 60) + tData.m_nSecond;
+      //pImage->timeStamp = (this->postIRIGStartTime).secPastEpoch + irigSeconds + (this->postIRIGStartTime).nsec / 1.e9 + tData.m_nMicroSecond / 1.e6;
+      // Relative time
+      this->timeDataToSec(&tData, &tNow);
+      this->timeDataToSec(&(this->tDataStart), &tStart);
+      tRel = tNow - tStart;
+      pImage->timeStamp = tRel;
+    }
+    else {
+      // Use theoretical time
+      pImage->timeStamp = 1.0 * value / this->memRate;
+    }
+    updateTimeStamp(&pImage->epicsTS);
+    
+    /* Get any attributes that have been defined for this driver */
+    this->getAttributes(pImage->pAttributeList);
   }
-  updateTimeStamp(&pImage->epicsTS);
-  
-  /* Get any attributes that have been defined for this driver */
-  this->getAttributes(pImage->pAttributeList);
 
   if (arrayCallbacks) {
     /* Call the NDArray callback */
@@ -2989,40 +5233,686 @@ asynStatus Photron::readMemImage(epicsInt32 value) {
     this->lock();
   }
   
-  free(pBuf);
-  printf("Returning...\n");
-  return asynSuccess;
+  printf("Returning...\n");
+  return asynSuccess;
+}
+
+
+
+
+/** Returns the cache slot holding a memory frame, or -1. A frame cached 
+  * before the bit depth or size of the memory images changed is dropped.
+  * With touch the frame becomes the most recently used. Must be called with
+  * the port lock held.
+  */
+int Photron::findPreviewFrame(long frame, int touch) {
+  NDArray *pImage;
+  NDDataType_t dataType = (this->pixelBits == 8) ? NDUInt8 : NDUInt16;
+  int slot;
+  
+  for (slot=0; slot<MAX_PREVIEW_CACHE; slot++) {
+    pImage = this->previewCache[slot].pImage;
+    if (pImage && (this->previewCache[slot].frame == frame)) {
+      if ((pImage->dataType != dataType) || 
+          (pImage->dims[0].size != (size_t)this->memWidth) ||
+          (pImage->dims[1].size != (size_t)this->memHeight)) {
+        pImage->release();
+        this->previewCache[slot].pImage = NULL;
+        return -1;
+      }
+      if (touch) {
+        this->previewCache[slot].lastUse = ++this->previewUseCount;
+      }
+      return slot;
+    }
+  }
+  return -1;
+}
+
+
+/** Adds a frame to the preview cache, which takes over the reference to 
+  * pImage. published is set if the array has been passed to the plugins.
+  * The least recently used frame is dropped when PhotronPreviewCacheSize 
+  * frames are already cached. Must be called with the port lock held.
+  */
+void Photron::storePreviewFrame(long frame, NDArray *pImage, 
+                                PDC_IRIG_INFO *pData, int published) {
+  previewEntry_t *pEntry, *pFree = NULL, *pSame = NULL, *pOldest = NULL;
+  int cacheSize, cached = 0;
+  int slot;
+  
+  getIntegerParam(PhotronPreviewCacheSize, &cacheSize);
+  if (cacheSize <= 0) {
+    pImage->release();
+    return;
+  }
+  for (slot=0; slot<MAX_PREVIEW_CACHE; slot++) {
+    pEntry = &(this->previewCache[slot]);
+    if (!pEntry->pImage) {
+      if (!pFree) {
+        pFree = pEntry;
+      }
+      continue;
+    }
+    cached++;
+    if (pEntry->frame == frame) {
+      pSame = pEntry;
+    }
+    if (!pOldest || (pEntry->lastUse < pOldest->lastUse)) {
+      pOldest = pEntry;
+    }
+  }
+  
+  // Replace the same frame, else use a free slot until the cache is full
+  if (pSame) {
+    pEntry = pSame;
+  } else if (pFree && (cached < cacheSize)) {
+    pEntry = pFree;
+    cached++;
+  } else {
+    pEntry = pOldest;
+  }
+  if (pEntry->pImage) {
+    pEntry->pImage->release();
+  }
+  pEntry->frame = frame;
+  pEntry->pImage = pImage;
+  pEntry->tData = *pData;
+  pEntry->lastUse = ++this->previewUseCount;
+  pEntry->published = published;
+  setIntegerParam(PhotronPreviewCached, cached);
+}
+
+
+/** Drops every cached preview frame. Frames the read-ahead is transferring
+  * are discarded when they arrive. Must be called with the port lock held.
+  */
+void Photron::clearPreviewCache() {
+  int slot;
+  
+  for (slot=0; slot<MAX_PREVIEW_CACHE; slot++) {
+    if (this->previewCache[slot].pImage) {
+      this->previewCache[slot].pImage->release();
+      this->previewCache[slot].pImage = NULL;
+    }
+  }
+  this->previewGeneration++;
+  this->previewLastIndex = -1;
+  this->previewLookups = 0.0;
+  this->previewHits = 0.0;
+  setIntegerParam(PhotronPreviewCached, 0);
+  setDoubleParam(PhotronPreviewHitRate, 0.0);
+}
+
+
+/** Returns the next frame to read ahead of the preview index, or -1 if the
+  * PhotronPreviewReadAhead frames in the direction of travel are cached. 
+  * One cache slot is left for the frame being shown.
+  */
+long Photron::nextPreviewFrame() {
+  int cacheSize, readAhead, start, end;
+  long frame;
+  int k;
+  
+  getIntegerParam(PhotronPreviewCacheSize, &cacheSize);
+  getIntegerParam(PhotronPreviewReadAhead, &readAhead);
+  getIntegerParam(PhotronPMStart, &start);
+  getIntegerParam(PhotronPMEnd, &end);
+  if (readAhead > cacheSize - 1) {
+    readAhead = cacheSize - 1;
+  }
+  if (this->previewLastIndex < 0) {
+    return -1;
+  }
+  for (k=1; k<=readAhead; k++) {
+    frame = this->previewLastIndex + k * this->previewDirection;
+    if ((frame < start) || (frame > end)) {
+      break;
+    }
+    if (findPreviewFrame(frame, 0) < 0) {
+      return frame;
+    }
+  }
+  return -1;
+}
+
+
+static void PhotronPreviewTaskC(void *drvPvt) {
+  Photron *pPvt = (Photron *)drvPvt;
+  pPvt->PhotronPreviewTask();
+}
+
+/** Reads the frames ahead of the preview index into the preview cache, in 
+  * the direction it last moved, so that stepping through a recording is 
+  * served from memory. Frames are transferred at low priority, so a 
+  * requested frame that isn't cached goes first. Woken by readMemImage.
+  */
+void Photron::PhotronPreviewTask() {
+  sdkCommand_t cmd;
+  PDC_IRIG_INFO tData;
+  NDArray *pImage;
+  NDDataType_t dataType;
+  size_t dims[2];
+  long frame;
+  int generation;
+  static const char *functionName = "PhotronPreviewTask";
+  
+  this->lock();
+  
+  /* Loop forever */
+  while (1) {
+    frame = nextPreviewFrame();
+    if (frame < 0) {
+      this->unlock();
+      epicsEventWait(this->previewEventId);
+      this->lock();
+      continue;
+    }
+    
+    dataType = (this->pixelBits == 8) ? NDUInt8 : NDUInt16;
+    dims[0] = this->memWidth;
+    dims[1] = this->memHeight;
+    pImage = this->pNDArrayPool->alloc(2, dims, dataType, 0, NULL);
+    if (!pImage) {
+      asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW,
+                "%s:%s: no buffer to read frame %ld ahead\n", 
+                driverName, functionName, frame);
+      this->unlock();
+      epicsEventWait(this->previewEventId);
+      this->lock();
+      continue;
+    }
+    
+    memset(&tData, 0, sizeof(tData));
+    generation = this->previewGeneration;
+    this->previewFetching = frame;
+    cmd.type = SDK_CMD_MEM_IMAGE;
+    cmd.arg = frame;
+    cmd.bitDepth = (dataType == NDUInt8) ? 8 : 16;
+    cmd.pData = pImage->pData;
+    cmd.pIRIG = (this->tMode == 1) ? &tData : NULL;
+    cmd.roiWidth = 0;
+    cmd.format = READOUT_FORMAT_NATIVE;
+    this->unlock();
+    this->sdkExecute(&cmd, SDK_PRIORITY_LOW);
+    this->lock();
+    this->previewFetching = -1;
+    epicsEventSignal(this->previewDoneEventId);
+    
+    if ((cmd.status == asynSuccess) && 
+        (generation == this->previewGeneration)) {
+      storePreviewFrame(frame, pImage, &tData, 0);
+      callParamCallbacks();
+    } else {
+      pImage->release();
+      if (cmd.status != asynSuccess) {
+        // Don't retry until the index moves again
+        this->unlock();
+        epicsEventWait(this->previewEventId);
+        this->lock();
+      }
+    }
+  }
+}
+
+static void PhotronIndexTaskC(void *drvPvt) {
+  Photron *pPvt = (Photron *)drvPvt;
+  pPvt->PhotronIndexTask();
+}
+
+/** Builds the thumbnail index of each recording that is previewed. Woken 
+  * by PhotronRecTask when preview mode starts.
+  */
+void Photron::PhotronIndexTask() {
+  this->lock();
+  
+  /* Loop forever */
+  while (1) {
+    this->unlock();
+    epicsEventWait(this->indexEventId);
+    this->lock();
+    buildIndex();
+  }
+}
+
+
+/** Transfers every PhotronIndexStride'th frame of the recording and keeps 
+  * a thumbnail binned PhotronIndexBin x PhotronIndexBin and the mean 
+  * intensity of each. The stride is raised if the thumbnails would take more
+  * than MAX_INDEX_BYTES or there would be more than MAX_INDEX_POINTS. The 
+  * frames are transferred at low SDK priority, behind the preview frames. 
+  * Stops when the readout starts or readMem loads another recording. Must 
+  * be called with the port lock held.
+  */
+asynStatus Photron::buildIndex() {
+  asynStatus status = asynSuccess;
+  sdkCommand_t cmd;
+  void *pFrame;
+  epicsUInt16 *pThumbs;
+  epicsInt32 *pThumbBuf;
+  epicsTimeStamp lastPublish, now;
+  size_t width, height, thumbWidth, thumbHeight, thumbPixels;
+  long first, numFrames, maxPoints, numPoints, point;
+  int enable, stride, bin, pixelBits, generation;
+  double mean = 0.0;
+  static const char *functionName = "buildIndex";
+  
+  getIntegerParam(PhotronIndexEnable, &enable);
+  getIntegerParam(PhotronIndexStride, &stride);
+  getIntegerParam(PhotronIndexBin, &bin);
+  width = this->memWidth;
+  height = this->memHeight;
+  first = this->FrameInfo.m_nStart;
+  numFrames = this->FrameInfo.m_nEnd - first + 1;
+  if (!enable || this->previewDone || (numFrames < 1) || 
+      (width < 1) || (height < 1)) {
+    return asynSuccess;
+  }
+  generation = this->indexGeneration;
+  pixelBits = this->pixelBits;
+  
+  if (bin > (int)width) {
+    bin = width;
+  }
+  if (bin > (int)height) {
+    bin = height;
+  }
+  thumbWidth = width / bin;
+  thumbHeight = height / bin;
+  thumbPixels = thumbWidth * thumbHeight;
+  maxPoints = MAX_INDEX_BYTES / (thumbPixels * sizeof(epicsUInt16));
+  if (maxPoints > MAX_INDEX_POINTS) {
+    maxPoints = MAX_INDEX_POINTS;
+  } else if (maxPoints < 1) {
+    maxPoints = 1;
+  }
+  numPoints = (numFrames + stride - 1) / stride;
+  if (numPoints > maxPoints) {
+    stride = (numFrames + maxPoints - 1) / maxPoints;
+    numPoints = (numFrames + stride - 1) / stride;
+    printf("Indexing every %d frames to fit the thumbnails\n", stride);
+  }
+  
+  this->indexCount = 0;
+  pThumbs = (epicsUInt16 *)realloc(this->indexThumbs, 
+                                   numPoints * thumbPixels * sizeof(epicsUInt16));
+  if (pThumbs) {
+    this->indexThumbs = pThumbs;
+  }
+  pThumbBuf = (epicsInt32 *)realloc(this->indexThumbBuf, 
+                                    thumbPixels * sizeof(epicsInt32));
+  if (pThumbBuf) {
+    this->indexThumbBuf = pThumbBuf;
+  }
+  pFrame = malloc(width * height * ((pixelBits == 8) ? 1 : 2));
+  if (!pThumbs || !pThumbBuf || !pFrame) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: error allocating the index of %ld frames\n", 
+              driverName, functionName, numPoints);
+    free(pFrame);
+    return asynError;
+  }
+  this->indexThumbWidth = thumbWidth;
+  this->indexThumbHeight = thumbHeight;
+  setIntegerParam(PhotronIndexThumbWidth, (int)thumbWidth);
+  setIntegerParam(PhotronIndexThumbHeight, (int)thumbHeight);
+  setIntegerParam(PhotronIndexBusy, 1);
+  publishIndex();
+  callParamCallbacks();
+  
+  epicsTimeGetCurrent(&lastPublish);
+  for (point=0; point<numPoints; point++) {
+    cmd.type = SDK_CMD_MEM_IMAGE;
+    cmd.arg = first + point * stride;
+    cmd.bitDepth = (pixelBits == 8) ? 8 : 16;
+    cmd.pData = pFrame;
+    cmd.pIRIG = NULL;
+    cmd.roiWidth = 0;
+    cmd.format = READOUT_FORMAT_NATIVE;
+    this->unlock();
+    this->sdkExecute(&cmd, SDK_PRIORITY_LOW);
+    // Thumbnails past indexCount aren't published, so this one can be 
+    // written without the lock
+    if (cmd.status == asynSuccess) {
+      if (pixelBits == 8) {
+        mean = photronThumb8((const epicsUInt8 *)pFrame, width, height, bin,
+                             this->indexThumbs + point * thumbPixels);
+      } else {
+        mean = photronThumb16((const epicsUInt16 *)pFrame, width, height, 
+                              bin, this->indexThumbs + point * thumbPixels);
+      }
+    }
+    this->lock();
+    
+    // Stop for the readout or a new recording
+    if (this->previewDone || (generation != this->indexGeneration)) {
+      break;
+    }
+    if (cmd.status != asynSuccess) {
+      asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                "%s:%s: error reading frame %ld\n", 
+                driverName, functionName, (long)cmd.arg);
+      status = asynError;
+      break;
+    }
+    this->indexFrames[point] = cmd.arg;
+    this->indexMeans[point] = mean;
+    this->indexCount = point + 1;
+    
+    // Post the index as it grows, at most twice a second
+    epicsTimeGetCurrent(&now);
+    if (epicsTimeDiffInSeconds(&now, &lastPublish) >= 0.5) {
+      publishIndex();
+      callParamCallbacks();
+      lastPublish = now;
+    }
+  }
+  free(pFrame);
+  
+  if (generation == this->indexGeneration) {
+    publishIndex();
+  }
+  setIntegerParam(PhotronIndexBusy, 0);
+  callParamCallbacks();
+  return status;
+}
+
+
+/** Posts the indexed frame numbers and mean intensities, and the selected
+  * thumbnail. Must be called with the port lock held.
+  */
+void Photron::publishIndex() {
+  setIntegerParam(PhotronIndexPoints, this->indexCount);
+  doCallbacksInt32Array(this->indexFrames, this->indexCount, 
+                        PhotronIndexFrames, 0);
+  doCallbacksFloat64Array(this->indexMeans, this->indexCount, 
+                          PhotronIndexMean, 0);
+  publishIndexThumb();
+}
+
+
+/** Posts the thumbnail of the indexed frame nearest PhotronIndexThumbFrame.
+  * Must be called with the port lock held.
+  */
+void Photron::publishIndexThumb() {
+  size_t thumbPixels = this->indexThumbWidth * this->indexThumbHeight;
+  epicsUInt16 *pThumb;
+  int frame, stride, point;
+  size_t index;
+  
+  if ((this->indexCount < 1) || !this->indexThumbBuf) {
+    return;
+  }
+  getIntegerParam(PhotronIndexThumbFrame, &frame);
+  
+  // The indexed frames are evenly spaced
+  stride = (this->indexCount > 1) ? 
+           (this->indexFrames[1] - this->indexFrames[0]) : 1;
+  point = 0;
+  if (frame > this->indexFrames[0]) {
+    point = (frame - this->indexFrames[0] + stride / 2) / stride;
+  }
+  if (point > this->indexCount - 1) {
+    point = this->indexCount - 1;
+  }
+  
+  pThumb = this->indexThumbs + point * thumbPixels;
+  for (index=0; index<thumbPixels; index++) {
+    this->indexThumbBuf[index] = pThumb[index];
+  }
+  doCallbacksInt32Array(this->indexThumbBuf, thumbPixels, 
+                        PhotronIndexThumb, 0);
+}
+
+/** Parses a list of frame ranges such as "0-999:10, 5000-5999". Each entry 
+  * is a frame or first-last, with an optional :stride that overrides stride.
+  * The ranges must be in increasing order and must not overlap.
+  */
+asynStatus Photron::parseReadoutRanges(const char *spec, int stride, 
+                                       readoutRange_t *pRanges, 
+                                       int *pNumRanges) {
+  const char *pChar = spec;
+  char *pEnd;
+  readoutRange_t range;
+  int numRanges = 0;
+  static const char *functionName = "parseReadoutRanges";
+  
+  *pNumRanges = 0;
+  while (1) {
+    while ((*pChar == ',') || isspace((unsigned char)*pChar)) {
+      pChar++;
+    }
+    if (*pChar == 0) {
+      break;
+    }
+    if (numRanges == MAX_READOUT_RANGES) {
+      asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                "%s:%s: more than %d ranges in \"%s\"\n", driverName, 
+                functionName, MAX_READOUT_RANGES, spec);
+      return asynError;
+    }
+    
+    range.first = strtol(pChar, &pEnd, 10);
+    if (pEnd == pChar) {
+      break;
+    }
+    pChar = pEnd;
+    range.last = range.first;
+    range.stride = stride;
+    if (*pChar == '-') {
+      range.last = strtol(pChar + 1, &pEnd, 10);
+      if (pEnd == pChar + 1) {
+        break;
+      }
+      pChar = pEnd;
+    }
+    if (*pChar == ':') {
+      range.stride = strtol(pChar + 1, &pEnd, 10);
+      if ((pEnd == pChar + 1) || (range.stride < 1)) {
+        break;
+      }
+      pChar = pEnd;
+    }
+    if ((*pChar != 0) && (*pChar != ',') && !isspace((unsigned char)*pChar)) {
+      break;
+    }
+    if ((range.last < range.first) || 
+        ((numRanges > 0) && (range.first <= pRanges[numRanges-1].last))) {
+      asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                "%s:%s: ranges in \"%s\" must increase\n", driverName, 
+                functionName, spec);
+      return asynError;
+    }
+    pRanges[numRanges++] = range;
+  }
+  
+  if (*pChar != 0) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: invalid range at \"%s\"\n", driverName, functionName, 
+              pChar);
+    return asynError;
+  }
+  *pNumRanges = numRanges;
+  return asynSuccess;
+}
+
+
+/** Writes the windows of PhotronEventPreFrames before to 
+  * PhotronEventPostFrames after the trigger frame and each event frame of the
+  * recording to spec, in the PhotronReadoutRanges format. Overlapping windows
+  * are merged. Returns the number of windows.
+  */
+int Photron::makeEventRanges(char *spec, size_t size) {
+  long marks[PDC_MAX_EVENT + 1];
+  long first, last, mark;
+  int preFrames, postFrames;
+  int numMarks = 0, numWindows = 0;
+  int index, sorted;
+  size_t length = 0;
+  char *pComma;
+  
+  getIntegerParam(PhotronEventPreFrames, &preFrames);
+  getIntegerParam(PhotronEventPostFrames, &postFrames);
+  
+  marks[numMarks++] = this->FrameInfo.m_nTrigger;
+  for (index=0; (index<this->FrameInfo.m_nEventCount) && 
+                (index<PDC_MAX_EVENT); index++) {
+    marks[numMarks++] = this->FrameInfo.m_nEvent[index];
+  }
+  // The events are normally in order already
+  do {
+    sorted = 1;
+    for (index=1; index<numMarks; index++) {
+      if (marks[index] < marks[index-1]) {
+        mark = marks[index];
+        marks[index] = marks[index-1];
+        marks[index-1] = mark;
+        sorted = 0;
+      }
+    }
+  } while (!sorted);
+  
+  spec[0] = 0;
+  index = 0;
+  while (index < numMarks) {
+    first = marks[index] - preFrames;
+    last = marks[index] + postFrames;
+    // Merge the windows that overlap or touch this one
+    for (index++; (index < numMarks) && 
+                  (marks[index] - preFrames <= last + 1); index++) {
+      last = marks[index] + postFrames;
+    }
+    length += epicsSnprintf(spec + length, size - length, "%s%ld-%ld", 
+                            numWindows ? "," : "", first, last);
+    numWindows++;
+    if (length >= size) {
+      // Only keep the windows that fit
+      pComma = strrchr(spec, ',');
+      if (pComma) {
+        *pComma = 0;
+      } else {
+        spec[0] = 0;
+      }
+      numWindows--;
+      break;
+    }
+  }
+  
+  return numWindows;
+}
+
+
+/** Builds the list of frames a memory readout transfers: every stride-th 
+  * frame of start..end, or of each range in spec when it isn't empty, 
+  * limited to the recorded frames. Returns the number of frames.
+  */
+int Photron::planReadout(int start, int end, int stride, const char *spec) {
+  if ((parseReadoutRanges(spec, stride, this->readoutRanges, 
+                          &(this->numReadoutRanges)) != asynSuccess) ||
+      (this->numReadoutRanges == 0)) {
+    if (spec[0]) {
+      printf("Reading frames %d to %d instead of the ranges\n", start, end);
+    }
+    this->readoutRanges[0].first = start;
+    this->readoutRanges[0].last = end;
+    this->readoutRanges[0].stride = stride;
+    this->numReadoutRanges = 1;
+  }
+  trimReadoutRanges(this->FrameInfo.m_nStart, this->FrameInfo.m_nEnd);
+  
+  return countReadoutFrames();
+}
+
+
+/** Drops the frames of the readout plan outside first..last, keeping each 
+  * range on its stride, and ends each range on its last frame. */
+void Photron::trimReadoutRanges(long first, long last) {
+  readoutRange_t *pRange;
+  int index, numRanges = 0;
+  
+  for (index=0; index<this->numReadoutRanges; index++) {
+    pRange = &(this->readoutRanges[index]);
+    if (pRange->first < first) {
+      pRange->first += (first - pRange->first + pRange->stride - 1) / 
+                       pRange->stride * pRange->stride;
+    }
+    if (pRange->last > last) {
+      pRange->last = last;
+    }
+    if (pRange->first > pRange->last) {
+      continue;
+    }
+    pRange->last -= (pRange->last - pRange->first) % pRange->stride;
+    this->readoutRanges[numRanges++] = *pRange;
+  }
+  this->numReadoutRanges = numRanges;
 }
 
 
+/** Returns the number of frames in the readout plan */
+int Photron::countReadoutFrames() {
+  readoutRange_t *pRange;
+  int index, count = 0;
+  
+  for (index=0; index<this->numReadoutRanges; index++) {
+    pRange = &(this->readoutRanges[index]);
+    count += (pRange->last - pRange->first) / pRange->stride + 1;
+  }
+  return count;
+}
 
 
+/** Transfer stage of the memory readout. Frames are transferred from camera 
+  * memory directly into NDArrays and dealt in turn to PhotronReadoutWorkers
+  * PhotronProcessTask threads, which attach the attributes and correct them. 
+  * PhotronPublishTask collects them in order and does the plugin callbacks.
+  * Up to PhotronReadoutDepth frames can be in flight, so the camera link 
+  * stays busy while slow plugins catch up.
+  * When PhotronRawEnable is set the frames bypass the plugins and are written
+  * to the raw file by the publish stage instead. With PhotronStripedReadout 
+  * and a second interface, even and odd frames are transferred in parallel.
+  * The frames are PMStart to PMEnd, the PhotronReadoutRanges list, or the
+  * windows around the trigger and events with PhotronEventReadout, taking
+  * every PhotronReadoutStride-th frame. Only the PhotronReadoutMinX/SizeX,
+  * MinY/SizeY region of each frame is kept. 12-bit frames can be stored as
+  * 8 bits with PhotronReadoutFormat, or packed into 3 bytes per 2 pixels 
+  * when they go to a raw file.
+  * With a PhotronCheckpointFile the progress is saved as frames are 
+  * published, and a readout of the same recording skips the frames that an
+  * interrupted one already committed.
+  * Called with the lock held; returns after the last frame has been published.
+  */
 asynStatus Photron::readImageRange() {
   asynStatus status = asynSuccess;
   int index, transferBitDepth;
-  unsigned long nRet, nErrorCode;
-  PDC_IRIG_INFO tData;
+  int striped, nLinks, link, dropped;
+  int nWorkers;
+  int nBatch = 1;
+  int frameNo[MAX_READOUT_LINKS];
+  int stride, rangeIndex, numFrames, lastFrame;
+  int eventReadout, numWindows;
+  int minX, minY, sizeX, sizeY;
+  int format, shift;
+  char ranges[MAX_RANGES_STRING];
+  sdkCommand_t cmd[MAX_READOUT_LINKS];
   //
-  NDArray *pImage;
-  NDArrayInfo_t arrayInfo;
-  int colorMode = NDColorModeMono;
-  //
-  void *pBuf;  /* Memory sequence pointer for storing a live image */
+  NDArray *pNext[MAX_READOUT_LINKS];  /* Arrays the SDK transfers frames into */
+  void *pRaw[MAX_READOUT_LINKS];      /* Stream buffers used when rawEnable is set */
+  readoutFrame_t frame[MAX_READOUT_LINKS];
+  int rawEnable, directIO;
+  readoutCheckpoint_t saved;
+  readoutCheckpoint_t *pResume = NULL;
   //
   NDDataType_t dataType;
   int pixelSize;
   size_t dims[2];
   size_t dataSize;
   //
-  int imageCounter;
-  int numImages, numImagesCounter;
-  int imageMode;
-  int arrayCallbacks;
+  int depth;
   int abort = 0;
-  //double acquirePeriod, delay;
-  epicsTimeStamp startTime, endTime;
-  double elapsedTime;
-  epicsUInt32 irigSeconds;
+  int numRead = 0;
+  epicsTimeStamp endTime;
+  double elapsedTime, readoutRate;
   //
   int start, end;
   static const char *functionName = "readImageRange";
@@ -3046,154 +5936,1215 @@ asynStatus Photron::readImageRange() {
   }
   
   transferBitDepth = 8 * pixelSize;
-  dataSize = this->memWidth * this->memHeight * pixelSize;
-  pBuf = malloc(dataSize);
   
-  epicsTimeGetCurrent(&startTime);
+  // Keep only the readout ROI of each frame; a size of 0 extends to the edge
+  getIntegerParam(PhotronReadoutMinX, &minX);
+  getIntegerParam(PhotronReadoutMinY, &minY);
+  getIntegerParam(PhotronReadoutSizeX, &sizeX);
+  getIntegerParam(PhotronReadoutSizeY, &sizeY);
+  if (minX >= (int)this->memWidth) {
+    minX = 0;
+  }
+  if (minY >= (int)this->memHeight) {
+    minY = 0;
+  }
+  if ((sizeX == 0) || (sizeX > (int)this->memWidth - minX)) {
+    sizeX = this->memWidth - minX;
+  }
+  if ((sizeY == 0) || (sizeY > (int)this->memHeight - minY)) {
+    sizeY = this->memHeight - minY;
+  }
+  this->roiX = minX;
+  this->roiY = minY;
+  this->roiWidth = sizeX;
+  this->roiHeight = sizeY;
+  this->roiEnable = ((this->roiWidth != this->memWidth) || 
+                     (this->roiHeight != this->memHeight));
+  
+  getIntegerParam(PhotronRawEnable, &rawEnable);
+  getIntegerParam(PhotronRawDirectIO, &directIO);
+  
+  // Convert 12-bit frames as they leave the transfer buffer
+  getIntegerParam(PhotronReadoutFormat, &format);
+  getIntegerParam(PhotronReadoutShift, &shift);
+  if (pixelSize == 1) {
+    format = READOUT_FORMAT_NATIVE;
+  } else if ((format == READOUT_FORMAT_PACKED12) && !rawEnable) {
+    // NDArrays have no packed data type
+    printf("Packed 12-bit frames are only written to raw files; "
+           "reading out 16-bit frames\n");
+    format = READOUT_FORMAT_NATIVE;
+  }
+  if (format != READOUT_FORMAT_8BIT) {
+    shift = 0;
+  }
+  this->readoutFormat = format;
+  this->readoutShift = shift;
+  
+  if (format == READOUT_FORMAT_8BIT) {
+    dataType = NDUInt8;
+    dataSize = this->roiWidth * this->roiHeight;
+  } else if (format == READOUT_FORMAT_PACKED12) {
+    dataSize = PACKED12_BYTES(this->roiWidth) * this->roiHeight;
+  } else {
+    dataSize = this->roiWidth * this->roiHeight * pixelSize;
+  }
+  dims[0] = this->roiWidth;
+  dims[1] = this->roiHeight;
+  
+  epicsTimeGetCurrent(&(this->readoutStartTime));
   
   getIntegerParam(PhotronPMStart, &start);
   getIntegerParam(PhotronPMEnd, &end);
+  getIntegerParam(PhotronReadoutStride, &stride);
+  getIntegerParam(PhotronEventReadout, &eventReadout);
+  if (eventReadout) {
+    // Only the frames around the trigger and the recorded events
+    numWindows = makeEventRanges(ranges, sizeof(ranges));
+    printf("Reading %d windows around the trigger and %ld events: %s\n",
+           numWindows, this->FrameInfo.m_nEventCount, ranges);
+  } else {
+    getStringParam(PhotronReadoutRanges, sizeof(ranges), ranges);
+  }
+  if (stride < 1) {
+    stride = 1;
+  }
+  numFrames = planReadout(start, end, stride, ranges);
+  if (numFrames == 0) {
+    printf("No recorded frames to read\n");
+    return asynError;
+  }
+  lastFrame = this->readoutRanges[this->numReadoutRanges - 1].last;
   
   // TODO: Catch random trigger modes, see if fewer than the specified
   // number of recordings have occurred, then omit the first acquisition
   
-  // Preload the first frame
-  nRet = PDC_GetMemImageDataStart(this->nDeviceNo, this->nChildNo, start,
-                                  transferBitDepth, pBuf, &nErrorCode);
-  if (nRet == PDC_FAILED) {
-    printf("PDC_GetMemImageDataStart Error %d; index = %d\n", nErrorCode, start);
+  // With the second interface connected, alternate frames are transferred
+  // over both links at once and queued in frame order
+  getIntegerParam(PhotronStripedReadout, &striped);
+  nLinks = (striped && this->linkOpen) ? 2 : 1;
+  
+  // Describe this readout, then check for an interrupted readout of the same
+  // recording that went to the same place
+  getStringParam(PhotronCheckpointFile, sizeof(this->checkpointFile), 
+                 this->checkpointFile);
+  initCheckpoint(&(this->checkpoint));
+  this->checkpoint.rangeStart = start;
+  this->checkpoint.rangeEnd = end;
+  this->checkpoint.stride = stride;
+  strcpy(this->checkpoint.ranges, ranges);
+  this->checkpoint.roiX = this->roiX;
+  this->checkpoint.roiY = this->roiY;
+  this->checkpoint.roiWidth = this->roiWidth;
+  this->checkpoint.roiHeight = this->roiHeight;
+  this->checkpoint.format = format;
+  this->checkpoint.shift = shift;
+  this->checkpoint.frame = this->readoutRanges[0].first - 1;
+  this->checkpoint.raw = rawEnable;
+  this->checkpoint.rawDirectIO = directIO;
+  getStringParam(PhotronRawFile, sizeof(this->checkpoint.rawFile), 
+                 this->checkpoint.rawFile);
+  if (this->checkpointFile[0] && (loadCheckpoint(&saved) == asynSuccess) &&
+      matchCheckpoint(&saved) && (saved.frame >= this->readoutRanges[0].first) &&
+      (saved.frame < lastFrame) && (saved.stride == stride) && 
+      !strcmp(saved.ranges, ranges) && (saved.roiX == this->roiX) &&
+      (saved.roiY == this->roiY) && (saved.roiWidth == this->roiWidth) &&
+      (saved.roiHeight == this->roiHeight) && (saved.format == format) &&
+      (saved.shift == shift) && (saved.raw == rawEnable) && 
+      (!rawEnable || ((saved.rawDirectIO == directIO) && 
+                      !strcmp(saved.rawFile, this->checkpoint.rawFile)))) {
+    trimReadoutRanges(saved.frame + 1, lastFrame);
+    numFrames = countReadoutFrames();
+    printf("Resuming readout at frame %ld\n", this->readoutRanges[0].first);
+    this->checkpoint = saved;
+    pResume = &saved;
+  }
+  setIntegerParam(PhotronResumeFrame, this->readoutRanges[0].first);
+  setIntegerParam(PhotronReadoutFrames, numFrames);
+  epicsTimeGetCurrent(&(this->checkpointTime));
+  
+  if (rawEnable) {
+    // Each frame in the pipeline, plus the ones being transferred and the
+    // one being written, needs its own stream buffer
+    getIntegerParam(PhotronReadoutDepth, &depth);
+    if (openRawStream(numFrames, dataSize, depth + nLinks + 1, pResume) != 
+        asynSuccess) {
+      return(asynError);
+    }
   }
   
-  for (index=start; index<=end; index++) {
-    // Retrieve a frame
-    nRet = PDC_GetMemImageDataEnd(this->nDeviceNo, this->nChildNo,
-                                    transferBitDepth, pBuf, &nErrorCode);
-    if (nRet == PDC_FAILED) {
-      printf("PDC_GetMemImageDataEnd Error %d\n", nErrorCode);
+  // Frames are processed by PhotronReadoutWorkers threads and published in
+  // order. The publish stage is idle, so the worker count can change here.
+  getIntegerParam(PhotronReadoutWorkers, &nWorkers);
+  while ((this->numReadoutWorkers < nWorkers) && 
+         (startReadoutWorker() == asynSuccess)) {
+  }
+  if (nWorkers > this->numReadoutWorkers) {
+    nWorkers = this->numReadoutWorkers;
+  }
+  this->activeReadoutWorkers = nWorkers;
+  
+  // None of the attributes are expected to change during the readout, so
+  // they can be evaluated once and copied to each frame
+  getIntegerParam(PhotronAttrSnapshot, &(this->attrSnapshot));
+  if (this->attrSnapshot) {
+    this->readoutAttributes->clear();
+    this->getAttributes(this->readoutAttributes);
+  }
+  
+  // The IRIG times link 0 needs are nLinks frames of the plan apart
+  this->irigStride = nLinks * this->readoutRanges[0].stride;
+  rangeIndex = 0;
+  index = this->readoutRanges[0].first;
+  while (1) {
+    // Take the next frame of the plan for each link
+    for (nBatch=0; (nBatch<nLinks) && (rangeIndex<this->numReadoutRanges); 
+         nBatch++) {
+      frameNo[nBatch] = index;
+      index += this->readoutRanges[rangeIndex].stride;
+      if (index > this->readoutRanges[rangeIndex].last) {
+        rangeIndex++;
+        if (rangeIndex < this->numReadoutRanges) {
+          index = this->readoutRanges[rangeIndex].first;
+        }
+      }
     }
     
-    // Retrieve frame time
-    if (this->tMode == 1) {
+    // The SDK transfers each frame directly into the NDArray that is passed
+    // to the plugins (or a stream buffer), so it has to exist before the 
+    // transfer is started.
+    for (link=0; link<nBatch; link++) {
+      pNext[link] = NULL;
+      pRaw[link] = NULL;
+      if (rawEnable) {
+        pRaw[link] = this->rawBuf[(numRead + link) % this->rawNumBuffers];
+      } else {
+        pNext[link] = this->pNDArrayPool->alloc(2, dims, dataType, 0, NULL);
+        if (!pNext[link]) {
+          asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                    "%s:%s: error allocating buffer\n", driverName, 
+                    functionName);
+          nBatch = link;
+          abort = 1;
+          break;
+        }
+        pNext[link]->dims[0].offset = this->roiX;
+        pNext[link]->dims[1].offset = this->roiY;
+      }
+    }
     
-      nRet = PDC_GetMemIRIGData(this->nDeviceNo, this->nChildNo, index,
-                                &tData, &nErrorCode);
-      if (nRet == PDC_FAILED) {
-        printf("PDC_GetMemIRIGData Error %d\n", nErrorCode);
+    // Retrieve the frames and their times. The port lock is released so that
+    // puts, readbacks and the publish stage aren't blocked by the transfers.
+    for (link=0; link<nBatch; link++) {
+      cmd[link].type = SDK_CMD_MEM_IMAGE;
+      cmd[link].arg = frameNo[link];
+      cmd[link].bitDepth = transferBitDepth;
+      cmd[link].pData = rawEnable ? pRaw[link] : pNext[link]->pData;
+      cmd[link].pIRIG = (this->tMode == 1) ? &(frame[link].tData) : NULL;
+      cmd[link].roiX = this->roiX;
+      cmd[link].roiY = this->roiY;
+      cmd[link].roiWidth = this->roiEnable ? this->roiWidth : 0;
+      cmd[link].roiHeight = this->roiHeight;
+      cmd[link].format = this->readoutFormat;
+      cmd[link].shift = this->readoutShift;
+    }
+    this->unlock();
+    for (link=0; link<nBatch; link++) {
+      this->sdkSubmit(&cmd[link], SDK_PRIORITY_NORMAL, link);
+    }
+    for (link=0; link<nBatch; link++) {
+      this->sdkWait(&cmd[link]);
+    }
+    this->lock();
+    
+    // Frames are committed in order, so the readout stops at the first
+    // failed transfer and the frames after it in the batch are dropped
+    for (link=0; link<nBatch; link++) {
+      if (cmd[link].status != asynSuccess) {
+        asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                  "%s:%s: transfer of frame %d failed, error = %lu\n",
+                  driverName, functionName, frameNo[link], 
+                  cmd[link].nErrorCode);
+        status = asynError;
+        abort = 1;
+        for (dropped=link+1; dropped<nBatch; dropped++) {
+          if (pNext[dropped]) {
+            pNext[dropped]->release();
+          }
+        }
+        nBatch = link + 1;
+        break;
+      }
+    }
+    
+    // Deal the frames to the processing workers in turn
+    for (link=0; link<nBatch; link++) {
+      frame[link].pImage = pNext[link];
+      frame[link].pRaw = pRaw[link];
+      frame[link].index = frameNo[link];
+      frame[link].status = cmd[link].status;
+      epicsMessageQueueSend(
+          this->readoutWorkers[numRead % nWorkers].inQueueId, 
+          &frame[link], sizeof(frame[link]));
+      this->readoutInFlight++;
+      numRead++;
+    }
+    setIntegerParam(PhotronReadoutOccupancy, this->readoutInFlight);
+    
+    // Allow user to abort readout
+    if (this->abortFlag == 1) {
+      // reset the abort flag
+      this->abortFlag = 0;
+      abort = 1;
+    }
+    if (rawEnable && this->rawError) {
+      abort = 1;
+    }
+    
+    // Check to see if we're on the last frame
+    if (rangeIndex >= this->numReadoutRanges) {
+      // There isn't another frame to read
+      abort = 1;
+    } else {
+      this->irigStride = nLinks * this->readoutRanges[rangeIndex].stride;
+    }
+    
+    // Wait for room in the pipeline before starting the next transfer
+    getIntegerParam(PhotronReadoutDepth, &depth);
+    if (rawEnable && (depth > this->rawNumBuffers - nLinks - 1)) {
+      depth = this->rawNumBuffers - nLinks - 1;
+    }
+    while ((abort == 0) && (this->readoutInFlight >= depth)) {
+      this->unlock();
+      epicsEventWaitWithTimeout(this->readoutSpaceEventId, 0.1);
+      this->lock();
+      if (this->abortFlag == 1) {
+        this->abortFlag = 0;
+        abort = 1;
+      }
+    }
+    
+    if ((abort == 1) && (rangeIndex < this->numReadoutRanges)) {
+      printf("Aborting after posting the queued images to plugins\n");
+    }
+    
+    callParamCallbacks();
+    
+    if (abort == 1) {
+      break;
+    }
+  }
+  
+  // Mark the end of the readout and wait for the publish stage to drain
+  frame[0].pImage = NULL;
+  frame[0].pRaw = NULL;
+  frame[0].status = asynSuccess;
+  epicsMessageQueueSend(this->readoutWorkers[numRead % nWorkers].inQueueId, 
+                        &frame[0], sizeof(frame[0]));
+  this->unlock();
+  epicsEventWait(this->readoutDoneEventId);
+  this->lock();
+  this->irigStride = 1;
+  this->roiEnable = 0;
+  this->readoutFormat = READOUT_FORMAT_NATIVE;
+  
+  if (this->checkpointFile[0]) {
+    if (this->checkpoint.frame >= lastFrame) {
+      // Nothing is left to resume
+      clearCheckpoint();
+    } else {
+      saveCheckpoint(1);
+      printf("Readout can be resumed at frame %d\n", 
+             this->checkpoint.frame + 1);
+    }
+  }
+  
+  if (rawEnable) {
+    closeRawStream();
+  }
+  
+  epicsTimeGetCurrent(&endTime);
+  elapsedTime = epicsTimeDiffInSeconds(&endTime, &(this->readoutStartTime));
+  readoutRate = (elapsedTime > 0.0) ? numRead / elapsedTime : 0.0;
+  printf("Elapsed time: %f (%d frames, %.1f frames/s)\n", elapsedTime, 
+         numRead, readoutRate);
+  setDoubleParam(PhotronReadoutRate, readoutRate);
+  setDoubleParam(PhotronReadoutBandwidth, readoutRate * dataSize / 1.0e6);
+  callParamCallbacks();
+  
+  return status;
+}
+
+
+/** Opens the raw file named by PhotronRawFile for a memory readout of 
+  * numFrames frames and allocates the stream buffers. Frames are stored back
+  * to back; with PhotronRawDirectIO each record is padded to a multiple of
+  * TRANSFER_BUFFER_ALIGN so it can be written with O_DIRECT. The sidecar 
+  * index <file>.idx lists the frame number, file offset, IRIG time and 
+  * uniqueId of each record. When pResume is given the frames are appended 
+  * after the ones the checkpointed readout committed.
+  */
+asynStatus Photron::openRawStream(int numFrames, size_t frameSize, 
+                                  int numBuffers, 
+                                  const readoutCheckpoint_t *pResume) {
+  char fileName[MAX_FILENAME_LEN];
+  char indexName[MAX_FILENAME_LEN + 4];
+  int directIO, flags, index;
+  static const char *functionName = "openRawStream";
+  
+  getStringParam(PhotronRawFile, sizeof(fileName), fileName);
+  getIntegerParam(PhotronRawDirectIO, &directIO);
+  if (fileName[0] == 0) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: no raw file name\n", driverName, functionName);
+    return asynError;
+  }
+  
+  flags = O_WRONLY | O_CREAT;
+  if (!pResume) {
+    flags |= O_TRUNC;
+  }
+#ifdef _WIN32
+  flags |= O_BINARY;
+#endif
+  if (directIO) {
+#ifdef O_DIRECT
+    flags |= O_DIRECT;
+#else
+    printf("Direct I/O is not supported; writing %s through the page cache\n",
+           fileName);
+    directIO = 0;
+#endif
+  }
+  
+  this->rawFrameSize = frameSize;
+  if (directIO) {
+    this->rawStride = (frameSize + TRANSFER_BUFFER_ALIGN - 1) / 
+                      TRANSFER_BUFFER_ALIGN * TRANSFER_BUFFER_ALIGN;
+  } else {
+    this->rawStride = frameSize;
+  }
+  this->rawBytes = 0.0;
+  this->rawWriteTime = 0.0;
+  this->rawError = 0;
+  
+  this->rawFd = open(fileName, flags, 0644);
+#ifdef O_DIRECT
+  if ((this->rawFd < 0) && directIO && (errno == EINVAL)) {
+    // Some file systems (tmpfs) refuse O_DIRECT; the padded layout still works
+    printf("Direct I/O refused for %s; writing through the page cache\n",
+           fileName);
+    this->rawFd = open(fileName, flags & ~O_DIRECT, 0644);
+  }
+#endif
+  if (this->rawFd < 0) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: error opening %s: %s\n", driverName, functionName,
+              fileName, strerror(errno));
+    return asynError;
+  }
+  if (pResume) {
+    // Continue after the last committed frame
+    this->rawBytes = pResume->rawBytes;
+    if (rawFileSeek(this->rawFd, this->rawBytes)) {
+      asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                "%s:%s: error seeking in %s: %s\n", driverName, functionName,
+                fileName, strerror(errno));
+      closeRawStream();
+      return asynError;
+    }
+  }
+#ifndef _WIN32
+  // Reserve the whole file so the writes don't have to extend it
+  if (posix_fallocate(this->rawFd, 0, (off_t)this->rawBytes + 
+                      (off_t)this->rawStride * numFrames)) {
+    printf("Unable to preallocate %s\n", fileName);
+  }
+#endif
+  
+  epicsSnprintf(indexName, sizeof(indexName), "%s.idx", fileName);
+  if (pResume) {
+    // Drop index entries written after the checkpoint. The entries of the
+    // resumed frames are appended after the trimmed end.
+    this->rawIndexFile = fopen(indexName, "a");
+    if (this->rawIndexFile && 
+        rawFileTruncate(fileno(this->rawIndexFile), pResume->rawIndexPos)) {
+      asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                "%s:%s: error trimming %s: %s\n", driverName, functionName,
+                indexName, strerror(errno));
+      closeRawStream();
+      return asynError;
+    }
+  } else {
+    this->rawIndexFile = fopen(indexName, "w");
+  }
+  if (!this->rawIndexFile) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: error opening %s: %s\n", driverName, functionName,
+              indexName, strerror(errno));
+    closeRawStream();
+    return asynError;
+  }
+  if (!pResume) {
+    fprintf(this->rawIndexFile, 
+            "# width %lu height %lu bytes %lu stride %lu x %lu y %lu format %s\n",
+            this->roiWidth, this->roiHeight, (unsigned long)frameSize,
+            (unsigned long)this->rawStride, this->roiX, this->roiY,
+            (this->readoutFormat == READOUT_FORMAT_PACKED12) ? "mono12p" :
+            ((this->readoutFormat == READOUT_FORMAT_8BIT) || 
+             (this->pixelBits == 8)) ? "mono8" : "mono16");
+    fprintf(this->rawIndexFile, 
+            "# frame offset day hour min sec usec signal uniqueId\n");
+  }
+  
+  // The padding of each buffer is written as zeros
+  if (numBuffers > (int)(sizeof(this->rawBuf) / sizeof(this->rawBuf[0]))) {
+    numBuffers = (int)(sizeof(this->rawBuf) / sizeof(this->rawBuf[0]));
+  }
+  this->rawNumBuffers = 0;
+  for (index=0; index<numBuffers; index++) {
+    this->rawBuf[index] = transferBufAlloc(this->rawStride);
+    if (!this->rawBuf[index]) {
+      asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                "%s:%s: error allocating %lu byte stream buffer\n",
+                driverName, functionName, (unsigned long)this->rawStride);
+      closeRawStream();
+      return asynError;
+    }
+    memset(this->rawBuf[index], 0, this->rawStride);
+    this->rawNumBuffers++;
+  }
+  
+  printf("Streaming %d frames to %s%s%s\n", numFrames, fileName,
+         directIO ? " (direct I/O)" : "", pResume ? " (appending)" : "");
+  return asynSuccess;
+}
+
+
+/** Appends one frame and its index entry to the raw file. Called by 
+  * PhotronPublishTask without the port lock.
+  */
+void Photron::writeRawFrame(readoutFrame_t *pFrame, int uniqueId) {
+  const char *pData = (const char *)pFrame->pRaw;
+  size_t remaining = this->rawStride;
+  double offset = this->rawBytes;
+  epicsTimeStamp startTime, endTime;
+  int nWritten;
+  static const char *functionName = "writeRawFrame";
+  
+  if (this->rawError) {
+    return;
+  }
+  
+  epicsTimeGetCurrent(&startTime);
+  while (remaining > 0) {
+    nWritten = write(this->rawFd, pData, (unsigned int)remaining);
+    if (nWritten <= 0) {
+      asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                "%s:%s: error writing frame %d: %s\n", driverName, 
+                functionName, pFrame->index, strerror(errno));
+      this->rawError = 1;
+      return;
+    }
+    pData += nWritten;
+    remaining -= nWritten;
+  }
+  epicsTimeGetCurrent(&endTime);
+  this->rawWriteTime += epicsTimeDiffInSeconds(&endTime, &startTime);
+  this->rawBytes += this->rawStride;
+  
+  fprintf(this->rawIndexFile, "%d %.0f %lu %lu %lu %lu %lu %lu %d\n", 
+          pFrame->index, offset, pFrame->tData.m_nDayOfYear, 
+          pFrame->tData.m_nHour, pFrame->tData.m_nMinute, 
+          pFrame->tData.m_nSecond, pFrame->tData.m_nMicroSecond, 
+          pFrame->tData.m_ExistSignal, uniqueId);
+}
+
+
+/** Closes the raw file and its index, trims a preallocated file that was
+  * not filled, and reports the disk write rate. Called with the lock held 
+  * after the publish stage has drained.
+  */
+void Photron::closeRawStream() {
+  double writeRate;
+  int index;
+  
+  if (this->rawFd >= 0) {
+    if (rawFileTruncate(this->rawFd, this->rawBytes)) {
+      printf("Unable to trim raw file: %s\n", strerror(errno));
+    }
+    close(this->rawFd);
+    this->rawFd = -1;
+  }
+  if (this->rawIndexFile) {
+    fclose(this->rawIndexFile);
+    this->rawIndexFile = NULL;
+  }
+  for (index=0; index<this->rawNumBuffers; index++) {
+    transferBufFree(this->rawBuf[index]);
+  }
+  this->rawNumBuffers = 0;
+  
+  writeRate = (this->rawWriteTime > 0.0) ? 
+              this->rawBytes / this->rawWriteTime / 1.0e6 : 0.0;
+  printf("Raw file: %.0f bytes, disk write rate %.1f MB/s\n", this->rawBytes,
+         writeRate);
+  setDoubleParam(PhotronRawWriteRate, writeRate);
+}
+
+
+/** Fills in the camera and recording that a checkpoint of a readout of the
+  * current camera memory refers to. The rest is zeroed. */
+void Photron::initCheckpoint(readoutCheckpoint_t *pCheckpoint) {
+  memset(pCheckpoint, 0, sizeof(*pCheckpoint));
+  strncpy(pCheckpoint->cameraId, this->cameraId, 
+          sizeof(pCheckpoint->cameraId) - 1);
+  pCheckpoint->childNo = this->childNo;
+  pCheckpoint->frameStart = this->FrameInfo.m_nStart;
+  pCheckpoint->frameEnd = this->FrameInfo.m_nEnd;
+  pCheckpoint->frameTrigger = this->FrameInfo.m_nTrigger;
+  pCheckpoint->recordedFrames = this->FrameInfo.m_nRecordedFrames;
+  pCheckpoint->width = this->memWidth;
+  pCheckpoint->height = this->memHeight;
+  pCheckpoint->bits = this->pixelBits;
+  pCheckpoint->rate = this->memRate;
+  pCheckpoint->tMode = this->tMode;
+  if (this->tMode == 1) {
+    pCheckpoint->tDataStart = this->tDataStart;
+  }
+}
+
+
+/** Returns 1 if the checkpoint refers to the recording in camera memory, as
+  * read by readMem. Without IRIG a new recording with the same settings 
+  * can't be told apart, which is why the checkpoint is removed when a 
+  * recording starts.
+  */
+int Photron::matchCheckpoint(const readoutCheckpoint_t *pCheckpoint) {
+  readoutCheckpoint_t current;
+  const PDC_IRIG_INFO *pSaved = &(pCheckpoint->tDataStart);
+  
+  initCheckpoint(&current);
+  
+  return ((strcmp(pCheckpoint->cameraId, current.cameraId) == 0) &&
+          (pCheckpoint->childNo == current.childNo) &&
+          (pCheckpoint->frameStart == current.frameStart) &&
+          (pCheckpoint->frameEnd == current.frameEnd) &&
+          (pCheckpoint->frameTrigger == current.frameTrigger) &&
+          (pCheckpoint->recordedFrames == current.recordedFrames) &&
+          (pCheckpoint->width == current.width) &&
+          (pCheckpoint->height == current.height) &&
+          (pCheckpoint->bits == current.bits) &&
+          (pCheckpoint->rate == current.rate) &&
+          (pCheckpoint->tMode == current.tMode) &&
+          (pSaved->m_nDayOfYear == current.tDataStart.m_nDayOfYear) &&
+          (pSaved->m_nHour == current.tDataStart.m_nHour) &&
+          (pSaved->m_nMinute == current.tDataStart.m_nMinute) &&
+          (pSaved->m_nSecond == current.tDataStart.m_nSecond) &&
+          (pSaved->m_nMicroSecond == current.tDataStart.m_nMicroSecond));
+}
+
+
+/** Reads the checkpoint named by PhotronCheckpointFile. Returns asynError if
+  * there isn't one or it is incomplete. */
+asynStatus Photron::loadCheckpoint(readoutCheckpoint_t *pCheckpoint) {
+  char fileName[MAX_FILENAME_LEN];
+  char line[MAX_FILENAME_LEN + 16];
+  PDC_IRIG_INFO *pIRIG = &(pCheckpoint->tDataStart);
+  FILE *fp;
+  int found = 0;
+  
+  getStringParam(PhotronCheckpointFile, sizeof(fileName), fileName);
+  if (fileName[0] == 0) {
+    return asynError;
+  }
+  fp = fopen(fileName, "r");
+  if (!fp) {
+    return asynError;
+  }
+  
+  memset(pCheckpoint, 0, sizeof(*pCheckpoint));
+  while (fgets(line, sizeof(line), fp)) {
+    line[strcspn(line, "\r\n")] = 0;
+    if (sscanf(line, "camera %d %255s", &(pCheckpoint->childNo), 
+               pCheckpoint->cameraId) == 2) {
+      found |= 0x01;
+    } else if (sscanf(line, "recording %ld %ld %ld %ld", 
+                      &(pCheckpoint->frameStart), &(pCheckpoint->frameEnd),
+                      &(pCheckpoint->frameTrigger), 
+                      &(pCheckpoint->recordedFrames)) == 4) {
+      found |= 0x02;
+    } else if (sscanf(line, "geometry %lu %lu %lu %lu", &(pCheckpoint->width),
+                      &(pCheckpoint->height), &(pCheckpoint->bits),
+                      &(pCheckpoint->rate)) == 4) {
+      found |= 0x04;
+    } else if (sscanf(line, "irig %lu %lu %lu %lu %lu %lu", 
+                      &(pCheckpoint->tMode), &(pIRIG->m_nDayOfYear),
+                      &(pIRIG->m_nHour), &(pIRIG->m_nMinute), 
+                      &(pIRIG->m_nSecond), &(pIRIG->m_nMicroSecond)) == 6) {
+      found |= 0x08;
+    } else if (sscanf(line, "range %d %d", &(pCheckpoint->rangeStart), 
+                      &(pCheckpoint->rangeEnd)) == 2) {
+      found |= 0x10;
+    } else if (sscanf(line, "frame %d", &(pCheckpoint->frame)) == 1) {
+      found |= 0x20;
+    } else if (sscanf(line, "raw %d %d %lf %ld", &(pCheckpoint->raw), 
+                      &(pCheckpoint->rawDirectIO), &(pCheckpoint->rawBytes),
+                      &(pCheckpoint->rawIndexPos)) == 4) {
+      found |= 0x40;
+    } else if (strncmp(line, "rawfile ", 8) == 0) {
+      // The file name is the rest of the line and may contain spaces
+      strncpy(pCheckpoint->rawFile, line + 8, sizeof(pCheckpoint->rawFile) - 1);
+      found |= 0x80;
+    } else if (sscanf(line, "stride %d", &(pCheckpoint->stride)) == 1) {
+      found |= 0x100;
+    } else if (strncmp(line, "ranges ", 7) == 0) {
+      strncpy(pCheckpoint->ranges, line + 7, sizeof(pCheckpoint->ranges) - 1);
+      found |= 0x200;
+    } else if (sscanf(line, "roi %lu %lu %lu %lu", &(pCheckpoint->roiX), 
+                      &(pCheckpoint->roiY), &(pCheckpoint->roiWidth),
+                      &(pCheckpoint->roiHeight)) == 4) {
+      found |= 0x400;
+    } else if (sscanf(line, "format %d %d", &(pCheckpoint->format), 
+                      &(pCheckpoint->shift)) == 2) {
+      // Absent from checkpoints of native readouts by older versions
+    }
+  }
+  fclose(fp);
+  
+  return (found == 0x7FF) ? asynSuccess : asynError;
+}
+
+
+/** Writes the checkpoint of the readout in progress, at most once per 
+  * CHECKPOINT_PERIOD unless force is set. The file is written under another
+  * name and renamed, so a crash never leaves a partial checkpoint. Called 
+  * with the lock held by PhotronPublishTask and at the end of readImageRange.
+  */
+void Photron::saveCheckpoint(int force) {
+  char tempName[MAX_FILENAME_LEN + 4];
+  readoutCheckpoint_t *pCheckpoint = &(this->checkpoint);
+  PDC_IRIG_INFO *pIRIG = &(pCheckpoint->tDataStart);
+  epicsTimeStamp now;
+  FILE *fp;
+  static const char *functionName = "saveCheckpoint";
+  
+  if (this->checkpointFile[0] == 0) {
+    return;
+  }
+  epicsTimeGetCurrent(&now);
+  if (!force && 
+      (epicsTimeDiffInSeconds(&now, &(this->checkpointTime)) < CHECKPOINT_PERIOD)) {
+    return;
+  }
+  this->checkpointTime = now;
+  
+  if (pCheckpoint->raw && this->rawIndexFile) {
+    // The index entries of the committed frames must be in the file too
+    fflush(this->rawIndexFile);
+    pCheckpoint->rawIndexPos = ftell(this->rawIndexFile);
+    pCheckpoint->rawBytes = this->rawBytes;
+  }
+  
+  epicsSnprintf(tempName, sizeof(tempName), "%s.tmp", this->checkpointFile);
+  fp = fopen(tempName, "w");
+  if (!fp) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: error opening %s: %s\n", driverName, functionName,
+              tempName, strerror(errno));
+    return;
+  }
+  fprintf(fp, "# Photron readout checkpoint\n");
+  fprintf(fp, "camera %d %s\n", pCheckpoint->childNo, pCheckpoint->cameraId);
+  fprintf(fp, "recording %ld %ld %ld %ld\n", pCheckpoint->frameStart, 
+          pCheckpoint->frameEnd, pCheckpoint->frameTrigger, 
+          pCheckpoint->recordedFrames);
+  fprintf(fp, "geometry %lu %lu %lu %lu\n", pCheckpoint->width, 
+          pCheckpoint->height, pCheckpoint->bits, pCheckpoint->rate);
+  fprintf(fp, "irig %lu %lu %lu %lu %lu %lu\n", pCheckpoint->tMode, 
+          pIRIG->m_nDayOfYear, pIRIG->m_nHour, pIRIG->m_nMinute, 
+          pIRIG->m_nSecond, pIRIG->m_nMicroSecond);
+  fprintf(fp, "range %d %d\n", pCheckpoint->rangeStart, pCheckpoint->rangeEnd);
+  fprintf(fp, "stride %d\n", pCheckpoint->stride);
+  fprintf(fp, "roi %lu %lu %lu %lu\n", pCheckpoint->roiX, pCheckpoint->roiY,
+          pCheckpoint->roiWidth, pCheckpoint->roiHeight);
+  fprintf(fp, "format %d %d\n", pCheckpoint->format, pCheckpoint->shift);
+  fprintf(fp, "ranges %s\n", pCheckpoint->ranges);
+  fprintf(fp, "frame %d\n", pCheckpoint->frame);
+  fprintf(fp, "raw %d %d %.0f %ld\n", pCheckpoint->raw, 
+          pCheckpoint->rawDirectIO, pCheckpoint->rawBytes, 
+          pCheckpoint->rawIndexPos);
+  fprintf(fp, "rawfile %s\n", pCheckpoint->rawFile);
+  if (fclose(fp) != 0) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: error writing %s\n", driverName, functionName, tempName);
+    return;
+  }
+#ifdef _WIN32
+  // rename() doesn't replace an existing file on Windows
+  remove(this->checkpointFile);
+#endif
+  if (rename(tempName, this->checkpointFile) != 0) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: error renaming %s: %s\n", driverName, functionName,
+              tempName, strerror(errno));
+    return;
+  }
+  
+  setIntegerParam(PhotronResumeFrame, pCheckpoint->frame + 1);
+  setIntegerParam(PhotronResumeValid, 1);
+}
+
+
+/** Removes the checkpoint once a readout is complete or the recording it
+  * refers to has been overwritten. */
+void Photron::clearCheckpoint() {
+  char fileName[MAX_FILENAME_LEN];
+  int resumeValid;
+  
+  getStringParam(PhotronCheckpointFile, sizeof(fileName), fileName);
+  getIntegerParam(PhotronResumeValid, &resumeValid);
+  if (fileName[0] && resumeValid) {
+    remove(fileName);
+    printf("Removed readout checkpoint %s\n", fileName);
+  }
+  setIntegerParam(PhotronResumeValid, 0);
+}
+
+
+/** Finishes an interrupted readout described by the checkpoint, e.g. after
+  * an IOC restart. The recording stays in camera memory until the camera
+  * records again. Runs on PhotronRecTask with the lock held, in live mode.
+  */
+void Photron::resumeReadout() {
+  readoutCheckpoint_t saved;
+  
+  if (loadCheckpoint(&saved) != asynSuccess) {
+    printf("No readout checkpoint to resume\n");
+    return;
+  }
+  
+  printf("Put camera in playback mode\n");
+  sdkCall(&Photron::setPlayback, SDK_PRIORITY_NORMAL);
+  sdkCall(&Photron::readMem, SDK_PRIORITY_NORMAL);
+  
+  if (!matchCheckpoint(&saved)) {
+    printf("Camera memory does not hold the checkpointed recording\n");
+  } else {
+    // readImageRange skips the frames that were already committed
+    setIntegerParam(PhotronPMStart, saved.rangeStart);
+    setIntegerParam(PhotronPMEnd, saved.rangeEnd);
+    setIntegerParam(PhotronReadoutStride, saved.stride);
+    setStringParam(PhotronReadoutRanges, saved.ranges);
+    setIntegerParam(PhotronReadoutMinX, saved.roiX);
+    setIntegerParam(PhotronReadoutMinY, saved.roiY);
+    setIntegerParam(PhotronReadoutSizeX, saved.roiWidth);
+    setIntegerParam(PhotronReadoutSizeY, saved.roiHeight);
+    setIntegerParam(PhotronReadoutFormat, saved.format);
+    if (saved.format == READOUT_FORMAT_8BIT) {
+      setIntegerParam(PhotronReadoutShift, saved.shift);
+    }
+    setIntegerParam(ADNumImagesCounter, 0);
+    setIntegerParam(NDArrayCounter, this->NDArrayCounterBackup);
+    callParamCallbacks();
+    this->readImageRange();
+  }
+  
+  this->waitForOtherHeads();
+  printf("Return camera to live mode\n");
+  sdkCall(&Photron::setLive, SDK_PRIORITY_NORMAL);
+  this->sdkRefresh(PHOTRON_REFRESH_STATUS);
+}
+
+
+
+static void PhotronCorrTaskC(void *drvPvt) {
+  Photron *pPvt = (Photron *)drvPvt;
+  pPvt->PhotronCorrTask();
+}
+
+/** Corrects the bands of rows correctImage queues, from whichever frames
+  * are being corrected at the time. */
+void Photron::PhotronCorrTask() {
+  corrBand_t *pBand;
+  
+  while (1) {
+    epicsMessageQueueReceive(this->corrQueueId, &pBand, sizeof(pBand));
+    this->correctRows(pBand->pImage, pBand->pMaps, pBand->firstRow, 
+                      pBand->numRows);
+    epicsEventSignal(pBand->doneEventId);
+  }
+}
+
+
+/** Applies the dark frame and gain map to a live or memory frame, after 
+  * adding it to a capture in progress. The rows are split into bands for
+  * PhotronCorrThreads threads, this one included. Frames of another data 
+  * type, or outside the region the maps were captured from, are left alone.
+  * corrMutex is only held to take a reference to the maps, so the readout
+  * workers and the live path correct their frames at the same time.
+  * Called without the port lock.
+  */
+void Photron::correctImage(NDArray *pImage) {
+  int captured = 0;
+  int nThreads = 1;
+  int numRows, firstRow, band;
+  unsigned long x, y, width, height;
+  corrMaps_t *pMaps = NULL;
+  corrBand_t bands[MAX_CORR_THREADS];
+  corrBand_t *pBand;
+  epicsTimeStamp startTime, endTime;
+  double corrTime = -1.0;
+  char name[32];
+  static const char *functionName = "correctImage";
+  
+  if (!pImage || (pImage->ndims != 2)) {
+    return;
+  }
+  x = (unsigned long)pImage->dims[0].offset;
+  y = (unsigned long)pImage->dims[1].offset;
+  width = (unsigned long)pImage->dims[0].size;
+  height = (unsigned long)pImage->dims[1].size;
+  
+  epicsMutexMustLock(this->corrMutex);
+  if (this->corrCapture) {
+    captured = captureCorrFrame(pImage);
+  }
+  
+  if (this->corrEnable && this->corrMaps && 
+      (this->corrDarkValid || this->corrFlatValid)) {
+    pMaps = this->corrMaps;
+    if ((pImage->dataType != pMaps->dataType) || (x < pMaps->x) || 
+        (y < pMaps->y) || (x + width > pMaps->x + pMaps->width) ||
+        (y + height > pMaps->y + pMaps->height)) {
+      if (!this->corrWarned) {
+        printf("Correction maps are for %lux%lu frames at %lu,%lu; "
+               "%lux%lu frames at %lu,%lu are not corrected\n", 
+               pMaps->width, pMaps->height, pMaps->x, pMaps->y,
+               width, height, x, y);
+        this->corrWarned = 1;
       }
+      pMaps = NULL;
+    } else {
+      pMaps->refCount++;
       
-      setIntegerParam(PhotronMemIRIGDay, tData.m_nDayOfYear);
-      setIntegerParam(PhotronMemIRIGHour, tData.m_nHour);
-      setIntegerParam(PhotronMemIRIGMin, tData.m_nMinute);
-      setIntegerParam(PhotronMemIRIGSec, tData.m_nSecond);
-      setIntegerParam(PhotronMemIRIGUsec, tData.m_nMicroSecond);
-      setIntegerParam(PhotronMemIRIGSigEx, tData.m_ExistSignal);
+      // Bands of at least 16 rows, so small frames don't wake every thread
+      nThreads = this->corrThreads;
+      if (nThreads > (int)(height / 16)) {
+        nThreads = (int)(height / 16);
+      }
+      if (nThreads < 1) {
+        nThreads = 1;
+      }
+      while (this->numCorrWorkers < nThreads - 1) {
+        epicsSnprintf(name, sizeof(name), "PhotronCorr%d", 
+                      this->numCorrWorkers + 1);
+        if (epicsThreadCreate(name, epicsThreadPriorityMedium,
+                              epicsThreadGetStackSize(epicsThreadStackSmall),
+                              (EPICSTHREADFUNC)PhotronCorrTaskC, 
+                              this) == NULL) {
+          asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                    "%s:%s: epicsThreadCreate failure for correction task\n",
+                    driverName, functionName);
+          break;
+        }
+        this->numCorrWorkers++;
+      }
+      if (nThreads > this->numCorrWorkers + 1) {
+        nThreads = this->numCorrWorkers + 1;
+      }
     }
-    
-    /* We save the most recent image buffer so it can be used in the read() 
-     * function. Now release it before getting a new version. */
-    if (this->pArrays[0]) 
-      this->pArrays[0]->release();
+  }
+  epicsMutexUnlock(this->corrMutex);
   
-    /* Allocate the raw buffer */
-    dims[0] = memWidth;
-    dims[1] = memHeight;
-    pImage = this->pNDArrayPool->alloc(2, dims, dataType, 0, NULL);
-    if (!pImage) {
-      asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
-                "%s:%s: error allocating buffer\n", driverName, functionName);
-      return(asynError);
+  if (pMaps) {
+    epicsTimeGetCurrent(&startTime);
+    
+    // This thread takes the first band; the others go to whichever workers
+    // are free, also when other frames are being corrected
+    numRows = height / nThreads;
+    firstRow = numRows + height % nThreads;
+    for (band=1; band<nThreads; band++) {
+      pBand = &(bands[band]);
+      pBand->pImage = pImage;
+      pBand->pMaps = pMaps;
+      pBand->firstRow = firstRow;
+      pBand->numRows = numRows;
+      pBand->doneEventId = epicsEventMustCreate(epicsEventEmpty);
+      epicsMessageQueueSend(this->corrQueueId, &pBand, sizeof(pBand));
+      firstRow += numRows;
+    }
+    this->correctRows(pImage, pMaps, 0, numRows + height % nThreads);
+    for (band=1; band<nThreads; band++) {
+      epicsEventWait(bands[band].doneEventId);
+      epicsEventDestroy(bands[band].doneEventId);
     }
     
-    memcpy(pImage->pData, pBuf, dataSize);
+    epicsTimeGetCurrent(&endTime);
+    corrTime = epicsTimeDiffInSeconds(&endTime, &startTime) * 1000.0;
     
-    // Allow user to abort readout
-    if (this->abortFlag == 1) {
-      // reset the abort flag
-      this->abortFlag = 0;
-      abort = 1;
+    epicsMutexMustLock(this->corrMutex);
+    releaseCorrMaps(pMaps);
+    epicsMutexUnlock(this->corrMutex);
+  }
+  
+  if (captured || (corrTime >= 0.0)) {
+    this->lock();
+    if (captured) {
+      setIntegerParam(PhotronCorrCaptureDark, 0);
+      setIntegerParam(PhotronCorrCaptureFlat, 0);
+      setIntegerParam(PhotronCorrDarkValid, this->corrDarkValid);
+      setIntegerParam(PhotronCorrFlatValid, this->corrFlatValid);
     }
-    
-    // Check to see if we're on the last frame
-    if (index == end) {
-      // There isn't another frame to preload
-      abort = 1;
+    if (corrTime >= 0.0) {
+      setDoubleParam(PhotronCorrTime, corrTime);
     }
-    
-    if (abort == 0) {
-      // Start preloading the next frame
-      nRet = PDC_GetMemImageDataStart(this->nDeviceNo, this->nChildNo, (index+1),
-                                      transferBitDepth, pBuf, &nErrorCode);
-      if (nRet == PDC_FAILED) {
-        printf("PDC_GetMemImageDataStart Error %d; index = %d\n", nErrorCode, (index+1));
-      }
+    callParamCallbacks();
+    this->unlock();
+  }
+}
+
+
+/** Corrects numRows rows of a frame starting at firstRow with pMaps. 
+  * correctImage holds a reference to the maps and has checked that they 
+  * cover the frame. */
+void Photron::correctRows(NDArray *pImage, const corrMaps_t *pMaps, 
+                          int firstRow, int numRows) {
+  size_t width = pImage->dims[0].size;
+  size_t mapIndex;
+  int row;
+  
+  mapIndex = (pImage->dims[1].offset - pMaps->y + firstRow) * pMaps->width +
+             (pImage->dims[0].offset - pMaps->x);
+  for (row=firstRow; row<firstRow+numRows; row++) {
+    if (pImage->dataType == NDUInt8) {
+      photronCorrect8((epicsUInt8 *)pImage->pData + row * width, 
+                      pMaps->pDark + mapIndex, pMaps->pGain + mapIndex, 
+                      width);
     } else {
-      printf("Aborting after posting this last image to plugins\n");
+      photronCorrect16((epicsUInt16 *)pImage->pData + row * width, 
+                       pMaps->pDark + mapIndex, pMaps->pGain + mapIndex, 
+                       width, 0x0FFF);
     }
-    
-    this->pArrays[0] = pImage;
-    pImage->pAttributeList->add("ColorMode", "Color mode", NDAttrInt32, 
-                                &colorMode);
-    pImage->getInfo(&arrayInfo);
-    setIntegerParam(NDArraySize,  (int)arrayInfo.totalBytes);
-    setIntegerParam(NDArraySizeX, (int)pImage->dims[0].size);
-    setIntegerParam(NDArraySizeY, (int)pImage->dims[1].size);
-    
-    /* Call the callbacks to update any changes */
-    callParamCallbacks();
-    
-    /* Get the current parameters */
-    getIntegerParam(NDArrayCounter, &imageCounter);
-    getIntegerParam(ADNumImages, &numImages);
-    getIntegerParam(ADNumImagesCounter, &numImagesCounter);
-    getIntegerParam(ADImageMode, &imageMode);
-    getIntegerParam(NDArrayCallbacks, &arrayCallbacks);
-    imageCounter++;
-    numImagesCounter++;
-    setIntegerParam(NDArrayCounter, imageCounter);
-    setIntegerParam(ADNumImagesCounter, numImagesCounter);
-    
-    /* Put the frame number and time stamp into the buffer */
-    pImage->uniqueId = imageCounter;
-    if (tMode == 1) {
-      irigSeconds = (((((tData.m_nDayOfYear * 24) + tData.m_nHour) * 60) + tData.m_nMinute) * 60) + tData.m_nSecond;
-      pImage->timeStamp = (this->postIRIGStartTime).secPastEpoch + irigSeconds + (this->postIRIGStartTime).nsec / 1.e9 + tData.m_nMicroSecond / 1.e6;
+    mapIndex += pMaps->width;
+  }
+}
+
+
+/** Adds a frame to the dark or flat capture in progress. A frame with a
+  * different geometry or data type restarts the capture. When the last 
+  * frame is in, the average becomes the dark frame, or the flat field
+  * becomes a gain map that scales each pixel above the dark frame to the 
+  * mean, and the maps are saved to PhotronCorrFile. Frames being corrected
+  * may still use the current maps, so the result goes into a new set.
+  * Returns 1 when the capture is done. Called with corrMutex held.
+  */
+int Photron::captureCorrFrame(NDArray *pImage) {
+  size_t numPixels = pImage->dims[0].size * pImage->dims[1].size;
+  size_t index;
+  double sum, mean, level, dark;
+  long count;
+  int numFrames, darkValid, flatValid;
+  corrMaps_t *pMaps;
+  
+  if ((pImage->dataType != NDUInt8) && (pImage->dataType != NDUInt16)) {
+    return 0;
+  }
+  if (!this->corrSum || (this->corrSumDataType != pImage->dataType) ||
+      (this->corrSumX != pImage->dims[0].offset) || 
+      (this->corrSumY != pImage->dims[1].offset) ||
+      (this->corrSumWidth != pImage->dims[0].size) ||
+      (this->corrSumHeight != pImage->dims[1].size)) {
+    free(this->corrSum);
+    this->corrSum = (epicsUInt32 *)calloc(numPixels, sizeof(epicsUInt32));
+    if (!this->corrSum) {
+      printf("Error allocating the correction capture buffer\n");
+      this->corrCapture = 0;
+      return 1;
     }
-    else {
-      pImage->timeStamp = startTime.secPastEpoch + startTime.nsec / 1.e9;
+    this->corrSumX = pImage->dims[0].offset;
+    this->corrSumY = pImage->dims[1].offset;
+    this->corrSumWidth = pImage->dims[0].size;
+    this->corrSumHeight = pImage->dims[1].size;
+    this->corrSumDataType = pImage->dataType;
+    this->corrCaptureCount = 0;
+  }
+  
+  if (pImage->dataType == NDUInt8) {
+    for (index=0; index<numPixels; index++) {
+      this->corrSum[index] += ((epicsUInt8 *)pImage->pData)[index];
     }
-    updateTimeStamp(&pImage->epicsTS);
-    
-    /* Get any attributes that have been defined for this driver */
-    this->getAttributes(pImage->pAttributeList);
-    
-    if (arrayCallbacks) {
-      /* Call the NDArray callback */
-      /* Must release the lock here, or we can get into a deadlock, because we
-      * can block on the plugin lock, and the plugin can be calling us */
-      this->unlock();
-      asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW,
-                "%s:%s: calling imageData callback\n", driverName,
-                functionName);
-      doCallbacksGenericPointer(pImage, NDArrayData, 0);
-      this->lock();
+  } else {
+    for (index=0; index<numPixels; index++) {
+      this->corrSum[index] += ((epicsUInt16 *)pImage->pData)[index];
     }
-    
-    if (abort == 1) {
-      // Is a sleep needed here?
-      break;
+  }
+  this->corrCaptureCount++;
+  numFrames = this->corrCaptureFrames;
+  if (this->corrCaptureCount < numFrames) {
+    return 0;
+  }
+  
+  // Maps captured from other frames can't be combined with this one; maps
+  // of the same frames are carried over
+  pMaps = this->corrMaps;
+  if (pMaps && (pMaps->x == this->corrSumX) && (pMaps->y == this->corrSumY) &&
+      (pMaps->width == this->corrSumWidth) && 
+      (pMaps->height == this->corrSumHeight) &&
+      (pMaps->dataType == this->corrSumDataType)) {
+    pMaps->refCount++;
+  } else {
+    pMaps = NULL;
+  }
+  darkValid = this->corrDarkValid;
+  flatValid = this->corrFlatValid;
+  resetCorrMaps(this->corrSumX, this->corrSumY, this->corrSumWidth,
+                this->corrSumHeight, this->corrSumDataType);
+  if (pMaps) {
+    if (this->corrMaps) {
+      memcpy(this->corrMaps->pDark, pMaps->pDark, numPixels * sizeof(epicsUInt16));
+      memcpy(this->corrMaps->pGain, pMaps->pGain, numPixels * sizeof(epicsUInt16));
+      this->corrDarkValid = darkValid;
+      this->corrFlatValid = flatValid;
     }
+    releaseCorrMaps(pMaps);
   }
+  pMaps = this->corrMaps;
   
-  epicsTimeGetCurrent(&endTime);
-  elapsedTime = epicsTimeDiffInSeconds(&endTime, &startTime);
-  printf("Elapsed time: %f\n", elapsedTime);
+  if (pMaps && (this->corrCapture == CORR_CAPTURE_DARK)) {
+    for (index=0; index<numPixels; index++) {
+      pMaps->pDark[index] = (epicsUInt16)
+                            ((this->corrSum[index] + numFrames / 2) / numFrames);
+    }
+    this->corrDarkValid = 1;
+    printf("Captured a %lux%lu dark frame from %d frames\n", 
+           pMaps->width, pMaps->height, numFrames);
+  } else if (pMaps) {
+    // The mean level above the dark frame of the pixels that respond
+    sum = 0.0;
+    count = 0;
+    for (index=0; index<numPixels; index++) {
+      dark = this->corrDarkValid ? pMaps->pDark[index] : 0.0;
+      level = (double)this->corrSum[index] / numFrames - dark;
+      if (level > 0.0) {
+        sum += level;
+        count++;
+      }
+    }
+    mean = count ? sum / count : 0.0;
+    for (index=0; index<numPixels; index++) {
+      dark = this->corrDarkValid ? pMaps->pDark[index] : 0.0;
+      level = (double)this->corrSum[index] / numFrames - dark;
+      if ((level <= 0.0) || (mean <= 0.0)) {
+        pMaps->pGain[index] = CORR_GAIN_ONE;
+      } else {
+        level = CORR_GAIN_ONE * mean / level + 0.5;
+        pMaps->pGain[index] = (epicsUInt16)((level > 65535.0) ? 65535.0 : level);
+      }
+    }
+    this->corrFlatValid = 1;
+    printf("Captured a %lux%lu flat field from %d frames, mean level %.1f\n", 
+           pMaps->width, pMaps->height, numFrames, mean);
+  }
   
-  free(pBuf);
+  free(this->corrSum);
+  this->corrSum = NULL;
+  this->corrCapture = 0;
+  if (this->corrFile[0]) {
+    saveCorrMaps();
+  }
+  return 1;
+}
+
+
+/** Replaces the maps with a new set holding a zero dark frame and unit gain
+  * for the given region, or with none if there isn't enough memory. Frames
+  * being corrected keep the old set until they are done. Called with 
+  * corrMutex held. */
+void Photron::resetCorrMaps(unsigned long x, unsigned long y, 
+                            unsigned long width, unsigned long height,
+                            NDDataType_t dataType) {
+  releaseCorrMaps(this->corrMaps);
+  this->corrMaps = allocCorrMaps(x, y, width, height, dataType);
+  this->corrDarkValid = 0;
+  this->corrFlatValid = 0;
+  this->corrWarned = 0;
+  if (!this->corrMaps) {
+    printf("Error allocating %lux%lu correction maps\n", width, height);
+  }
+}
+
+
+/** Writes the maps to this->corrFile: a text line with the region, data
+  * type and valid flags, then the dark frame and the Q4.12 gain map as
+  * native 16-bit words. Called with corrMutex held. */
+asynStatus Photron::saveCorrMaps() {
+  corrMaps_t *pMaps = this->corrMaps;
+  size_t numPixels;
+  FILE *fp;
   
+  if (!pMaps) {
+    return asynError;
+  }
+  numPixels = pMaps->width * pMaps->height;
+  fp = fopen(this->corrFile, "wb");
+  if (!fp) {
+    printf("Error writing correction maps to %s: %s\n", this->corrFile, 
+           strerror(errno));
+    return asynError;
+  }
+  fprintf(fp, "PHOTRONCORR %lu %lu %lu %lu %d %d %d\n", pMaps->x, 
+          pMaps->y, pMaps->width, pMaps->height, 
+          (int)pMaps->dataType, this->corrDarkValid, this->corrFlatValid);
+  if ((fwrite(pMaps->pDark, sizeof(epicsUInt16), numPixels, fp) != numPixels) ||
+      (fwrite(pMaps->pGain, sizeof(epicsUInt16), numPixels, fp) != numPixels) ||
+      (fclose(fp) != 0)) {
+    printf("Error writing correction maps to %s\n", this->corrFile);
+    return asynError;
+  }
   return asynSuccess;
 }
 
 
+/** Reads maps written by saveCorrMaps from this->corrFile. Called with 
+  * corrMutex held. */
+asynStatus Photron::loadCorrMaps() {
+  unsigned long x, y, width, height;
+  int dataType, darkValid, flatValid;
+  size_t numPixels;
+  FILE *fp;
+  
+  fp = fopen(this->corrFile, "rb");
+  if (!fp) {
+    // Nothing saved yet; the next capture creates the file
+    return asynError;
+  }
+  if ((fscanf(fp, "PHOTRONCORR %lu %lu %lu %lu %d %d %d", &x, &y, &width, 
+              &height, &dataType, &darkValid, &flatValid) != 7) ||
+      (fgetc(fp) != '\n') || ((dataType != NDUInt8) && (dataType != NDUInt16))) {
+    printf("%s does not hold correction maps\n", this->corrFile);
+    fclose(fp);
+    return asynError;
+  }
+  // The new set isn't shared until corrMutex is released
+  resetCorrMaps(x, y, width, height, (NDDataType_t)dataType);
+  numPixels = width * height;
+  if (!this->corrMaps || 
+      (fread(this->corrMaps->pDark, sizeof(epicsUInt16), numPixels, fp) != numPixels) ||
+      (fread(this->corrMaps->pGain, sizeof(epicsUInt16), numPixels, fp) != numPixels)) {
+    printf("Error reading correction maps from %s\n", this->corrFile);
+    fclose(fp);
+    resetCorrMaps(x, y, width, height, (NDDataType_t)dataType);
+    return asynError;
+  }
+  fclose(fp);
+  this->corrDarkValid = darkValid;
+  this->corrFlatValid = flatValid;
+  printf("Loaded %lux%lu correction maps from %s\n", width, height, 
+         this->corrFile);
+  return asynSuccess;
+}
+
 asynStatus Photron::getGeometry() {
   int status = asynSuccess;
   int binX, binY;
@@ -3256,6 +7207,7 @@ asynStatus Photron::updateResolution() {
   //printf("RESOLUTION: %d x %d\n", sizeX, sizeY);
   this->width = sizeX;
   this->height = sizeY;
+  resizeTransferBuffers();
   
   nRet = PDC_GetSegmentPosition(this->nDeviceNo, this->nChildNo, &xPos, &yPos,
                                 &nErrorCode);
@@ -4559,6 +8511,10 @@ asynStatus Photron::setStatus(epicsInt32 value) {
   }
   
   //printf("Output status = 0x%x\n", desiredStatus);
+  if ((desiredStatus != PDC_STATUS_PLAYBACK) && this->otherHeadsReading()) {
+    printf("Other heads are reading the recording; not changing status\n");
+    return asynError;
+  }
   nRet = PDC_SetStatus(this->nDeviceNo, desiredStatus, &nErrorCode);
   if (nRet == PDC_FAILED) {
     printf("PDC_SetStatus Error %d\n", nErrorCode);
@@ -4569,7 +8525,12 @@ asynStatus Photron::setStatus(epicsInt32 value) {
 }
 
 
-asynStatus Photron::readParameters() {
+/** Reads the camera settings back into the parameter library.
+  * \param[in] groups Mask of PHOTRON_REFRESH_* groups to re-read. The status
+  *            is always read. PhotronRefreshCalls is set to the number of SDK
+  *            calls this took.
+  */
+asynStatus Photron::readParameters(int groups) {
   unsigned long nRet;
   unsigned long nErrorCode;
   int status = asynSuccess;
@@ -4577,6 +8538,7 @@ asynStatus Photron::readParameters() {
   int index;
   int eVal, eStatus;
   char bitDepthChar;
+  int calls = 0;
   static const char *functionName = "readParameters";    
   
   //printf("Reading parameters...\n");
@@ -4588,39 +8550,50 @@ asynStatus Photron::readParameters() {
     printf("PDC_GetStatus (#5) failed %d\n", nErrorCode);
     return asynError;
   }
+  calls++;
   status |= setIntegerParam(PhotronStatus, this->nStatus);
   eStatus = statusToEPICS(this->nStatus);
   setIntegerParam(PhotronStatusName, eStatus);
   
-  nRet = PDC_GetCamMode(this->nDeviceNo, this->nChildNo, &(this->camMode), &nErrorCode);
-  if (nRet == PDC_FAILED) {
-    printf("PDC_GetCamMode failed %d\n", nErrorCode);
-    return asynError;
-  }
-  status |= setIntegerParam(PhotronCamMode, this->camMode);
-  
-  nRet = PDC_GetRecordRate(this->nDeviceNo, this->nChildNo, &(this->nRate), &nErrorCode);
-  if (nRet == PDC_FAILED) {
-    printf("PDC_GetRecordRate failed %d\n", nErrorCode);
-    return asynError;
+  if (groups & PHOTRON_REFRESH_MODE) {
+    nRet = PDC_GetCamMode(this->nDeviceNo, this->nChildNo, &(this->camMode), &nErrorCode);
+    if (nRet == PDC_FAILED) {
+      printf("PDC_GetCamMode failed %d\n", nErrorCode);
+      return asynError;
+    }
+    calls++;
+    status |= setIntegerParam(PhotronCamMode, this->camMode);
   }
-  status |= setIntegerParam(PhotronRecRate, this->nRate);
   
-  nRet = PDC_GetMaxFrames(this->nDeviceNo, this->nChildNo, &(this->nMaxFrames),
-                          &(this->nBlocks), &nErrorCode);
-  if (nRet == PDC_FAILED) {
-    printf("PDC_GetMaxFrames failed %d\n", nErrorCode);
-    return asynError;
+  if (groups & PHOTRON_REFRESH_RATE) {
+    nRet = PDC_GetRecordRate(this->nDeviceNo, this->nChildNo, &(this->nRate), &nErrorCode);
+    if (nRet == PDC_FAILED) {
+      printf("PDC_GetRecordRate failed %d\n", nErrorCode);
+      return asynError;
+    }
+    calls++;
+    status |= setIntegerParam(PhotronRecRate, this->nRate);
+    
+    nRet = PDC_GetMaxFrames(this->nDeviceNo, this->nChildNo, &(this->nMaxFrames),
+                            &(this->nBlocks), &nErrorCode);
+    if (nRet == PDC_FAILED) {
+      printf("PDC_GetMaxFrames failed %d\n", nErrorCode);
+      return asynError;
+    }
+    calls++;
+    status |= setIntegerParam(PhotronMaxFrames, this->nMaxFrames);
   }
-  status |= setIntegerParam(PhotronMaxFrames, this->nMaxFrames);
   
-  nRet = PDC_GetShutterSpeedFps(this->nDeviceNo, this->nChildNo, 
-                                &(this->shutterSpeedFps), &nErrorCode);
-  if (nRet = PDC_FAILED) {
-    printf("PDC_GetShutterSpeedFps failed %d\n", nErrorCode);
-    return asynError;
+  if (groups & (PHOTRON_REFRESH_SHUTTER | PHOTRON_REFRESH_RATE)) {
+    nRet = PDC_GetShutterSpeedFps(this->nDeviceNo, this->nChildNo, 
+                                  &(this->shutterSpeedFps), &nErrorCode);
+    if (nRet = PDC_FAILED) {
+      printf("PDC_GetShutterSpeedFps failed %d\n", nErrorCode);
+      return asynError;
+    }
+    calls++;
+    status |= setIntegerParam(PhotronShutterFps, this->shutterSpeedFps);
   }
-  status |= setIntegerParam(PhotronShutterFps, this->shutterSpeedFps);
   
   /*
   PDC_GetTriggerMode succeeded
@@ -4629,154 +8602,185 @@ asynStatus Photron::readParameters() {
         RFrames = 0
         RCount = 0
   */
-  
-  nRet = PDC_GetTriggerMode(this->nDeviceNo, &(this->triggerMode),
-                            &(this->trigAFrames), &(this->trigRFrames),
-                            &(this->trigRCount), &nErrorCode);
-  if (nRet == PDC_FAILED) {
-    printf("PDC_GetTriggerMode failed %d\n", nErrorCode);
-    return asynError;
+  if (groups & PHOTRON_REFRESH_TRIGGER) {
+    nRet = PDC_GetTriggerMode(this->nDeviceNo, &(this->triggerMode),
+                              &(this->trigAFrames), &(this->trigRFrames),
+                              &(this->trigRCount), &nErrorCode);
+    if (nRet == PDC_FAILED) {
+      printf("PDC_GetTriggerMode failed %d\n", nErrorCode);
+      return asynError;
+    }
+    calls++;
+    
+    // The raw trigger mode needs to be converted to the index of the mbbo/mbbi
+    tmode = this->trigModeToEPICS(this->triggerMode);
+    
+    status |= setIntegerParam(ADTriggerMode, tmode);
+    status |= setIntegerParam(PhotronAfterFrames, this->trigAFrames);
+    status |= setIntegerParam(PhotronRandomFrames, this->trigRFrames);
+    status |= setIntegerParam(PhotronRecCount, this->trigRCount);
   }
   
-  // The raw trigger mode needs to be converted to the index of the mbbo/mbbi
-  tmode = this->trigModeToEPICS(this->triggerMode);
-  
-  status |= setIntegerParam(ADTriggerMode, tmode);
-  status |= setIntegerParam(PhotronAfterFrames, this->trigAFrames);
-  status |= setIntegerParam(PhotronRandomFrames, this->trigRFrames);
-  status |= setIntegerParam(PhotronRecCount, this->trigRCount);
-  
-  if (functionList[PDC_EXIST_SHADING] == PDC_EXIST_SUPPORTED) {
+  if ((groups & PHOTRON_REFRESH_SHADING) && 
+      (functionList[PDC_EXIST_SHADING] == PDC_EXIST_SUPPORTED)) {
     nRet = PDC_GetShadingMode(this->nDeviceNo, this->nChildNo, &(this->shadingMode),
                               &nErrorCode);
     if (nRet == PDC_FAILED) {
       printf("PDC_GetShadingMode failed %d\n", nErrorCode);
       return asynError;
     } else {
+      calls++;
       smode = this->shadingModeToEPICS(this->shadingMode);
       status |= setIntegerParam(PhotronShadingMode, smode);
     }
   }
   
-  if (this->functionList[PDC_EXIST_BITDEPTH] == PDC_EXIST_SUPPORTED) {
+  if ((groups & PHOTRON_REFRESH_PIXEL) &&
+      (this->functionList[PDC_EXIST_BITDEPTH] == PDC_EXIST_SUPPORTED)) {
     nRet = PDC_GetBitDepth(this->nDeviceNo, this->nChildNo, &bitDepthChar,
                            &nErrorCode);
     if (nRet == PDC_FAILED) {
       printf("PDC_GetBitDepth failed %d\n", nErrorCode);
       return asynError;
     } else {
+      calls++;
       this->bitDepth = (unsigned long) bitDepthChar;
     }
   }
   
-  if (this->functionList[PDC_EXIST_IRIG] == PDC_EXIST_SUPPORTED) {
-    nRet = PDC_GetIRIG(this->nDeviceNo, &(this->IRIG), &nErrorCode);
-    if (nRet == PDC_FAILED) {
-      printf("PDC_GetIRIG failed %d\n", nErrorCode);
-      return asynError;
-    }
-  } else {
-    this->IRIG = 0;
-  }
-  status |= setIntegerParam(PhotronIRIG, this->IRIG);
-  
-  //
-  if (this->functionList[PDC_EXIST_SYNC_PRIORITY] == PDC_EXIST_SUPPORTED) {
-    nRet = PDC_GetSyncPriority(this->nDeviceNo, &(this->syncPriority), &nErrorCode);
-    if (nRet == PDC_FAILED) {
-      printf("PDC_GetSyncPriority failed %d\n", nErrorCode);
-      return asynError;
-    }
-  } else {
-    this->syncPriority = 0;
-  }
-  status |= setIntegerParam(PhotronSyncPriority, this->syncPriority);
-  
-  for (index=0; index<PDC_EXTIO_MAX_PORT; index++) {
-    if (index < (int)this->inPorts) {
-      nRet = PDC_GetExternalInMode(this->nDeviceNo, index+1, 
-                                   &(this->ExtInMode[index]), &nErrorCode);
+  if (groups & PHOTRON_REFRESH_IRIG) {
+    if (this->functionList[PDC_EXIST_IRIG] == PDC_EXIST_SUPPORTED) {
+      nRet = PDC_GetIRIG(this->nDeviceNo, &(this->IRIG), &nErrorCode);
       if (nRet == PDC_FAILED) {
-        printf("PDC_GetExternalInMode failed %d; index=%d\n", nErrorCode, index);
+        printf("PDC_GetIRIG failed %d\n", nErrorCode);
         return asynError;
       }
-      eVal = this->inputModeToEPICS(this->ExtInMode[index]);
+      calls++;
     } else {
-      // This is necessary to avoid weird values for uninitialized mbbi records
-      eVal = 0;
+      this->IRIG = 0;
     }
-    setIntegerParam(*PhotronExtInSig[index], eVal);
-  }
-
-  for (index=0; index<PDC_EXTIO_MAX_PORT; index++) {
-    if (index < (int)this->outPorts) {
-      nRet = PDC_GetExternalOutMode(this->nDeviceNo, index+1, 
-                                    &(this->ExtOutMode[index]), &nErrorCode);
+    status |= setIntegerParam(PhotronIRIG, this->IRIG);
+    
+    //
+    if (this->functionList[PDC_EXIST_SYNC_PRIORITY] == PDC_EXIST_SUPPORTED) {
+      nRet = PDC_GetSyncPriority(this->nDeviceNo, &(this->syncPriority), &nErrorCode);
       if (nRet == PDC_FAILED) {
-        printf("PDC_GetExternalOutMode failed %d; index=%d\n", nErrorCode, index);
+        printf("PDC_GetSyncPriority failed %d\n", nErrorCode);
         return asynError;
       }
-      eVal = this->outputModeToEPICS(this->ExtOutMode[index]);
+      calls++;
     } else {
-      // This is necessary to avoid weird values for uninitialized mbbi records
-      eVal = 0;
+      this->syncPriority = 0;
     }
-    setIntegerParam(*PhotronExtOutSig[index], eVal);
-  }
-  
-  // Does this ever change?
-  nRet = PDC_GetRecordRateList(this->nDeviceNo, this->nChildNo, 
-                               &(this->RateListSize), 
-                               this->RateList, &nErrorCode);
-  if (nRet == PDC_FAILED) {
-    printf("PDC_GetRecordRateList failed %d\n", nErrorCode);
-    return asynError;
+    status |= setIntegerParam(PhotronSyncPriority, this->syncPriority);
   }
   
-  // Does this ever change?
-  nRet = PDC_GetVariableRecordRateList(this->nDeviceNo, this->nChildNo, 
-                               &(this->VariableRateListSize), 
-                               this->VariableRateList, &nErrorCode);
-  if (nRet == PDC_FAILED) {
-    printf("PDC_GetVariableRecordRateList failed %d\n", nErrorCode);
-    return asynError;
+  if (groups & PHOTRON_REFRESH_EXTIO) {
+    for (index=0; index<PDC_EXTIO_MAX_PORT; index++) {
+      if (index < (int)this->inPorts) {
+        nRet = PDC_GetExternalInMode(this->nDeviceNo, index+1, 
+                                     &(this->ExtInMode[index]), &nErrorCode);
+        if (nRet == PDC_FAILED) {
+          printf("PDC_GetExternalInMode failed %d; index=%d\n", nErrorCode, index);
+          return asynError;
+        }
+        calls++;
+        eVal = this->inputModeToEPICS(this->ExtInMode[index]);
+      } else {
+        // This is necessary to avoid weird values for uninitialized mbbi records
+        eVal = 0;
+      }
+      setIntegerParam(*PhotronExtInSig[index], eVal);
+    }
+    
+    for (index=0; index<PDC_EXTIO_MAX_PORT; index++) {
+      if (index < (int)this->outPorts) {
+        nRet = PDC_GetExternalOutMode(this->nDeviceNo, index+1, 
+                                      &(this->ExtOutMode[index]), &nErrorCode);
+        if (nRet == PDC_FAILED) {
+          printf("PDC_GetExternalOutMode failed %d; index=%d\n", nErrorCode, index);
+          return asynError;
+        }
+        calls++;
+        eVal = this->outputModeToEPICS(this->ExtOutMode[index]);
+      } else {
+        // This is necessary to avoid weird values for uninitialized mbbi records
+        eVal = 0;
+      }
+      setIntegerParam(*PhotronExtOutSig[index], eVal);
+    }
   }
   
-  // Can this be moved to the setRecordRate method? Does anything else effect it?
-  nRet = PDC_GetResolutionList(this->nDeviceNo, this->nChildNo, 
-                               &(this->ResolutionListSize),
-                               this->ResolutionList, &nErrorCode);
-  if (nRet == PDC_FAILED) {
-    printf("PDC_GetResolutionList failed %d\n", nErrorCode);
-    return asynError;
+  // The rate lists only change when the camera mode does
+  if (groups & PHOTRON_REFRESH_MODE) {
+    nRet = PDC_GetRecordRateList(this->nDeviceNo, this->nChildNo, 
+                                 &(this->RateListSize), 
+                                 this->RateList, &nErrorCode);
+    if (nRet == PDC_FAILED) {
+      printf("PDC_GetRecordRateList failed %d\n", nErrorCode);
+      return asynError;
+    }
+    calls++;
+    
+    nRet = PDC_GetVariableRecordRateList(this->nDeviceNo, this->nChildNo, 
+                                 &(this->VariableRateListSize), 
+                                 this->VariableRateList, &nErrorCode);
+    if (nRet == PDC_FAILED) {
+      printf("PDC_GetVariableRecordRateList failed %d\n", nErrorCode);
+      return asynError;
+    }
+    calls++;
   }
   
-  nRet = PDC_GetShutterSpeedFpsList(this->nDeviceNo, this->nChildNo,
-                                    &(this->ShutterSpeedFpsListSize),
-                                    this->ShutterSpeedFpsList, &nErrorCode);
-  if (nRet = PDC_FAILED) {
-    printf("PDC_GetShutterSpeedFpsList failed. error = %d\n", nErrorCode);
-    return asynError;
+  // The resolution and shutter lists depend on the recording rate
+  if (groups & PHOTRON_REFRESH_RATE) {
+    nRet = PDC_GetResolutionList(this->nDeviceNo, this->nChildNo, 
+                                 &(this->ResolutionListSize),
+                                 this->ResolutionList, &nErrorCode);
+    if (nRet == PDC_FAILED) {
+      printf("PDC_GetResolutionList failed %d\n", nErrorCode);
+      return asynError;
+    }
+    calls++;
+    
+    nRet = PDC_GetShutterSpeedFpsList(this->nDeviceNo, this->nChildNo,
+                                      &(this->ShutterSpeedFpsListSize),
+                                      this->ShutterSpeedFpsList, &nErrorCode);
+    if (nRet = PDC_FAILED) {
+      printf("PDC_GetShutterSpeedFpsList failed. error = %d\n", nErrorCode);
+      return asynError;
+    }
+    calls++;
   }
   
-  if (functionList[PDC_EXIST_HIGH_SPEED_MODE] == PDC_EXIST_SUPPORTED) {
-    nRet = PDC_GetHighSpeedMode(this->nDeviceNo, &(this->highSpeedMode),
+  if (groups & PHOTRON_REFRESH_TRANSFER) {
+    if (functionList[PDC_EXIST_HIGH_SPEED_MODE] == PDC_EXIST_SUPPORTED) {
+      nRet = PDC_GetHighSpeedMode(this->nDeviceNo, &(this->highSpeedMode),
+                                  &nErrorCode);
+      if (nRet == PDC_FAILED) {
+        printf("PDC_GetHighSpeedMode failed. Error %d\n", nErrorCode);
+        return asynError;
+      } 
+      calls++;
+    }
+    
+    nRet = PDC_GetBurstTransfer(this->nDeviceNo, &(this->burstTransfer), 
                                 &nErrorCode);
     if (nRet == PDC_FAILED) {
-      printf("PDC_GetHighSpeedMode failed. Error %d\n", nErrorCode);
+      printf("PDC_GetBurstTransfer failed. Error %d\n", nErrorCode);
       return asynError;
-    } 
+    }
+    calls++;
   }
   
-  nRet = PDC_GetBurstTransfer(this->nDeviceNo, &(this->burstTransfer), 
-                              &nErrorCode);
-  if (nRet == PDC_FAILED) {
-    printf("PDC_GetBurstTransfer failed. Error %d\n", nErrorCode);
-    return asynError;
+  // getGeometry needs to be called after the resolution list has been updated
+  if (groups & PHOTRON_REFRESH_RATE) {
+    status |= getGeometry();
+    // PDC_GetResolution and PDC_GetSegmentPosition
+    calls += 2;
   }
   
-  // getGeometry needs to be called after the resolution list has been updated
-  status |= getGeometry();
+  setIntegerParam(PhotronRefreshCalls, calls);
   
   /* Call the callbacks to update the values in higher layers */
   callParamCallbacks();
@@ -4944,6 +8948,7 @@ void Photron::report(FILE *fp, int details) {
     // put useful info here
     fprintf(fp, "  Camera Id:         %s\n",  this->cameraId);
     fprintf(fp, "  Auto-detect:       %d\n",  (int)this->autoDetect);
+    fprintf(fp, "  Child (head):      %d\n",  this->childNo);
     fprintf(fp, "  Device name:       %s\n",  this->deviceName);
     fprintf(fp, "  Device code:       %d\n",  (int)this->deviceCode);
     if (details > 8) {
@@ -5033,6 +9038,9 @@ void Photron::report(FILE *fp, int details) {
         fprintf(fp, "\t%d\t%02x\n", index, this->SyncPriorityList[index]);\
       }
     }
+#ifdef PDC_SIMULATION
+    PDCSim_Report(fp);
+#endif
   }
   
   if (details > 8) {
@@ -5045,11 +9053,12 @@ void Photron::report(FILE *fp, int details) {
 /** Configuration command, called directly or from iocsh */
 extern "C" int PhotronConfig(const char *portName, const char *ipAddress,
                              int autoDetect, int maxBuffers, int maxMemory,
-                             int priority, int stackSize) {
+                             int priority, int stackSize, int childNo,
+                             const char *linkIpAddress) {
   new Photron(portName, ipAddress, autoDetect,
               (maxBuffers < 0) ? 0 : maxBuffers,
               (maxMemory < 0) ? 0 : maxMemory, 
-              priority, stackSize);
+              priority, stackSize, childNo, linkIpAddress);
   return(asynSuccess);
 }
 
@@ -5061,22 +9070,114 @@ static const iocshArg PhotronConfigArg3 = {"maxBuffers", iocshArgInt};
 static const iocshArg PhotronConfigArg4 = {"maxMemory", iocshArgInt};
 static const iocshArg PhotronConfigArg5 = {"priority", iocshArgInt};
 static const iocshArg PhotronConfigArg6 = {"stackSize", iocshArgInt};
+static const iocshArg PhotronConfigArg7 = {"childNo", iocshArgInt};
+static const iocshArg PhotronConfigArg8 = {"Second IP address", iocshArgString};
 static const iocshArg * const PhotronConfigArgs[] =  {&PhotronConfigArg0,
                                                       &PhotronConfigArg1,
                                                       &PhotronConfigArg2,
                                                       &PhotronConfigArg3,
                                                       &PhotronConfigArg4,
                                                       &PhotronConfigArg5,
-                                                      &PhotronConfigArg6};
-static const iocshFuncDef configPhotron = {"PhotronConfig", 7, 
+                                                      &PhotronConfigArg6,
+                                                      &PhotronConfigArg7,
+                                                      &PhotronConfigArg8};
+static const iocshFuncDef configPhotron = {"PhotronConfig", 9, 
                                            PhotronConfigArgs};
 static void configPhotronCallFunc(const iocshArgBuf *args) {
     PhotronConfig(args[0].sval, args[1].sval, args[2].ival, args[3].ival,
-                  args[4].ival, args[5].ival, args[6].ival);
+                  args[4].ival, args[5].ival, args[6].ival, args[7].ival,
+                  args[8].sval);
+}
+
+#ifdef PDC_SIMULATION
+/** Configures the simulated camera; must be called before PhotronConfig */
+extern "C" int PhotronSimConfig(int width, int height, int bits, 
+                                double latencyUsec, double bandwidthMBps,
+                                int memFrames) {
+  PDCSim_Configure(width, height, bits, latencyUsec, bandwidthMBps, memFrames);
+  return(asynSuccess);
+}
+
+static const iocshArg PhotronSimConfigArg0 = {"width", iocshArgInt};
+static const iocshArg PhotronSimConfigArg1 = {"height", iocshArgInt};
+static const iocshArg PhotronSimConfigArg2 = {"bits", iocshArgInt};
+static const iocshArg PhotronSimConfigArg3 = {"latency (us)", iocshArgDouble};
+static const iocshArg PhotronSimConfigArg4 = {"bandwidth (MB/s)", iocshArgDouble};
+static const iocshArg PhotronSimConfigArg5 = {"memFrames", iocshArgInt};
+static const iocshArg * const PhotronSimConfigArgs[] = {&PhotronSimConfigArg0,
+                                                        &PhotronSimConfigArg1,
+                                                        &PhotronSimConfigArg2,
+                                                        &PhotronSimConfigArg3,
+                                                        &PhotronSimConfigArg4,
+                                                        &PhotronSimConfigArg5};
+static const iocshFuncDef configPhotronSim = {"PhotronSimConfig", 6,
+                                              PhotronSimConfigArgs};
+static void configPhotronSimCallFunc(const iocshArgBuf *args) {
+    PhotronSimConfig(args[0].ival, args[1].ival, args[2].ival, args[3].dval,
+                     args[4].dval, args[5].ival);
+}
+
+/** Gives the simulated camera at ipAddress a second interface at linkIpAddress */
+extern "C" int PhotronSimAddLink(const char *ipAddress, 
+                                 const char *linkIpAddress) {
+  struct in_addr ipAddr, linkIpAddr;
+  
+  if (hostToIPAddr(ipAddress, &ipAddr) || 
+      hostToIPAddr(linkIpAddress, &linkIpAddr)) {
+    printf("PhotronSimAddLink: invalid address\n");
+    return(asynError);
+  }
+  PDCSim_AddLink(ntohl(ipAddr.s_addr), ntohl(linkIpAddr.s_addr));
+  return(asynSuccess);
+}
+
+static const iocshArg PhotronSimAddLinkArg0 = {"IP address", iocshArgString};
+static const iocshArg PhotronSimAddLinkArg1 = {"Second IP address", iocshArgString};
+static const iocshArg * const PhotronSimAddLinkArgs[] = {&PhotronSimAddLinkArg0,
+                                                         &PhotronSimAddLinkArg1};
+static const iocshFuncDef addLinkPhotronSim = {"PhotronSimAddLink", 2,
+                                               PhotronSimAddLinkArgs};
+static void addLinkPhotronSimCallFunc(const iocshArgBuf *args) {
+    PhotronSimAddLink(args[0].sval, args[1].sval);
+}
+
+/** Marks an event every interval frames of each simulated recording */
+extern "C" int PhotronSimEvents(int interval) {
+  PDCSim_SetEventInterval(interval);
+  return(asynSuccess);
+}
+
+static const iocshArg PhotronSimEventsArg0 = {"Event interval", iocshArgInt};
+static const iocshArg * const PhotronSimEventsArgs[] = {&PhotronSimEventsArg0};
+static const iocshFuncDef eventsPhotronSim = {"PhotronSimEvents", 1,
+                                              PhotronSimEventsArgs};
+static void eventsPhotronSimCallFunc(const iocshArgBuf *args) {
+    PhotronSimEvents(args[0].ival);
+}
+
+/** Gives the simulated cameras numHeads heads, read by ports with childNo 1.. */
+extern "C" int PhotronSimHeads(int numHeads) {
+  PDCSim_SetChildCount(numHeads);
+  return(asynSuccess);
+}
+
+static const iocshArg PhotronSimHeadsArg0 = {"Number of heads", iocshArgInt};
+static const iocshArg * const PhotronSimHeadsArgs[] = {&PhotronSimHeadsArg0};
+static const iocshFuncDef headsPhotronSim = {"PhotronSimHeads", 1,
+                                             PhotronSimHeadsArgs};
+static void headsPhotronSimCallFunc(const iocshArgBuf *args) {
+    PhotronSimHeads(args[0].ival);
 }
+#endif
 
 static void PhotronRegister(void) {
     iocshRegister(&configPhotron, configPhotronCallFunc);
+#ifdef PDC_SIMULATION
+    iocshRegister(&configPhotronSim, configPhotronSimCallFunc);
+    iocshRegister(&addLinkPhotronSim, addLinkPhotronSimCallFunc);
+    iocshRegister(&eventsPhotronSim, eventsPhotronSimCallFunc);
+    iocshRegister(&headsPhotronSim, headsPhotronSimCallFunc);
+#endif
 }
 
 extern "C" {
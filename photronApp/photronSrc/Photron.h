@@ -1,7 +1,15 @@
 #include <epicsEvent.h>
+#include <epicsThread.h>
+#include <epicsMutex.h>
+#include <epicsMessageQueue.h>
 #include "ADDriver.h"
 
+#ifdef _WIN32
 #include "SDK/Include/PDCLIB.h"
+#else
+/* Simulated PDCLIB from photronSupport/pdcSim */
+#include "PDCLIB.h"
+#endif
 
 #define NUM_TRIGGER_MODES 14
 #define NUM_INPUT_MODES 17
@@ -9,12 +17,249 @@
 #define NUM_SHADING_MODES 7
 #define MAX_ENUM_STRING_SIZE 26
 #define NUM_VAR_CHANS 20
+#define MAX_READOUT_DEPTH 64
+/* Threads that process memory frames between the transfer and publish stages */
+#define MAX_READOUT_WORKERS 8
+/* Preview frames kept in memory by readMemImage and the read-ahead */
+#define MAX_PREVIEW_CACHE 256
+/* Frames sampled by the thumbnail index of a recording, and the memory the
+   thumbnails may take */
+#define MAX_INDEX_POINTS 4096
+#define MAX_INDEX_BYTES (64 * 1024 * 1024)
+/* Frames playback transfers ahead of the play cursor */
+#define MAX_PLAY_DEPTH 16
+/* Ranges in PhotronReadoutRanges, and the length of the string */
+#define MAX_READOUT_RANGES 32
+#define MAX_RANGES_STRING 256
+/* Camera interfaces a striped readout transfers over */
+#define MAX_READOUT_LINKS 2
+#define NUM_TRANSFER_BUFFERS 2
+#define TRANSFER_BUFFER_ALIGN 4096
+/* Limits (seconds) on the recording status poll period */
+#define PHOTRON_POLL_MIN 0.001
+#define PHOTRON_POLL_MAX 0.1
+/* Number of frames whose IRIG times are fetched ahead of a memory transfer */
+#define IRIG_PREFETCH_FRAMES 32
+/* Minimum time (seconds) between readout checkpoint updates */
+#define CHECKPOINT_PERIOD 0.5
+/* PhotronReadoutFormat choices for 12-bit memory frames */
+#define READOUT_FORMAT_NATIVE   0  /* 2 bytes per pixel */
+#define READOUT_FORMAT_8BIT     1  /* pixel >> PhotronReadoutShift, clipped at 255 */
+#define READOUT_FORMAT_PACKED12 2  /* 2 pixels in 3 bytes; raw files only */
+/* Threads that share the flat/dark correction of a frame */
+#define MAX_CORR_THREADS 8
+/* Maps a correction capture averages frames into */
+#define CORR_CAPTURE_DARK 1
+#define CORR_CAPTURE_FLAT 2
+
+/* Groups of camera settings re-read by readParameters. The status is always
+   read; each setter only refreshes the groups it can invalidate. */
+#define PHOTRON_REFRESH_STATUS   0x0000
+#define PHOTRON_REFRESH_MODE     0x0001  /* cam mode and rate lists */
+#define PHOTRON_REFRESH_RATE     0x0002  /* rate, max frames, res/shutter lists, geometry */
+#define PHOTRON_REFRESH_SHUTTER  0x0004
+#define PHOTRON_REFRESH_TRIGGER  0x0008
+#define PHOTRON_REFRESH_SHADING  0x0010
+#define PHOTRON_REFRESH_PIXEL    0x0020  /* bit depth */
+#define PHOTRON_REFRESH_IRIG     0x0040  /* IRIG and sync priority */
+#define PHOTRON_REFRESH_EXTIO    0x0080
+#define PHOTRON_REFRESH_TRANSFER 0x0100  /* burst transfer and high speed mode */
+#define PHOTRON_REFRESH_ALL      0x01FF
 
 typedef struct {
   int value;
   char string[MAX_ENUM_STRING_SIZE];
 } enumStruct_t;
 
+class Photron;
+
+/* All PDCLIB calls are made by PhotronSDKTask. Other threads queue commands 
+   at one of these priorities and wait for them to complete. */
+typedef enum {
+  SDK_PRIORITY_HIGH,    /* triggering and stopping */
+  SDK_PRIORITY_NORMAL,  /* control writes, status polls and image transfers */
+  SDK_PRIORITY_LOW,     /* parameter refreshes */
+  NUM_SDK_PRIORITIES
+} sdkPriority_t;
+
+#define SDK_QUEUE_SIZE 16
+
+typedef enum {
+  SDK_CMD_GET_STATUS,   /* result = camera status */
+  SDK_CMD_LIVE_IMAGE,   /* pImage = new live image */
+  SDK_CMD_MEM_IMAGE,    /* frame index into pData, IRIG into pIRIG if not NULL;
+                           the only command that can run on the second link */
+  SDK_CMD_CALL,         /* run method */
+  SDK_CMD_WRITE_INT32,  /* run the camera part of writeInt32 */
+  SDK_CMD_WRITE_FLOAT64,/* run the camera part of writeFloat64 */
+  SDK_CMD_REFRESH       /* readParameters(arg) */
+} sdkCommandType_t;
+
+typedef asynStatus (Photron::*sdkMethod_t)();
+
+/* A queued SDK command. The commands that use the parameter library (CALL,
+   WRITE_*, REFRESH) must be queued with the port lock held; the SDK thread 
+   never takes the port lock itself. */
+typedef struct {
+  sdkCommandType_t type;
+  int link;                 /* 1 = second interface, set by sdkSubmit */
+  /* Arguments */
+  long arg;                 /* frame index or refresh groups */
+  unsigned long bitDepth;   /* transfer bit depth for SDK_CMD_MEM_IMAGE */
+  void *pData;
+  PDC_IRIG_INFO *pIRIG;
+  unsigned long roiX;       /* region SDK_CMD_MEM_IMAGE keeps in pData; */
+  unsigned long roiY;       /* a roiWidth of 0 keeps the whole frame */
+  unsigned long roiWidth;
+  unsigned long roiHeight;
+  int format;               /* READOUT_FORMAT_* of the pixels in pData */
+  int shift;                /* window of READOUT_FORMAT_8BIT */
+  sdkMethod_t method;
+  asynUser *pasynUser;
+  int function;
+  epicsInt32 value;
+  epicsInt32 oldValue;
+  epicsFloat64 dvalue;
+  /* Results */
+  asynStatus status;
+  unsigned long nRet;
+  unsigned long nErrorCode;
+  unsigned long result;
+  NDArray *pImage;
+  int refresh;
+  int skipReadParams;
+  /* Signalled by the SDK thread when the command is done */
+  epicsEventId doneEventId;
+} sdkCommand_t;
+
+/* A frame of the playback ring, transferred ahead of the play cursor */
+typedef struct {
+  sdkCommand_t cmd;
+  NDArray *pImage;
+  PDC_IRIG_INFO tData;
+  int index;
+} playFrame_t;
+
+/* A frame passed from the memory transfer stage to the publish stage */
+typedef struct {
+  NDArray *pImage;   /* NULL with pRaw marks the end of a readout */
+  void *pRaw;        /* Stream buffer when writing to a raw file instead */
+  int index;         /* Frame number in camera memory */
+  asynStatus status; /* Status of the memory transfer */
+  PDC_IRIG_INFO tData;
+} readoutFrame_t;
+
+/* A memory readout processing thread. Frames are dealt to the workers in 
+   turn and collected from their output queues in the same order. */
+typedef struct {
+  Photron *pPvt;
+  epicsMessageQueueId inQueueId;
+  epicsMessageQueueId outQueueId;
+} readoutWorker_t;
+
+/* A preview frame cached by memory index; pImage is NULL if the slot is free.
+   Once published the array may be held by plugins, so it isn't changed. */
+typedef struct {
+  long frame;
+  NDArray *pImage;
+  PDC_IRIG_INFO tData;
+  unsigned long lastUse;
+  int published;
+} previewEntry_t;
+
+/* Frames first, first+stride, ... up to last of a memory readout */
+typedef struct {
+  long first;
+  long last;
+  int stride;
+} readoutRange_t;
+
+/* Progress of a memory readout, saved to PhotronCheckpointFile so that an
+   interrupted readout of the same recording can be resumed */
+typedef struct {
+  char cameraId[256];
+  int childNo;
+  /* Identifies the recording */
+  long frameStart;
+  long frameEnd;
+  long frameTrigger;
+  long recordedFrames;
+  unsigned long width;
+  unsigned long height;
+  unsigned long bits;
+  unsigned long rate;
+  unsigned long tMode;
+  PDC_IRIG_INFO tDataStart;
+  /* Region of each frame that is read out */
+  unsigned long roiX;
+  unsigned long roiY;
+  unsigned long roiWidth;
+  unsigned long roiHeight;
+  /* Pixel format of the stored frames */
+  int format;
+  int shift;
+  /* Requested frames and the last one handed to the plugins or raw file */
+  int rangeStart;
+  int rangeEnd;
+  int stride;
+  char ranges[MAX_RANGES_STRING];
+  int frame;
+  /* Raw stream state when the frames went to a raw file */
+  int raw;
+  int rawDirectIO;
+  double rawBytes;
+  long rawIndexPos;
+  char rawFile[MAX_FILENAME_LEN];
+} readoutCheckpoint_t;
+
+/* Flat/dark correction maps for the region x, y, width x height of frames
+   of type dataType. A capture or load replaces them with a new set, so the 
+   frames being corrected keep a reference, and the last one frees them. */
+typedef struct {
+  int refCount;
+  epicsUInt16 *pDark;
+  epicsUInt16 *pGain;
+  unsigned long x;
+  unsigned long y;
+  unsigned long width;
+  unsigned long height;
+  NDDataType_t dataType;
+} corrMaps_t;
+
+/* A band of rows of a frame queued by correctImage for the PhotronCorrTask
+   threads; doneEventId is signaled when it is corrected */
+typedef struct {
+  NDArray *pImage;
+  const corrMaps_t *pMaps;
+  int firstRow;
+  int numRows;
+  epicsEventId doneEventId;
+} corrBand_t;
+
+/* A camera shared by the ports that read its heads. PDCLIB takes one command
+   at a time per device, so each port holds sdkLock around its PDCLIB calls, 
+   and linkLock around the transfers over the second interface. numReading 
+   counts the heads downloading the memory; the camera stays in playback 
+   until it returns to zero. Entries live as long as the IOC. */
+typedef struct {
+  ELLNODE node;
+  char *cameraId;
+  epicsMutexId sdkLock;
+  epicsMutexId linkLock;
+  int numReading;
+} photronDevice_t;
+
+/* IRIG time of one memory frame, packed for the prefetch table */
+typedef struct {
+  epicsUInt32 microSecond;
+  epicsUInt16 dayOfYear;
+  epicsUInt8 hour;
+  epicsUInt8 minute;
+  epicsUInt8 second;
+  epicsUInt8 existSignal;
+  epicsUInt8 loaded;
+} irigEntry_t;
+
 static const char *triggerModeStrings[NUM_TRIGGER_MODES] = {
   "Start",
   "Center",
@@ -105,7 +350,8 @@ class epicsShareClass Photron : public ADDriver {
 public:
   /* Constructor and Destructor */
   Photron(const char *portName, const char *ipAddress, int autoDetect,
-          int maxBuffers, size_t maxMemory, int priority, int stackSize);
+          int maxBuffers, size_t maxMemory, int priority, int stackSize,
+          int childNo, const char *linkIpAddress);
   ~Photron();
 
   /* These methods are overwritten from asynPortDriver */
@@ -115,6 +361,8 @@ public:
   /* These are the methods that we override from ADDriver */
   virtual asynStatus writeInt32(asynUser *pasynUser, epicsInt32 value);
   virtual asynStatus writeFloat64(asynUser *pasynUser, epicsFloat64 value);
+  virtual asynStatus writeOctet(asynUser *pasynUser, const char *value, 
+                                size_t nChars, size_t *nActual);
   virtual asynStatus readEnum(asynUser *pasynUser, char *strings[], 
                               int values[], int severities[], 
                               size_t nElements, size_t *nIn);
@@ -124,6 +372,14 @@ public:
   void PhotronWaitTask(); 
   void PhotronRecTask(); 
   void PhotronPlayTask(); 
+  void PhotronPublishTask(); 
+  void PhotronSDKTask(); 
+  void PhotronLinkTask(); 
+  void PhotronCorrTask(); 
+  void PhotronProcessTask(readoutWorker_t *pWorker); 
+  void PhotronPreviewTask(); 
+  void PhotronIndexTask(); 
+  void PhotronGrabTask(); 
   
   /* These are called from C and so must be public */
   static void shutdown(void *arg);
@@ -210,8 +466,75 @@ protected:
     int PhotronExtOut4Sig;
     int PhotronShadingMode;
     int PhotronBurstTrans;
+    int PhotronReadoutRate;
+    int PhotronReadoutBandwidth;
+    int PhotronReadoutDepth;
+    int PhotronReadoutOccupancy;
+    int PhotronTransferBufAllocs;
+    int PhotronTransferBufSize;
+    int PhotronRefreshCalls;
+    int PhotronPollRate;
+    int PhotronTransLatency;
+    int PhotronRawEnable;
+    int PhotronRawFile;
+    int PhotronRawDirectIO;
+    int PhotronRawWriteRate;
+    int PhotronStripedReadout;
+    int PhotronLinkConnected;
+    int PhotronCheckpointFile;
+    int PhotronResumeReadout;
+    int PhotronResumeFrame;
+    int PhotronResumeValid;
+    int PhotronReadoutStride;
+    int PhotronReadoutRanges;
+    int PhotronReadoutFrames;
+    int PhotronEventReadout;
+    int PhotronEventPreFrames;
+    int PhotronEventPostFrames;
+    int PhotronEventCount;
+    int PhotronReadoutMinX;
+    int PhotronReadoutMinY;
+    int PhotronReadoutSizeX;
+    int PhotronReadoutSizeY;
+    int PhotronReadoutFormat;
+    int PhotronReadoutShift;
+    int PhotronCorrEnable;
+    int PhotronCorrCaptureDark;
+    int PhotronCorrCaptureFlat;
+    int PhotronCorrFrames;
+    int PhotronCorrDarkValid;
+    int PhotronCorrFlatValid;
+    int PhotronCorrThreads;
+    int PhotronCorrFile;
+    int PhotronCorrTime;
+    int PhotronReadoutWorkers;
+    int PhotronAttrSnapshot;
+    int PhotronPreviewCacheSize;
+    int PhotronPreviewReadAhead;
+    int PhotronPreviewCached;
+    int PhotronPreviewHitRate;
+    int PhotronIndexEnable;
+    int PhotronIndexStride;
+    int PhotronIndexBin;
+    int PhotronIndexBusy;
+    int PhotronIndexPoints;
+    int PhotronIndexFrames;
+    int PhotronIndexMean;
+    int PhotronIndexThumbFrame;
+    int PhotronIndexThumb;
+    int PhotronIndexThumbWidth;
+    int PhotronIndexThumbHeight;
+    int PhotronPMPlayDepth;
+    int PhotronPMPlayRate;
+    int PhotronPMPlayDropped;
+    int PhotronLiveDelivery;
+    int PhotronLiveGrabbed;
+    int PhotronLivePublished;
+    int PhotronLiveDropped;
+    int PhotronLiveBin;
+    int PhotronLiveBinMode;
     #define FIRST_PHOTRON_PARAM PhotronStatus
-    #define LAST_PHOTRON_PARAM PhotronBurstTrans
+    #define LAST_PHOTRON_PARAM PhotronLiveBinMode
     
     int* PhotronExtInSig[PDC_EXTIO_MAX_PORT];
     int* PhotronExtOutSig[PDC_EXTIO_MAX_PORT];
@@ -220,6 +543,15 @@ private:
   /* These are the methods that are new to this class */
   asynStatus disconnectCamera();
   asynStatus connectCamera();
+  Photron *findSharedDevice();
+  void closeDevice();
+  int claimPlayback();
+  int releasePlayback();
+  int otherHeadsReading();
+  void setRecordWait(int value);
+  void waitForOtherHeads();
+  asynStatus openDevice(const char *address, int autoDetect, 
+                        unsigned long *pDeviceNo);
   asynStatus getCameraInfo();
   asynStatus updateResolution();
   asynStatus setValidWidth(epicsInt32 value);
@@ -228,11 +560,66 @@ private:
   asynStatus changeResIndex(epicsInt32 value);
   asynStatus setGeometry();
   asynStatus getGeometry();
-  asynStatus readParameters();
+  asynStatus readParameters(int groups=PHOTRON_REFRESH_ALL);
+  asynStatus sdkExecute(sdkCommand_t *pCmd, int priority);
+  asynStatus sdkSubmit(sdkCommand_t *pCmd, int priority, int link);
+  asynStatus sdkWait(sdkCommand_t *pCmd);
+  int sdkDone(sdkCommand_t *pCmd);
+  asynStatus sdkCall(sdkMethod_t method, int priority);
+  asynStatus sdkRefresh(int groups);
+  asynStatus sdkGetStatus(unsigned long *pStatus, unsigned long *pErrorCode);
+  void runSDKCommand(sdkCommand_t *pCmd);
+  asynStatus writeInt32Camera(sdkCommand_t *pCmd);
+  asynStatus writeFloat64Camera(sdkCommand_t *pCmd);
   asynStatus readVariableInfo();
   asynStatus readImage();
+  asynStatus readLatestImage();
+  void storeLiveImage(NDArray *pImage);
+  NDArray *binLiveImage(NDArray *pImage, int bin, int sum);
+  asynStatus readLiveImage(sdkCommand_t *pCmd);
+  asynStatus readMemFrame(sdkCommand_t *pCmd);
   asynStatus readMemImage(epicsInt32 value);
+  int findPreviewFrame(long frame, int touch);
+  void storePreviewFrame(long frame, NDArray *pImage, PDC_IRIG_INFO *pData,
+                         int published);
+  void clearPreviewCache();
+  long nextPreviewFrame();
+  asynStatus buildIndex();
+  void publishIndex();
+  void publishIndexThumb();
+  int nextPlayFrame(int index, int start, int end);
   asynStatus readImageRange();
+  asynStatus startReadoutWorker();
+  void updateCounterAttributes(NDAttributeList *pList, int imageCounter,
+                               int numImagesCounter);
+  asynStatus parseReadoutRanges(const char *spec, int stride, 
+                                readoutRange_t *pRanges, int *pNumRanges);
+  int planReadout(int start, int end, int stride, const char *spec);
+  int makeEventRanges(char *spec, size_t size);
+  void trimReadoutRanges(long first, long last);
+  int countReadoutFrames();
+  asynStatus resizeTransferBuffers();
+  void resetIRIGTable(long first, long last);
+  void prefetchIRIG(long frame);
+  int lookupIRIG(long frame, PDC_IRIG_INFO *pData);
+  asynStatus openRawStream(int numFrames, size_t frameSize, int numBuffers,
+                           const readoutCheckpoint_t *pResume);
+  void writeRawFrame(readoutFrame_t *pFrame, int uniqueId);
+  void closeRawStream();
+  void initCheckpoint(readoutCheckpoint_t *pCheckpoint);
+  asynStatus loadCheckpoint(readoutCheckpoint_t *pCheckpoint);
+  int matchCheckpoint(const readoutCheckpoint_t *pCheckpoint);
+  void saveCheckpoint(int force);
+  void clearCheckpoint();
+  void resumeReadout();
+  void correctImage(NDArray *pImage);
+  void correctRows(NDArray *pImage, const corrMaps_t *pMaps, int firstRow, 
+                   int numRows);
+  int captureCorrFrame(NDArray *pImage);
+  void resetCorrMaps(unsigned long x, unsigned long y, unsigned long width,
+                     unsigned long height, NDDataType_t dataType);
+  asynStatus saveCorrMaps();
+  asynStatus loadCorrMaps();
   asynStatus setTransferOption();
   asynStatus setRecordRate(epicsInt32 value, epicsInt32 flag);
   asynStatus changeRecordRate(epicsInt32 value);
@@ -265,6 +652,7 @@ private:
   asynStatus setPixelFormat();
   asynStatus setTriggerMode();
   asynStatus softwareTrigger();
+  double expectedRecordTime();
   asynStatus setRecReady();
   asynStatus setEndless();
   asynStatus setLive();
@@ -301,8 +689,18 @@ private:
   // constructor
   char *cameraId;                /* This can be an IP name, or IP address */
   int autoDetect;
+  int childNo;                   /* Head of a multi-head camera, from 1 */
+  char *linkCameraId;            /* Second interface of the camera, or NULL */
   epicsEventId startEventId;
   epicsEventId stopEventId;
+  epicsEventId grabStartEventId;
+  epicsEventId liveFrameEventId;
+  NDArray *liveLatest;       /* newest grabbed frame not yet published */
+  int liveGrabbing;          /* PhotronGrabTask is running */
+  asynStatus liveStatus;     /* asynError if the grabber stopped on an error */
+  int liveGrabbed;
+  int livePublished;
+  int liveDropped;
   epicsEventId startWaitEventId;
   epicsEventId stopWaitEventId;
   epicsEventId startRecEventId;
@@ -310,9 +708,44 @@ private:
   epicsEventId resumeRecEventId;
   epicsEventId startPlayEventId;
   epicsEventId stopPlayEventId;
+  playFrame_t playRing[MAX_PLAY_DEPTH];
+  readoutWorker_t readoutWorkers[MAX_READOUT_WORKERS];
+  int numReadoutWorkers;     /* threads started */
+  int activeReadoutWorkers;  /* threads the current readout deals frames to */
+  int readoutInFlight;       /* frames dealt out and not yet published */
+  NDAttributeList *readoutAttributes;  /* evaluated at the start of a readout */
+  int attrSnapshot;          /* workers copy readoutAttributes */
+  epicsEventId readoutSpaceEventId;
+  epicsEventId readoutDoneEventId;
+  previewEntry_t previewCache[MAX_PREVIEW_CACHE];
+  unsigned long previewUseCount;
+  int previewGeneration;     /* bumped when the cache is cleared */
+  long previewLastIndex;     /* last frame shown, or -1 */
+  int previewDirection;      /* +1 or -1, the direction of travel */
+  long previewFetching;      /* frame the read-ahead is transferring, or -1 */
+  double previewLookups;
+  double previewHits;
+  epicsEventId previewEventId;
+  epicsEventId previewDoneEventId;
+  epicsEventId indexEventId;
+  int indexGeneration;       /* bumped when readMem loads a recording */
+  int indexCount;            /* frames indexed so far */
+  epicsInt32 indexFrames[MAX_INDEX_POINTS];
+  epicsFloat64 indexMeans[MAX_INDEX_POINTS];
+  epicsUInt16 *indexThumbs;  /* indexCount thumbnails */
+  epicsInt32 *indexThumbBuf; /* the thumbnail published as a waveform */
+  size_t indexThumbWidth;
+  size_t indexThumbHeight;
   // connectCamera
   unsigned long nDeviceNo;
-  unsigned long nChildNo;   // hard-coded to 1 in connectCamera
+  unsigned long nChildNo;
+  int deviceOpen;           // nDeviceNo is valid; may be shared with other heads
+  unsigned long nLinkDeviceNo;
+  int linkOpen;             // nLinkDeviceNo is the camera's second interface
+  // Shared with the other heads; the flags below are guarded by cameraListLock
+  photronDevice_t *pDevice;
+  int readingMemory;        // counted in pDevice->numReading
+  int recordWait;           // PhotronRecTask is waiting for the recording to end
   // getCameraInfo
   char functionList[98];   /* Indices (functions) range from 2 to 97 */
   unsigned long deviceCode;
@@ -397,9 +830,72 @@ private:
   PDC_IRIG_INFO tDataStart;
   PDC_IRIG_INFO tDataEnd;
   PDC_FRAME_INFO FrameInfo;
+  // SDK transfer buffers, sized by resizeTransferBuffers
+  void *transferBuf[NUM_TRANSFER_BUFFERS];
+  size_t transferBufSize;
+  int transferBufAllocs;
+  // IRIG times of the recorded frames, filled in by prefetchIRIG
+  irigEntry_t *irigTable;
+  long irigTableFirst;
+  long irigTableSize;
+  int irigStride;
+  // Frames of the memory readout in progress, built by planReadout
+  readoutRange_t readoutRanges[MAX_READOUT_RANGES];
+  int numReadoutRanges;
+  // Region of the memory frames the readout keeps, passed to readMemFrame
+  // with each of its transfers
+  int roiEnable;
+  unsigned long roiX;
+  unsigned long roiY;
+  unsigned long roiWidth;
+  unsigned long roiHeight;
+  // Conversion readMemFrame applies to each row of the region of the readout
+  int readoutFormat;
+  int readoutShift;
+  // Raw file stream written by PhotronPublishTask instead of the plugins
+  int rawFd;
+  FILE *rawIndexFile;
+  // One per frame in flight: the queued frames plus one per link
+  void *rawBuf[MAX_READOUT_DEPTH + MAX_READOUT_LINKS + 1];
+  int rawNumBuffers;
+  size_t rawFrameSize;
+  size_t rawStride;
+  double rawBytes;
+  double rawWriteTime;
+  int rawError;
+  // Readout checkpoint; written by PhotronPublishTask during a readout
+  char checkpointFile[MAX_FILENAME_LEN];
+  readoutCheckpoint_t checkpoint;
+  epicsTimeStamp checkpointTime;
+  int resumeFlag;
+  // Flat/dark correction maps and capture, guarded by corrMutex. The frames
+  // are corrected outside it with a reference to the maps.
+  epicsMutexId corrMutex;
+  corrMaps_t *corrMaps;
+  int corrDarkValid;
+  int corrFlatValid;
+  int corrEnable;
+  int corrThreads;
+  int corrWarned;
+  char corrFile[MAX_FILENAME_LEN];
+  // Frames being averaged by a capture, with the geometry of the first one
+  epicsUInt32 *corrSum;
+  unsigned long corrSumX;
+  unsigned long corrSumY;
+  unsigned long corrSumWidth;
+  unsigned long corrSumHeight;
+  NDDataType_t corrSumDataType;
+  int corrCapture;
+  int corrCaptureFrames;
+  int corrCaptureCount;
+  // Threads that correct the bands queued by every correctImage call, 
+  // started as needed
+  epicsMessageQueueId corrQueueId;
+  int numCorrWorkers;
   //
   epicsTimeStamp preIRIGStartTime;
   epicsTimeStamp postIRIGStartTime;
+  epicsTimeStamp readoutStartTime;
   int abortFlag;
   //
   int stopFlag;
@@ -407,6 +903,14 @@ private:
   //
   int stopRecFlag;
   int previewDone;
+  double recPollPeriod;
+  // SDK command queues, one per priority, and the thread that runs them
+  epicsMessageQueueId sdkQueueId[NUM_SDK_PRIORITIES];
+  epicsEventId sdkWakeEventId;
+  epicsThreadId sdkThreadId;
+  // Memory transfers over the second interface run on PhotronLinkTask
+  epicsMessageQueueId linkQueueId;
+  epicsThreadId linkThreadId;
   //
   int forceWait;
   /* Our data */
@@ -427,6 +931,12 @@ static void PhotronTaskC(void *drvPvt);
 static void PhotronWaitTaskC(void *drvPvt);
 static void PhotronRecTaskC(void *drvPvt);
 static void PhotronPlayTaskC(void *drvPvt);
+static void PhotronPublishTaskC(void *drvPvt);
+static void PhotronSDKTaskC(void *drvPvt);
+static void PhotronLinkTaskC(void *drvPvt);
+static void PhotronPreviewTaskC(void *drvPvt);
+static void PhotronIndexTaskC(void *drvPvt);
+static void PhotronGrabTaskC(void *drvPvt);
 
 typedef struct {
   ELLNODE node;
@@ -520,5 +1030,72 @@ typedef struct {
 #define PhotronExtOut4SigString  "PHOTRON_EXT_OUT_4_SIG" /* (asynInt32, rw)  */
 #define PhotronShadingModeString "PHOTRON_SHADING_MODE" /* (asynInt32, rw)  */
 #define PhotronBurstTransString  "PHOTRON_BURST_TRANS"  /* (asynInt32, rw)  */
+#define PhotronReadoutRateString "PHOTRON_READOUT_RATE" /* (asynFloat64, r) */
+#define PhotronReadoutBandwidthString "PHOTRON_READOUT_BANDWIDTH" /* (asynFloat64, r) */
+#define PhotronReadoutDepthString "PHOTRON_READOUT_DEPTH" /* (asynInt32, rw) */
+#define PhotronReadoutOccupancyString "PHOTRON_READOUT_OCCUPANCY" /* (asynInt32, r) */
+#define PhotronTransferBufAllocsString "PHOTRON_TRANSFER_BUF_ALLOCS" /* (asynInt32, r) */
+#define PhotronTransferBufSizeString "PHOTRON_TRANSFER_BUF_SIZE" /* (asynInt32, r) */
+#define PhotronRefreshCallsString "PHOTRON_REFRESH_CALLS" /* (asynInt32, r) */
+#define PhotronPollRateString "PHOTRON_POLL_RATE" /* (asynFloat64, r) */
+#define PhotronTransLatencyString "PHOTRON_TRANS_LATENCY" /* (asynFloat64, r) */
+#define PhotronRawEnableString "PHOTRON_RAW_ENABLE" /* (asynInt32, rw) */
+#define PhotronRawFileString "PHOTRON_RAW_FILE" /* (asynOctet, rw) */
+#define PhotronRawDirectIOString "PHOTRON_RAW_DIRECT_IO" /* (asynInt32, rw) */
+#define PhotronRawWriteRateString "PHOTRON_RAW_WRITE_RATE" /* (asynFloat64, r) */
+#define PhotronStripedReadoutString "PHOTRON_STRIPED_READOUT" /* (asynInt32, rw) */
+#define PhotronLinkConnectedString "PHOTRON_LINK_CONNECTED" /* (asynInt32, r) */
+#define PhotronCheckpointFileString "PHOTRON_CHECKPOINT_FILE" /* (asynOctet, rw) */
+#define PhotronResumeReadoutString "PHOTRON_RESUME_READOUT" /* (asynInt32, rw) */
+#define PhotronResumeFrameString "PHOTRON_RESUME_FRAME" /* (asynInt32, r) */
+#define PhotronResumeValidString "PHOTRON_RESUME_VALID" /* (asynInt32, r) */
+#define PhotronReadoutStrideString "PHOTRON_READOUT_STRIDE" /* (asynInt32, rw) */
+#define PhotronReadoutRangesString "PHOTRON_READOUT_RANGES" /* (asynOctet, rw) */
+#define PhotronReadoutFramesString "PHOTRON_READOUT_FRAMES" /* (asynInt32, r) */
+#define PhotronEventReadoutString "PHOTRON_EVENT_READOUT" /* (asynInt32, rw) */
+#define PhotronEventPreFramesString "PHOTRON_EVENT_PRE_FRAMES" /* (asynInt32, rw) */
+#define PhotronEventPostFramesString "PHOTRON_EVENT_POST_FRAMES" /* (asynInt32, rw) */
+#define PhotronEventCountString "PHOTRON_EVENT_COUNT" /* (asynInt32, r) */
+#define PhotronReadoutMinXString "PHOTRON_READOUT_MIN_X" /* (asynInt32, rw) */
+#define PhotronReadoutMinYString "PHOTRON_READOUT_MIN_Y" /* (asynInt32, rw) */
+#define PhotronReadoutSizeXString "PHOTRON_READOUT_SIZE_X" /* (asynInt32, rw) */
+#define PhotronReadoutSizeYString "PHOTRON_READOUT_SIZE_Y" /* (asynInt32, rw) */
+#define PhotronReadoutFormatString "PHOTRON_READOUT_FORMAT" /* (asynInt32, rw) */
+#define PhotronReadoutShiftString "PHOTRON_READOUT_SHIFT" /* (asynInt32, rw) */
+#define PhotronCorrEnableString "PHOTRON_CORR_ENABLE" /* (asynInt32, rw) */
+#define PhotronCorrCaptureDarkString "PHOTRON_CORR_CAPTURE_DARK" /* (asynInt32, rw) */
+#define PhotronCorrCaptureFlatString "PHOTRON_CORR_CAPTURE_FLAT" /* (asynInt32, rw) */
+#define PhotronCorrFramesString "PHOTRON_CORR_FRAMES" /* (asynInt32, rw) */
+#define PhotronCorrDarkValidString "PHOTRON_CORR_DARK_VALID" /* (asynInt32, r) */
+#define PhotronCorrFlatValidString "PHOTRON_CORR_FLAT_VALID" /* (asynInt32, r) */
+#define PhotronCorrThreadsString "PHOTRON_CORR_THREADS" /* (asynInt32, rw) */
+#define PhotronCorrFileString "PHOTRON_CORR_FILE" /* (asynOctet, rw) */
+#define PhotronCorrTimeString "PHOTRON_CORR_TIME" /* (asynFloat64, r) */
+#define PhotronReadoutWorkersString "PHOTRON_READOUT_WORKERS" /* (asynInt32, rw) */
+#define PhotronAttrSnapshotString "PHOTRON_ATTR_SNAPSHOT" /* (asynInt32, rw) */
+#define PhotronPreviewCacheSizeString "PHOTRON_PREVIEW_CACHE_SIZE" /* (asynInt32, rw) */
+#define PhotronPreviewReadAheadString "PHOTRON_PREVIEW_READ_AHEAD" /* (asynInt32, rw) */
+#define PhotronPreviewCachedString "PHOTRON_PREVIEW_CACHED" /* (asynInt32, r) */
+#define PhotronPreviewHitRateString "PHOTRON_PREVIEW_HIT_RATE" /* (asynFloat64, r) */
+#define PhotronIndexEnableString "PHOTRON_INDEX_ENABLE" /* (asynInt32, rw) */
+#define PhotronIndexStrideString "PHOTRON_INDEX_STRIDE" /* (asynInt32, rw) */
+#define PhotronIndexBinString "PHOTRON_INDEX_BIN" /* (asynInt32, rw) */
+#define PhotronIndexBusyString "PHOTRON_INDEX_BUSY" /* (asynInt32, r) */
+#define PhotronIndexPointsString "PHOTRON_INDEX_POINTS" /* (asynInt32, r) */
+#define PhotronIndexFramesString "PHOTRON_INDEX_FRAMES" /* (asynInt32Array, r) */
+#define PhotronIndexMeanString "PHOTRON_INDEX_MEAN" /* (asynFloat64Array, r) */
+#define PhotronIndexThumbFrameString "PHOTRON_INDEX_THUMB_FRAME" /* (asynInt32, rw) */
+#define PhotronIndexThumbString "PHOTRON_INDEX_THUMB" /* (asynInt32Array, r) */
+#define PhotronIndexThumbWidthString "PHOTRON_INDEX_THUMB_WIDTH" /* (asynInt32, r) */
+#define PhotronIndexThumbHeightString "PHOTRON_INDEX_THUMB_HEIGHT" /* (asynInt32, r) */
+#define PhotronPMPlayDepthString "PHOTRON_PM_PLAY_DEPTH" /* (asynInt32, rw) */
+#define PhotronPMPlayRateString "PHOTRON_PM_PLAY_RATE" /* (asynFloat64, r) */
+#define PhotronPMPlayDroppedString "PHOTRON_PM_PLAY_DROPPED" /* (asynInt32, r) */
+#define PhotronLiveDeliveryString "PHOTRON_LIVE_DELIVERY" /* (asynInt32, rw) */
+#define PhotronLiveGrabbedString "PHOTRON_LIVE_GRABBED" /* (asynInt32, r) */
+#define PhotronLivePublishedString "PHOTRON_LIVE_PUBLISHED" /* (asynInt32, r) */
+#define PhotronLiveDroppedString "PHOTRON_LIVE_DROPPED" /* (asynInt32, r) */
+#define PhotronLiveBinString "PHOTRON_LIVE_BIN" /* (asynInt32, rw) */
+#define PhotronLiveBinModeString "PHOTRON_LIVE_BIN_MODE" /* (asynInt32, rw) */
 
 #define NUM_PHOTRON_PARAMS ((int)(&LAST_PHOTRON_PARAM-&FIRST_PHOTRON_PARAM+1))
@@ -0,0 +1,327 @@
+/* PhotronConvert.cpp
+ *
+ * Pixel format conversions and flat/dark correction applied to frames on 
+ * the live and readout paths, live binning, and the thumbnails of the 
+ * recording index.
+ *
+ * The kernels process the bulk of each row with SSE2 and finish it with
+ * the scalar code, which is also what other targets run.
+ *
+ */
+
+#include <string.h>
+
+/* MSVC doesn't define __SSE2__, but x64 and /arch:SSE2 builds have it */
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define PHOTRON_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "PhotronConvert.h"
+
+
+void photronPack12(const epicsUInt16 *pSrc, epicsUInt8 *pDst, size_t numPixels) {
+  size_t index = 0;
+  unsigned int p0, p1;
+  
+#ifdef PHOTRON_SSE2
+  const __m128i mask12 = _mm_set1_epi16(0x0FFF);
+  const __m128i scale = _mm_set1_epi32(0x10000001);  /* (1, 4096) pairs */
+  const __m128i low24 = _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF);
+  const __m128i high24 = _mm_set_epi32(0x0000FFFF, (int)0xFF000000, 
+                                       0x0000FFFF, (int)0xFF000000);
+  __m128i v, pairs;
+  
+  // Each block of 8 pixels becomes 12 bytes. The stores write 2 bytes past
+  // the block, which the next block overwrites, so the loop stops while at
+  // least one more block of input remains for the scalar code.
+  for (; index + 16 <= numPixels; index += 8) {
+    v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(pSrc + index)), mask12);
+    // p0 + 4096 * p1 in each 32-bit lane: 24 bits per pixel pair
+    pairs = _mm_madd_epi16(v, scale);
+    // Close the gap between the two pairs of each 64-bit lane
+    pairs = _mm_or_si128(_mm_and_si128(pairs, low24),
+                         _mm_and_si128(_mm_srli_epi64(pairs, 8), high24));
+    _mm_storel_epi64((__m128i *)pDst, pairs);
+    _mm_storel_epi64((__m128i *)(pDst + 6), _mm_unpackhi_epi64(pairs, pairs));
+    pDst += 12;
+  }
+#endif
+  
+  for (; index + 2 <= numPixels; index += 2) {
+    p0 = pSrc[index] & 0x0FFF;
+    p1 = pSrc[index + 1] & 0x0FFF;
+    pDst[0] = (epicsUInt8)p0;
+    pDst[1] = (epicsUInt8)((p0 >> 8) | (p1 << 4));
+    pDst[2] = (epicsUInt8)(p1 >> 4);
+    pDst += 3;
+  }
+  if (index < numPixels) {
+    p0 = pSrc[index] & 0x0FFF;
+    pDst[0] = (epicsUInt8)p0;
+    pDst[1] = (epicsUInt8)(p0 >> 8);
+  }
+}
+
+
+void photronConvert8(const epicsUInt16 *pSrc, epicsUInt8 *pDst, 
+                     size_t numPixels, int shift) {
+  size_t index = 0;
+  unsigned int value;
+  
+#ifdef PHOTRON_SSE2
+  const __m128i count = _mm_cvtsi32_si128(shift);
+  const __m128i max8 = _mm_set1_epi16(255);
+  __m128i a, b;
+  
+  for (; index + 16 <= numPixels; index += 16) {
+    a = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(pSrc + index)), count);
+    b = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(pSrc + index + 8)), count);
+    // min(x, 255) without signed compares, so packus sees no negative words
+    a = _mm_sub_epi16(a, _mm_subs_epu16(a, max8));
+    b = _mm_sub_epi16(b, _mm_subs_epu16(b, max8));
+    _mm_storeu_si128((__m128i *)(pDst + index), _mm_packus_epi16(a, b));
+  }
+#endif
+  
+  for (; index < numPixels; index++) {
+    value = pSrc[index] >> shift;
+    pDst[index] = (epicsUInt8)((value > 255) ? 255 : value);
+  }
+}
+
+
+void photronCorrect16(epicsUInt16 *pData, const epicsUInt16 *pDark, 
+                      const epicsUInt16 *pGain, size_t numPixels, 
+                      epicsUInt16 maxValue) {
+  size_t index = 0;
+  unsigned int value;
+  
+#ifdef PHOTRON_SSE2
+  const __m128i max12 = _mm_set1_epi16(0x0FFF);
+  const __m128i maxOut = _mm_set1_epi16((short)maxValue);
+  __m128i v;
+  
+  for (; index + 8 <= numPixels; index += 8) {
+    v = _mm_subs_epu16(_mm_loadu_si128((const __m128i *)(pData + index)),
+                       _mm_loadu_si128((const __m128i *)(pDark + index)));
+    v = _mm_sub_epi16(v, _mm_subs_epu16(v, max12));
+    // (d << 4) * gain >> 16 is d * gain >> 12 in one unsigned multiply
+    v = _mm_mulhi_epu16(_mm_slli_epi16(v, 4), 
+                        _mm_loadu_si128((const __m128i *)(pGain + index)));
+    v = _mm_sub_epi16(v, _mm_subs_epu16(v, maxOut));
+    _mm_storeu_si128((__m128i *)(pData + index), v);
+  }
+#endif
+  
+  for (; index < numPixels; index++) {
+    value = (pData[index] > pDark[index]) ? pData[index] - pDark[index] : 0;
+    if (value > 0x0FFF) {
+      value = 0x0FFF;
+    }
+    value = (value * pGain[index]) >> 12;
+    pData[index] = (epicsUInt16)((value > maxValue) ? maxValue : value);
+  }
+}
+
+
+void photronCorrect8(epicsUInt8 *pData, const epicsUInt16 *pDark, 
+                     const epicsUInt16 *pGain, size_t numPixels) {
+  size_t index = 0;
+  unsigned int value;
+  
+#ifdef PHOTRON_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  __m128i v, a, b;
+  
+  // The pixels are widened to 16 bits; packus clips the results at 255
+  for (; index + 16 <= numPixels; index += 16) {
+    v = _mm_loadu_si128((const __m128i *)(pData + index));
+    a = _mm_subs_epu16(_mm_unpacklo_epi8(v, zero),
+                       _mm_loadu_si128((const __m128i *)(pDark + index)));
+    b = _mm_subs_epu16(_mm_unpackhi_epi8(v, zero),
+                       _mm_loadu_si128((const __m128i *)(pDark + index + 8)));
+    a = _mm_mulhi_epu16(_mm_slli_epi16(a, 4), 
+                        _mm_loadu_si128((const __m128i *)(pGain + index)));
+    b = _mm_mulhi_epu16(_mm_slli_epi16(b, 4), 
+                        _mm_loadu_si128((const __m128i *)(pGain + index + 8)));
+    _mm_storeu_si128((__m128i *)(pData + index), _mm_packus_epi16(a, b));
+  }
+#endif
+  
+  for (; index < numPixels; index++) {
+    value = (pData[index] > pDark[index]) ? pData[index] - pDark[index] : 0;
+    value = (value * pGain[index]) >> 12;
+    pData[index] = (epicsUInt8)((value > 255) ? 255 : value);
+  }
+}
+
+
+/* The thumbnails are built once per indexed frame, well behind the frame
+ * transfer, so they are plain C++ for both pixel sizes. */
+template <typename pixelType>
+static double photronThumb(const pixelType *pSrc, size_t width, size_t height,
+                           int bin, epicsUInt16 *pThumb) {
+  size_t thumbWidth = width / bin, thumbHeight = height / bin;
+  size_t x, y, tx, ty;
+  const pixelType *pRow;
+  epicsUInt32 rowSum, blockSum;
+  double sum = 0.0;
+  
+  for (ty=0; ty<thumbHeight; ty++) {
+    for (tx=0; tx<thumbWidth; tx++) {
+      blockSum = 0;
+      pRow = pSrc + ty * bin * width + tx * bin;
+      for (y=0; y<(size_t)bin; y++) {
+        for (x=0; x<(size_t)bin; x++) {
+          blockSum += pRow[x];
+        }
+        pRow += width;
+      }
+      pThumb[ty * thumbWidth + tx] = (epicsUInt16)(blockSum / (bin * bin));
+    }
+  }
+  
+  for (y=0; y<height; y++) {
+    pRow = pSrc + y * width;
+    rowSum = 0;
+    for (x=0; x<width; x++) {
+      rowSum += pRow[x];
+    }
+    sum += rowSum;
+  }
+  return (width && height) ? sum / (width * height) : 0.0;
+}
+
+
+double photronThumb16(const epicsUInt16 *pSrc, size_t width, size_t height,
+                      int bin, epicsUInt16 *pThumb) {
+  return photronThumb(pSrc, width, height, bin, pThumb);
+}
+
+
+double photronThumb8(const epicsUInt8 *pSrc, size_t width, size_t height,
+                     int bin, epicsUInt16 *pThumb) {
+  return photronThumb(pSrc, width, height, bin, pThumb);
+}
+
+
+/* Live binning sums bin rows into 32-bit column totals a chunk of columns at
+ * a time, then adds up each block's columns. A chunk holds whole blocks. */
+#define BIN_CHUNK 512
+
+static void binAddRow(epicsUInt32 *pAcc, const epicsUInt16 *pRow, size_t n) {
+  size_t index = 0;
+  
+#ifdef PHOTRON_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  __m128i v;
+  
+  for (; index + 8 <= n; index += 8) {
+    v = _mm_loadu_si128((const __m128i *)(pRow + index));
+    _mm_storeu_si128((__m128i *)(pAcc + index), 
+      _mm_add_epi32(_mm_loadu_si128((const __m128i *)(pAcc + index)),
+                    _mm_unpacklo_epi16(v, zero)));
+    _mm_storeu_si128((__m128i *)(pAcc + index + 4), 
+      _mm_add_epi32(_mm_loadu_si128((const __m128i *)(pAcc + index + 4)),
+                    _mm_unpackhi_epi16(v, zero)));
+  }
+#endif
+  
+  for (; index < n; index++) {
+    pAcc[index] += pRow[index];
+  }
+}
+
+
+static void binAddRow(epicsUInt32 *pAcc, const epicsUInt8 *pRow, size_t n) {
+  size_t index = 0;
+  
+#ifdef PHOTRON_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  __m128i v, w;
+  int half;
+  
+  for (; index + 16 <= n; index += 16) {
+    v = _mm_loadu_si128((const __m128i *)(pRow + index));
+    for (half=0; half<2; half++) {
+      w = half ? _mm_unpackhi_epi8(v, zero) : _mm_unpacklo_epi8(v, zero);
+      _mm_storeu_si128((__m128i *)(pAcc + index + 8 * half), 
+        _mm_add_epi32(_mm_loadu_si128((const __m128i *)(pAcc + index + 8 * half)),
+                      _mm_unpacklo_epi16(w, zero)));
+      _mm_storeu_si128((__m128i *)(pAcc + index + 8 * half + 4), 
+        _mm_add_epi32(_mm_loadu_si128((const __m128i *)(pAcc + index + 8 * half + 4)),
+                      _mm_unpackhi_epi16(w, zero)));
+    }
+  }
+#endif
+  
+  for (; index < n; index++) {
+    pAcc[index] += pRow[index];
+  }
+}
+
+
+template <typename pixelType, typename outType>
+static void photronBin(const pixelType *pSrc, size_t width, size_t height,
+                       int bin, int mean, epicsUInt32 maxValue, outType *pDst) {
+  epicsUInt32 acc[BIN_CHUNK];
+  size_t binWidth = width / bin, binHeight = height / bin;
+  size_t usedWidth = binWidth * bin;
+  size_t chunk = (BIN_CHUNK / bin) * bin;
+  size_t x, n, k, by;
+  epicsUInt32 sum, area = bin * bin;
+  int y, col, shift = -1;
+  
+  // Means of power-of-two bins are shifts rather than divisions
+  if ((bin & (bin - 1)) == 0) {
+    for (shift=0; (1U << shift) < area; shift++);
+  }
+  
+  for (by=0; by<binHeight; by++) {
+    for (x=0; x<usedWidth; x+=chunk) {
+      n = (usedWidth - x < chunk) ? usedWidth - x : chunk;
+      memset(acc, 0, n * sizeof(epicsUInt32));
+      for (y=0; y<bin; y++) {
+        binAddRow(acc, pSrc + (by * bin + y) * width + x, n);
+      }
+      for (k=0; k<n/bin; k++) {
+        if (bin == 2) {
+          sum = acc[2 * k] + acc[2 * k + 1];
+        } else if (bin == 4) {
+          sum = acc[4 * k] + acc[4 * k + 1] + acc[4 * k + 2] + acc[4 * k + 3];
+        } else {
+          sum = 0;
+          for (col=0; col<bin; col++) {
+            sum += acc[k * bin + col];
+          }
+        }
+        if (mean) {
+          sum = (shift >= 0) ? (sum >> shift) : (sum / area);
+        } else if (sum > maxValue) {
+          sum = maxValue;
+        }
+        *pDst++ = (outType)sum;
+      }
+    }
+  }
+}
+
+
+void photronBin16(const epicsUInt16 *pSrc, size_t width, size_t height,
+                  int bin, int mean, epicsUInt16 *pDst) {
+  photronBin(pSrc, width, height, bin, mean, 65535, pDst);
+}
+
+
+void photronBin8(const epicsUInt8 *pSrc, size_t width, size_t height,
+                 int bin, epicsUInt8 *pDst) {
+  photronBin(pSrc, width, height, bin, 1, 255, pDst);
+}
+
+
+void photronBinSum8(const epicsUInt8 *pSrc, size_t width, size_t height,
+                    int bin, epicsUInt16 *pDst) {
+  photronBin(pSrc, width, height, bin, 0, 65535, pDst);
+}
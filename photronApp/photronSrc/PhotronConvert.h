@@ -0,0 +1,74 @@
+/* PhotronConvert.h
+ *
+ * Pixel format conversions and flat/dark correction applied to frames on 
+ * the live and readout paths, live binning, and the thumbnails of the 
+ * recording index.
+ * The kernels use SSE2 when the compiler targets it and plain C otherwise.
+ *
+ */
+
+#ifndef PHOTRON_CONVERT_H
+#define PHOTRON_CONVERT_H
+
+#include <stddef.h>
+#include <epicsTypes.h>
+
+/* Bytes photronPack12 writes for numPixels pixels */
+#define PACKED12_BYTES(numPixels) (((numPixels) * 3 + 1) / 2)
+/* Gain of 1.0 in the Q4.12 gain maps of photronCorrect16 and photronCorrect8 */
+#define CORR_GAIN_ONE 4096
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Packs the low 12 bits of each pixel, two pixels in three bytes, in the 
+ * GenICam Mono12p layout: byte0 = p0[7:0], byte1 = p1[3:0] p0[11:8], 
+ * byte2 = p1[11:4]. An odd last pixel takes two bytes. */
+void photronPack12(const epicsUInt16 *pSrc, epicsUInt8 *pDst, size_t numPixels);
+
+/* Converts to 8 bits as pixel >> shift, saturated at 255 */
+void photronConvert8(const epicsUInt16 *pSrc, epicsUInt8 *pDst, 
+                     size_t numPixels, int shift);
+
+/* Applies a dark frame and gain map in place:
+ * pixel = min(((pixel - dark) * gain) >> 12, maxValue). pixel - dark is
+ * floored at 0 and limited to 4095, so gains up to 16 don't overflow. */
+void photronCorrect16(epicsUInt16 *pData, const epicsUInt16 *pDark, 
+                      const epicsUInt16 *pGain, size_t numPixels, 
+                      epicsUInt16 maxValue);
+
+/* As photronCorrect16 for 8-bit pixels, clipped at 255 */
+void photronCorrect8(epicsUInt8 *pData, const epicsUInt16 *pDark, 
+                     const epicsUInt16 *pGain, size_t numPixels);
+
+/* Bins a width x height frame into a (width / bin) x (height / bin) 
+ * thumbnail of block means. Edge pixels that don't fill a block are left 
+ * out of the thumbnail. Returns the mean of all pixels of the frame. */
+double photronThumb16(const epicsUInt16 *pSrc, size_t width, size_t height,
+                      int bin, epicsUInt16 *pThumb);
+
+/* As photronThumb16 for 8-bit pixels */
+double photronThumb8(const epicsUInt8 *pSrc, size_t width, size_t height,
+                     int bin, epicsUInt16 *pThumb);
+
+/* Bins a width x height frame by bin x bin, for bin 1 to 8, into 
+ * (width / bin) x (height / bin) pixels. Edge pixels that don't fill a block
+ * are left out. With mean each output pixel is the block mean, otherwise the
+ * block sum saturated at 65535. */
+void photronBin16(const epicsUInt16 *pSrc, size_t width, size_t height,
+                  int bin, int mean, epicsUInt16 *pDst);
+
+/* As photronBin16 for 8-bit pixels, writing block means */
+void photronBin8(const epicsUInt8 *pSrc, size_t width, size_t height,
+                 int bin, epicsUInt8 *pDst);
+
+/* As photronBin16 for 8-bit pixels, writing block sums */
+void photronBinSum8(const epicsUInt8 *pSrc, size_t width, size_t height,
+                    int bin, epicsUInt16 *pDst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PHOTRON_CONVERT_H */
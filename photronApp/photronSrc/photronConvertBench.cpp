@@ -0,0 +1,199 @@
+/* photronConvertBench.cpp
+ *
+ * Microbenchmark of the readout format kernels of PhotronConvert.cpp. Each
+ * kernel is checked against a plain C reference, which is also timed, on
+ * 1 Mpixel frames of 12-bit pixels. readMemFrame converts one ROI row per
+ * call, so the kernels are timed on whole frames and row by row. Rates are
+ * input GB/s (2 bytes per pixel), the best of BENCH_RUNS runs on one core.
+ *
+ * Usage: photronConvertBench
+ *
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <epicsTypes.h>
+#include <epicsTime.h>
+
+#include "PhotronConvert.h"
+
+#define BENCH_RUNS      5
+#define BENCH_WIDTH     1024
+#define BENCH_HEIGHT    1024
+/* Frames converted per run */
+#define BENCH_FRAMES    20
+/* The window photronConvert8 is timed with: bits 11..4 of the pixel */
+#define BENCH_SHIFT     4
+
+/* How a frame is handed to a kernel */
+typedef struct {
+  const char *name;
+  size_t rowPixels;     /* Pixels per call */
+  size_t numRows;       /* Calls per frame */
+} benchLayout;
+
+typedef void (*benchKernel)(const epicsUInt16 *pSrc, epicsUInt8 *pDst,
+                            size_t numPixels);
+
+
+/* Reference Mono12p packing, two pixels in three bytes */
+static void refPack12(const epicsUInt16 *pSrc, epicsUInt8 *pDst,
+                      size_t numPixels) {
+  size_t index;
+  unsigned int p0, p1;
+
+  for (index=0; index+2<=numPixels; index+=2) {
+    p0 = pSrc[index] & 0x0FFF;
+    p1 = pSrc[index + 1] & 0x0FFF;
+    pDst[0] = (epicsUInt8)p0;
+    pDst[1] = (epicsUInt8)((p0 >> 8) | (p1 << 4));
+    pDst[2] = (epicsUInt8)(p1 >> 4);
+    pDst += 3;
+  }
+  if (index < numPixels) {
+    p0 = pSrc[index] & 0x0FFF;
+    pDst[0] = (epicsUInt8)p0;
+    pDst[1] = (epicsUInt8)(p0 >> 8);
+  }
+}
+
+
+/* Reference 8-bit window */
+static void refConvert8(const epicsUInt16 *pSrc, epicsUInt8 *pDst,
+                        size_t numPixels) {
+  size_t index;
+  unsigned int value;
+
+  for (index=0; index<numPixels; index++) {
+    value = pSrc[index] >> BENCH_SHIFT;
+    pDst[index] = (epicsUInt8)((value > 255) ? 255 : value);
+  }
+}
+
+
+static void pack12(const epicsUInt16 *pSrc, epicsUInt8 *pDst, size_t numPixels) {
+  photronPack12(pSrc, pDst, numPixels);
+}
+
+
+static void convert8(const epicsUInt16 *pSrc, epicsUInt8 *pDst,
+                     size_t numPixels) {
+  photronConvert8(pSrc, pDst, numPixels, BENCH_SHIFT);
+}
+
+
+/* Bytes a kernel writes for one row */
+static size_t benchRowBytes(benchKernel kernel, size_t rowPixels) {
+  if ((kernel == pack12) || (kernel == refPack12)) {
+    return PACKED12_BYTES(rowPixels);
+  }
+  return rowPixels;
+}
+
+
+/* Converts every row of the frame, like readMemFrame */
+static void benchFrame(benchKernel kernel, const benchLayout *pLayout,
+                       const epicsUInt16 *pSrc, epicsUInt8 *pDst) {
+  size_t rowBytes = benchRowBytes(kernel, pLayout->rowPixels);
+  size_t row;
+
+  for (row=0; row<pLayout->numRows; row++) {
+    kernel(pSrc + row * pLayout->rowPixels, pDst + row * rowBytes,
+           pLayout->rowPixels);
+  }
+}
+
+
+/* Input GB/s of the kernel, best of BENCH_RUNS runs */
+static double benchRate(benchKernel kernel, const benchLayout *pLayout,
+                        const epicsUInt16 *pSrc, epicsUInt8 *pDst) {
+  epicsTimeStamp start, end;
+  double elapsed, rate, best = 0.0;
+  int run, frame;
+
+  for (run=0; run<BENCH_RUNS; run++) {
+    epicsTimeGetCurrent(&start);
+    for (frame=0; frame<BENCH_FRAMES; frame++) {
+      benchFrame(kernel, pLayout, pSrc, pDst);
+    }
+    epicsTimeGetCurrent(&end);
+    elapsed = epicsTimeDiffInSeconds(&end, &start);
+    if (elapsed <= 0.0) continue;
+    rate = (double)BENCH_FRAMES * pLayout->rowPixels * pLayout->numRows * 2 /
+           elapsed / 1.0e9;
+    if (rate > best) best = rate;
+  }
+  return best;
+}
+
+
+/* Returns 0 if the kernel writes what the reference does */
+static int benchCheck(benchKernel kernel, benchKernel reference,
+                      const benchLayout *pLayout, const epicsUInt16 *pSrc,
+                      epicsUInt8 *pDst, epicsUInt8 *pRef, size_t dstSize) {
+  size_t used = benchRowBytes(kernel, pLayout->rowPixels) * pLayout->numRows;
+
+  memset(pDst, 0, dstSize);
+  memset(pRef, 0, dstSize);
+  benchFrame(kernel, pLayout, pSrc, pDst);
+  benchFrame(reference, pLayout, pSrc, pRef);
+  return memcmp(pDst, pRef, used) ? -1 : 0;
+}
+
+
+int main(int argc, char *argv[]) {
+  static const benchLayout layouts[] = {
+    {"frame",           BENCH_WIDTH * BENCH_HEIGHT, 1},
+    {"rows of 1024",    BENCH_WIDTH,                BENCH_HEIGHT},
+    {"rows of 1023",    BENCH_WIDTH - 1,            BENCH_HEIGHT}
+  };
+  static const struct {
+    const char *name;
+    benchKernel kernel;
+    benchKernel reference;
+  } kernels[] = {{"pack12", pack12, refPack12}, {"8-bit", convert8, refConvert8}};
+  size_t numPixels = BENCH_WIDTH * BENCH_HEIGHT;
+  size_t dstSize = numPixels * 2;
+  epicsUInt16 *pSrc;
+  epicsUInt8 *pDst, *pRef;
+  epicsUInt32 seed = 12345;
+  size_t index, k, l;
+  int failed = 0;
+
+  pSrc = (epicsUInt16 *)malloc(numPixels * sizeof(epicsUInt16));
+  pDst = (epicsUInt8 *)malloc(dstSize);
+  pRef = (epicsUInt8 *)malloc(dstSize);
+  /* 12-bit pixels; every 64th pixel has stray high bits to check masking */
+  for (index=0; index<numPixels; index++) {
+    seed = seed * 1103515245 + 12345;
+    pSrc[index] = (epicsUInt16)((seed >> 16) &
+                                ((index % 64) ? 0x0FFF : 0xFFFF));
+  }
+
+  printf("Readout format kernels, %dx%d 12-bit frames, input GB/s\n",
+         BENCH_WIDTH, BENCH_HEIGHT);
+  printf("  kernel  calls          PhotronConvert  plain C\n");
+  for (k=0; k<sizeof(kernels)/sizeof(kernels[0]); k++) {
+    for (l=0; l<sizeof(layouts)/sizeof(layouts[0]); l++) {
+      if (benchCheck(kernels[k].kernel, kernels[k].reference, &layouts[l],
+                     pSrc, pDst, pRef, dstSize)) {
+        printf("  %-6s  %-13s  output differs from the reference\n",
+               kernels[k].name, layouts[l].name);
+        failed = 1;
+        continue;
+      }
+      printf("  %-6s  %-13s  %6.1f          %6.1f\n", kernels[k].name,
+             layouts[l].name,
+             benchRate(kernels[k].kernel, &layouts[l], pSrc, pDst),
+             benchRate(kernels[k].reference, &layouts[l], pSrc, pDst));
+    }
+  }
+
+  free(pSrc);
+  free(pDst);
+  free(pRef);
+  return failed;
+}
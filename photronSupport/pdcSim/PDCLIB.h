@@ -0,0 +1,430 @@
+/* PDCLIB.h
+ *
+ * Simulated Photron FASTCAM SDK (PDCLIB) for building, running and
+ * benchmarking the Photron driver on hosts without a camera or the vendor SDK.
+ *
+ * Only the subset of the SDK used by the driver is provided. Function
+ * signatures follow PDCFUNC.h; the values of the constants follow the layout
+ * the driver relies on (status bitmask, trigger mode in the upper byte, etc.).
+ *
+ * The simulated camera is configured with PDCSim_Configure() before PDC_Init()
+ * is called (PhotronSimConfig from iocsh).
+ *
+ */
+
+#ifndef PDCLIB_SIM_H
+#define PDCLIB_SIM_H
+
+#include <stdio.h>
+
+/* Marks the driver as being built against the simulated SDK */
+#define PDC_SIMULATION 1
+
+#ifndef _TCHAR_DEFINED
+typedef char TCHAR;
+#define _TCHAR_DEFINED
+#endif
+
+/* Return values */
+#define PDC_SUCCEEDED                   1
+#define PDC_FAILED                      0
+
+/* Error codes */
+#define PDC_ERROR_NOERROR               1
+#define PDC_ERROR_UNINITIALIZE          2
+#define PDC_ERROR_ILLEGAL_DEV_NO        3
+#define PDC_ERROR_ILLEGAL_CHILD_NO      4
+#define PDC_ERROR_ILLEGAL_VALUE         5
+#define PDC_ERROR_ALLOCATE_FAILED       6
+#define PDC_ERROR_INITIALIZED           7
+#define PDC_ERROR_NO_DEVICE             8
+#define PDC_ERROR_TIMEOUT               9
+#define PDC_ERROR_FUNCTION_FAILED       10
+#define PDC_ERROR_NOT_SUPPORTED         11
+#define PDC_ERROR_DATA_UNSTABLE         12
+#define PDC_ERROR_SEQUENCE              13
+
+/* Sizes */
+#define PDC_MAX_DEVICE                  64
+#define PDC_MAX_LIST_NUMBER             256
+#define PDC_MAX_STRING_LENGTH           256
+#define PDC_EXTIO_MAX_PORT              4
+#define PDC_VARIABLE_NUM                20
+#define PDC_MAX_EVENT                   10
+
+/* Interfaces and detection */
+#define PDC_INTTYPE_G_ETHER             2
+#define PDC_DETECT_NORMAL               0
+#define PDC_DETECT_AUTO                 1
+
+/* Function existence (PDC_IsFunction) */
+#define PDC_EXIST_NOTSUPPORTED          0
+#define PDC_EXIST_SUPPORTED             1
+#define PDC_EXIST_SHADING               7
+#define PDC_EXIST_IRIG                  15
+#define PDC_EXIST_HIGH_SPEED_MODE       31
+#define PDC_EXIST_BURST_TRANSFER        32
+#define PDC_EXIST_BITDEPTH              35
+#define PDC_EXIST_SYNC_PRIORITY         39
+
+/* Generic on/off */
+#define PDC_FUNCTION_OFF                0
+#define PDC_FUNCTION_ON                 1
+
+/* Camera status (bitmask) */
+#define PDC_STATUS_LIVE                 0x00
+#define PDC_STATUS_PLAYBACK             0x01
+#define PDC_STATUS_RECREADY             0x02
+#define PDC_STATUS_ENDLESS              0x04
+#define PDC_STATUS_REC                  0x08
+#define PDC_STATUS_SAVE                 0x10
+#define PDC_STATUS_LOAD                 0x20
+#define PDC_STATUS_PAUSE                0x40
+
+/* Trigger modes */
+#define PDC_TRIGGER_START               0x00000000
+#define PDC_TRIGGER_CENTER              0x01000000
+#define PDC_TRIGGER_END                 0x02000000
+#define PDC_TRIGGER_RANDOM              0x03000000
+#define PDC_TRIGGER_MANUAL              0x04000000
+#define PDC_TRIGGER_RANDOM_RESET        0x05000000
+#define PDC_TRIGGER_RANDOM_CENTER       0x06000000
+#define PDC_TRIGGER_RANDOM_MANUAL       0x07000000
+#define PDC_TRIGGER_TWOSTAGE            0x08000000
+#define PDC_TRIGGER_TWOSTAGE_HALF       0x08000001
+#define PDC_TRIGGER_TWOSTAGE_QUARTER    0x08000002
+#define PDC_TRIGGER_TWOSTAGE_ONEEIGHTH  0x08000003
+
+/* Shading modes */
+#define PDC_SHADING_OFF                 1
+#define PDC_SHADING_ON                  2
+#define PDC_SHADING_SAVE                3
+#define PDC_SHADING_LOAD                4
+#define PDC_SHADING_UPDATE              5
+#define PDC_SHADING_SAVE_FILE           6
+#define PDC_SHADING_LOAD_FILE           7
+
+/* External inputs */
+#define PDC_EXT_IN_NONE                 0x01
+#define PDC_EXT_IN_CAMSYNC_POSI         0x02
+#define PDC_EXT_IN_CAMSYNC_NEGA         0x03
+#define PDC_EXT_IN_OTHERSSYNC_POSI      0x04
+#define PDC_EXT_IN_OTHERSSYNC_NEGA      0x05
+#define PDC_EXT_IN_EVENT_POSI           0x06
+#define PDC_EXT_IN_EVENT_NEGA           0x07
+#define PDC_EXT_IN_TRIGGER_POSI         0x08
+#define PDC_EXT_IN_TRIGGER_NEGA         0x09
+#define PDC_EXT_IN_ENCODER_POSI         0x30
+#define PDC_EXT_IN_ENCODER_NEGA         0x31
+
+/* External outputs */
+#define PDC_EXT_OUT_SYNC_POSI           0x01
+#define PDC_EXT_OUT_SYNC_NEGA           0x02
+#define PDC_EXT_OUT_RECORD_POSI         0x03
+#define PDC_EXT_OUT_RECORD_NEGA         0x04
+#define PDC_EXT_OUT_TRIGGER_POSI        0x05
+#define PDC_EXT_OUT_TRIGGER_NEGA        0x06
+#define PDC_EXT_OUT_READY_POSI          0x07
+#define PDC_EXT_OUT_READY_NEGA          0x08
+#define PDC_EXT_OUT_EXPOSE_H1_POSI      0x1D
+#define PDC_EXT_OUT_EXPOSE_H1_NEGA      0x1E
+#define PDC_EXT_OUT_EXPOSE_H2_POSI      0x2D
+#define PDC_EXT_OUT_EXPOSE_H2_NEGA      0x2E
+#define PDC_EXT_OUT_EXPOSE_H3_POSI      0x3D
+#define PDC_EXT_OUT_EXPOSE_H3_NEGA      0x3E
+#define PDC_EXT_OUT_EXPOSE_H4_POSI      0x4D
+#define PDC_EXT_OUT_EXPOSE_H4_NEGA      0x4E
+
+/* Variable mode position restrictions */
+#define PDC_VARIABLE_FREE_X             0x01
+#define PDC_VARIABLE_FREE_Y             0x02
+
+typedef struct {
+  unsigned long m_nDeviceCode;
+  unsigned long m_nTmpDeviceNo;
+  unsigned long m_nInterfaceCode;
+} PDC_DETECT_INFO, *PPDC_DETECT_INFO;
+
+typedef struct {
+  unsigned long m_nDeviceNum;
+  PDC_DETECT_INFO m_DetectInfo[PDC_MAX_DEVICE];
+} PDC_DETECT_NUM_INFO, *PPDC_DETECT_NUM_INFO;
+
+typedef struct {
+  long m_nStart;
+  long m_nTrigger;
+  long m_nEnd;
+  long m_nTwoStageLowToHigh;
+  long m_nTwoStageHighToLow;
+  long m_nTwoStageTiming;
+  long m_nEvent[PDC_MAX_EVENT];
+  long m_nEventCount;
+  long m_nRecordedFrames;
+} PDC_FRAME_INFO, *PPDC_FRAME_INFO;
+
+typedef struct {
+  unsigned long m_nDayOfYear;
+  unsigned long m_nHour;
+  unsigned long m_nMinute;
+  unsigned long m_nSecond;
+  unsigned long m_nMicroSecond;
+  unsigned char m_ExistSignal;
+  unsigned char m_nReserve[3];
+} PDC_IRIG_INFO, *PPDC_IRIG_INFO;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Simulator configuration; must be called before PDC_Init
+ *   width, height   sensor size in pixels
+ *   bits            sensor bit depth (8-16)
+ *   latencyUsec     fixed cost of every SDK call, in microseconds
+ *   bandwidthMBps   link bandwidth for image transfers, in MB/s (0 = unlimited)
+ *   memFrames       number of frames recorded into camera memory per trigger
+ */
+void PDCSim_Configure(unsigned long width, unsigned long height,
+                      unsigned long bits, double latencyUsec,
+                      double bandwidthMBps, unsigned long memFrames);
+/* Makes linkIpAddr a second interface of the camera at ipAddr. Opening it
+ * after the camera gives a handle with its own link to the same memory. */
+void PDCSim_AddLink(unsigned long ipAddr, unsigned long linkIpAddr);
+/* Marks an event every interval frames of each recording, up to 
+ * PDC_MAX_EVENT events (0 = no events) */
+void PDCSim_SetEventInterval(unsigned long interval);
+/* Gives every simulated camera count heads (children 1..count). They share
+ * the camera's settings, recording and link. */
+void PDCSim_SetChildCount(unsigned long count);
+void PDCSim_Report(FILE *fp);
+
+/* Library */
+unsigned long PDC_Init(unsigned long *pErrorCode);
+unsigned long PDC_DetectDevice(unsigned long nInterfaceCode,
+                               unsigned long *pDetectNo,
+                               unsigned long nDetectNum,
+                               unsigned long nDetectParam,
+                               PPDC_DETECT_NUM_INFO pDetectNumInfo,
+                               unsigned long *pErrorCode);
+unsigned long PDC_OpenDevice(PPDC_DETECT_INFO pDetectInfo,
+                             unsigned long *pDeviceNo,
+                             unsigned long *pErrorCode);
+unsigned long PDC_OpenDevice2(PPDC_DETECT_INFO pDetectInfo,
+                              unsigned long nMaxRetryCount,
+                              unsigned long nConnectMode,
+                              unsigned long *pDeviceNo,
+                              unsigned long *pErrorCode);
+unsigned long PDC_CloseDevice(unsigned long nDeviceNo, unsigned long *pErrorCode);
+
+/* Device information */
+unsigned long PDC_IsFunction(unsigned long nDeviceNo, unsigned long nChildNo,
+                             unsigned long nFunction, char *pFlag,
+                             unsigned long *pErrorCode);
+unsigned long PDC_GetDeviceCode(unsigned long nDeviceNo, unsigned long *pCode,
+                                unsigned long *pErrorCode);
+unsigned long PDC_GetDeviceName(unsigned long nDeviceNo, unsigned long nIndex,
+                                TCHAR *pStr, unsigned long *pErrorCode);
+unsigned long PDC_GetDeviceID(unsigned long nDeviceNo, unsigned long *pID,
+                              unsigned long *pErrorCode);
+unsigned long PDC_GetLotID(unsigned long nDeviceNo, unsigned long nIndex,
+                           unsigned long *pID, unsigned long *pErrorCode);
+unsigned long PDC_GetProductID(unsigned long nDeviceNo, unsigned long nIndex,
+                               unsigned long *pID, unsigned long *pErrorCode);
+unsigned long PDC_GetIndividualID(unsigned long nDeviceNo, unsigned long nIndex,
+                                  unsigned long *pID, unsigned long *pErrorCode);
+unsigned long PDC_GetVersion(unsigned long nDeviceNo, unsigned long nIndex,
+                             unsigned long *pVersion, unsigned long *pErrorCode);
+unsigned long PDC_GetMaxChildDeviceCount(unsigned long nDeviceNo,
+                                         unsigned long *pCount,
+                                         unsigned long *pErrorCode);
+unsigned long PDC_GetChildDeviceCount(unsigned long nDeviceNo,
+                                      unsigned long *pCount,
+                                      unsigned long *pErrorCode);
+unsigned long PDC_GetMaxResolution(unsigned long nDeviceNo, unsigned long nChildNo,
+                                   unsigned long *pWidth, unsigned long *pHeight,
+                                   unsigned long *pErrorCode);
+unsigned long PDC_GetMaxBitDepth(unsigned long nDeviceNo, unsigned long nChildNo,
+                                 char *pDepth, unsigned long *pErrorCode);
+unsigned long PDC_GetExternalCount(unsigned long nDeviceNo, unsigned long *pInCount,
+                                   unsigned long *pOutCount,
+                                   unsigned long *pErrorCode);
+
+/* Status */
+unsigned long PDC_GetStatus(unsigned long nDeviceNo, unsigned long *pStatus,
+                            unsigned long *pErrorCode);
+unsigned long PDC_SetStatus(unsigned long nDeviceNo, unsigned long nStatus,
+                            unsigned long *pErrorCode);
+unsigned long PDC_SetRecReady(unsigned long nDeviceNo, unsigned long *pErrorCode);
+unsigned long PDC_SetEndless(unsigned long nDeviceNo, unsigned long *pErrorCode);
+unsigned long PDC_TriggerIn(unsigned long nDeviceNo, unsigned long *pErrorCode);
+
+/* Recording settings */
+unsigned long PDC_GetCamMode(unsigned long nDeviceNo, unsigned long nChildNo,
+                             unsigned long *pMode, unsigned long *pErrorCode);
+unsigned long PDC_GetRecordRate(unsigned long nDeviceNo, unsigned long nChildNo,
+                                unsigned long *pRate, unsigned long *pErrorCode);
+unsigned long PDC_SetRecordRate(unsigned long nDeviceNo, unsigned long nChildNo,
+                                unsigned long nRate, unsigned long *pErrorCode);
+unsigned long PDC_GetRecordRateList(unsigned long nDeviceNo, unsigned long nChildNo,
+                                    unsigned long *pSize, unsigned long *pList,
+                                    unsigned long *pErrorCode);
+unsigned long PDC_GetMaxFrames(unsigned long nDeviceNo, unsigned long nChildNo,
+                               unsigned long *pFrames, unsigned long *pBlocks,
+                               unsigned long *pErrorCode);
+unsigned long PDC_GetResolution(unsigned long nDeviceNo, unsigned long nChildNo,
+                                unsigned long *pWidth, unsigned long *pHeight,
+                                unsigned long *pErrorCode);
+unsigned long PDC_SetResolution(unsigned long nDeviceNo, unsigned long nChildNo,
+                                unsigned long nWidth, unsigned long nHeight,
+                                unsigned long *pErrorCode);
+unsigned long PDC_GetResolutionList(unsigned long nDeviceNo, unsigned long nChildNo,
+                                    unsigned long *pSize, unsigned long *pList,
+                                    unsigned long *pErrorCode);
+unsigned long PDC_GetSegmentPosition(unsigned long nDeviceNo, unsigned long nChildNo,
+                                     unsigned long *pXPos, unsigned long *pYPos,
+                                     unsigned long *pErrorCode);
+unsigned long PDC_GetShutterSpeedFps(unsigned long nDeviceNo, unsigned long nChildNo,
+                                     unsigned long *pFps, unsigned long *pErrorCode);
+unsigned long PDC_SetShutterSpeedFps(unsigned long nDeviceNo, unsigned long nChildNo,
+                                     unsigned long nFps, unsigned long *pErrorCode);
+unsigned long PDC_GetShutterSpeedFpsList(unsigned long nDeviceNo,
+                                         unsigned long nChildNo,
+                                         unsigned long *pSize, unsigned long *pList,
+                                         unsigned long *pErrorCode);
+unsigned long PDC_GetTriggerMode(unsigned long nDeviceNo, unsigned long *pMode,
+                                 unsigned long *pAFrames, unsigned long *pRFrames,
+                                 unsigned long *pRCount, unsigned long *pErrorCode);
+unsigned long PDC_SetTriggerMode(unsigned long nDeviceNo, unsigned long nMode,
+                                 unsigned long nAFrames, unsigned long nRFrames,
+                                 unsigned long nRCount, unsigned long *pErrorCode);
+unsigned long PDC_GetTriggerModeList(unsigned long nDeviceNo, unsigned long *pSize,
+                                     unsigned long *pList,
+                                     unsigned long *pErrorCode);
+unsigned long PDC_GetShadingMode(unsigned long nDeviceNo, unsigned long nChildNo,
+                                 unsigned long *pMode, unsigned long *pErrorCode);
+unsigned long PDC_SetShadingMode(unsigned long nDeviceNo, unsigned long nChildNo,
+                                 unsigned long nMode, unsigned long *pErrorCode);
+unsigned long PDC_GetShadingModeList(unsigned long nDeviceNo, unsigned long nChildNo,
+                                     unsigned long *pSize, unsigned long *pList,
+                                     unsigned long *pErrorCode);
+unsigned long PDC_GetBitDepth(unsigned long nDeviceNo, unsigned long nChildNo,
+                              char *pDepth, unsigned long *pErrorCode);
+unsigned long PDC_SetTransferOption(unsigned long nDeviceNo, unsigned long nChildNo,
+                                    unsigned long n8BitSel, unsigned long nBayer,
+                                    unsigned long nInterleave,
+                                    unsigned long *pErrorCode);
+unsigned long PDC_GetIRIG(unsigned long nDeviceNo, unsigned long *pMode,
+                          unsigned long *pErrorCode);
+unsigned long PDC_SetIRIG(unsigned long nDeviceNo, unsigned long nMode,
+                          unsigned long *pErrorCode);
+unsigned long PDC_GetSyncPriority(unsigned long nDeviceNo, unsigned long *pMode,
+                                  unsigned long *pErrorCode);
+unsigned long PDC_SetSyncPriority(unsigned long nDeviceNo, unsigned long nMode,
+                                  unsigned long *pErrorCode);
+unsigned long PDC_GetSyncPriorityList(unsigned long nDeviceNo, unsigned long *pSize,
+                                      unsigned long *pList,
+                                      unsigned long *pErrorCode);
+unsigned long PDC_GetHighSpeedMode(unsigned long nDeviceNo, unsigned long *pMode,
+                                   unsigned long *pErrorCode);
+unsigned long PDC_GetBurstTransfer(unsigned long nDeviceNo, unsigned long *pMode,
+                                   unsigned long *pErrorCode);
+unsigned long PDC_SetBurstTransfer(unsigned long nDeviceNo, unsigned long nMode,
+                                   unsigned long *pErrorCode);
+
+/* External I/O */
+unsigned long PDC_GetExternalInMode(unsigned long nDeviceNo, unsigned long nPort,
+                                    unsigned long *pMode, unsigned long *pErrorCode);
+unsigned long PDC_SetExternalInMode(unsigned long nDeviceNo, unsigned long nPort,
+                                    unsigned long nMode, unsigned long *pErrorCode);
+unsigned long PDC_GetExternalInModeList(unsigned long nDeviceNo, unsigned long nPort,
+                                        unsigned long *pSize, unsigned long *pList,
+                                        unsigned long *pErrorCode);
+unsigned long PDC_GetExternalOutMode(unsigned long nDeviceNo, unsigned long nPort,
+                                     unsigned long *pMode, unsigned long *pErrorCode);
+unsigned long PDC_SetExternalOutMode(unsigned long nDeviceNo, unsigned long nPort,
+                                     unsigned long nMode, unsigned long *pErrorCode);
+unsigned long PDC_GetExternalOutModeList(unsigned long nDeviceNo, unsigned long nPort,
+                                         unsigned long *pSize, unsigned long *pList,
+                                         unsigned long *pErrorCode);
+
+/* Variable mode */
+unsigned long PDC_GetVariableRestriction(unsigned long nDeviceNo,
+                                         unsigned long *pWStep, unsigned long *pHStep,
+                                         unsigned long *pXPosStep,
+                                         unsigned long *pYPosStep,
+                                         unsigned long *pWMin, unsigned long *pHMin,
+                                         unsigned long *pFreePos,
+                                         unsigned long *pErrorCode);
+unsigned long PDC_GetVariableChannel(unsigned long nDeviceNo, unsigned long nChildNo,
+                                     unsigned long *pChannel,
+                                     unsigned long *pErrorCode);
+unsigned long PDC_SetVariableChannel(unsigned long nDeviceNo, unsigned long nChildNo,
+                                     unsigned long nChannel,
+                                     unsigned long *pErrorCode);
+unsigned long PDC_GetVariableChannelInfo(unsigned long nDeviceNo,
+                                         unsigned long nChannel,
+                                         unsigned long *pRate, unsigned long *pWidth,
+                                         unsigned long *pHeight,
+                                         unsigned long *pXPos, unsigned long *pYPos,
+                                         unsigned long *pErrorCode);
+unsigned long PDC_SetVariableChannelInfo(unsigned long nDeviceNo,
+                                         unsigned long nChannel,
+                                         unsigned long nRate, unsigned long nWidth,
+                                         unsigned long nHeight,
+                                         unsigned long nXPos, unsigned long nYPos,
+                                         unsigned long *pErrorCode);
+unsigned long PDC_EraseVariableChannel(unsigned long nDeviceNo,
+                                       unsigned long nChannel,
+                                       unsigned long *pErrorCode);
+unsigned long PDC_GetVariableRecordRateList(unsigned long nDeviceNo,
+                                            unsigned long nChildNo,
+                                            unsigned long *pSize,
+                                            unsigned long *pList,
+                                            unsigned long *pErrorCode);
+unsigned long PDC_GetVariableMaxResolution(unsigned long nDeviceNo,
+                                           unsigned long nRate,
+                                           unsigned long *pWidth,
+                                           unsigned long *pHeight,
+                                           unsigned long *pErrorCode);
+unsigned long PDC_GetVariableMaxWidth(unsigned long nDeviceNo, unsigned long nRate,
+                                      unsigned long nHeight, unsigned long *pWidth,
+                                      unsigned long *pErrorCode);
+unsigned long PDC_GetVariableMaxHeight(unsigned long nDeviceNo, unsigned long nRate,
+                                       unsigned long nWidth, unsigned long *pHeight,
+                                       unsigned long *pErrorCode);
+
+/* Image transfer */
+unsigned long PDC_GetLiveImageData(unsigned long nDeviceNo, unsigned long nChildNo,
+                                   unsigned long nBitDepth, void *pData,
+                                   unsigned long *pErrorCode);
+unsigned long PDC_GetMemFrameInfo(unsigned long nDeviceNo, unsigned long nChildNo,
+                                  PPDC_FRAME_INFO pFrame, unsigned long *pErrorCode);
+unsigned long PDC_GetMemResolution(unsigned long nDeviceNo, unsigned long nChildNo,
+                                   unsigned long *pWidth, unsigned long *pHeight,
+                                   unsigned long *pErrorCode);
+unsigned long PDC_GetMemRecordRate(unsigned long nDeviceNo, unsigned long nChildNo,
+                                   unsigned long *pRate, unsigned long *pErrorCode);
+unsigned long PDC_GetMemTriggerMode(unsigned long nDeviceNo, unsigned long nChildNo,
+                                    unsigned long *pMode, unsigned long *pAFrames,
+                                    unsigned long *pRFrames, unsigned long *pRCount,
+                                    unsigned long *pErrorCode);
+unsigned long PDC_GetMemIRIG(unsigned long nDeviceNo, unsigned long nChildNo,
+                             unsigned long *pMode, unsigned long *pErrorCode);
+unsigned long PDC_GetMemIRIGData(unsigned long nDeviceNo, unsigned long nChildNo,
+                                 long nFrameNo, PPDC_IRIG_INFO pData,
+                                 unsigned long *pErrorCode);
+unsigned long PDC_GetMemImageData(unsigned long nDeviceNo, unsigned long nChildNo,
+                                  long nFrameNo, unsigned long nBitDepth,
+                                  void *pData, unsigned long *pErrorCode);
+unsigned long PDC_GetMemImageDataStart(unsigned long nDeviceNo,
+                                       unsigned long nChildNo, long nFrameNo,
+                                       unsigned long nBitDepth, void *pData,
+                                       unsigned long *pErrorCode);
+unsigned long PDC_GetMemImageDataEnd(unsigned long nDeviceNo, unsigned long nChildNo,
+                                     unsigned long nBitDepth, void *pData,
+                                     unsigned long *pErrorCode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PDCLIB_SIM_H */
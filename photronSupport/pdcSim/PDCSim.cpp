@@ -0,0 +1,1573 @@
+/* PDCSim.cpp
+ *
+ * Simulated Photron FASTCAM SDK (PDCLIB).
+ *
+ * Emulates a Gigabit-ethernet Photron camera well enough to exercise every
+ * code path of the Photron areaDetector driver without hardware:
+ *   - a recording state machine (live -> rec ready/endless -> rec -> live)
+ *   - a camera memory of memFrames synthetic frames with per-frame IRIG time
+ *   - live and memory image transfers whose cost is a fixed per-call latency
+ *     plus bytes/bandwidth, serialized on one link per device
+ *   - the asynchronous PDC_GetMemImageDataStart/End transfer pair
+ *   - optional second interfaces (PDCSim_AddLink): opening the second address
+ *     gives another handle to the same camera with its own link
+ *   - optional event markers in the memory frame info (PDCSim_SetEventInterval)
+ *   - optional extra heads (PDCSim_SetChildCount): the children of a device
+ *     share its settings, recording and link, and like the real camera a
+ *     device has only one Start/End transfer outstanding for all of them
+ *
+ * Image contents are a deterministic function of the frame number and head
+ * so that transfers can be verified:
+ *   pixel(x,y,frame,child) = (x + y + frame + SIM_CHILD_OFFSET*(child-1)) & mask
+ *
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <epicsTime.h>
+#include <epicsThread.h>
+#include <epicsMutex.h>
+
+#include "PDCLIB.h"
+
+/* Device code reported by the simulated camera (SA-Z) */
+#define SIM_DEVICE_CODE         0x0009
+#define SIM_DEVICE_NAME         "FASTCAM SIM"
+#define SIM_EXT_IN_PORTS        3
+#define SIM_EXT_OUT_PORTS       4
+#define SIM_SAVE_LOAD_TIME      1.0
+/* Pixel offset between the images of consecutive heads */
+#define SIM_CHILD_OFFSET        256
+
+typedef struct {
+  int open;
+  unsigned long ipAddr;
+  epicsMutexId lock;
+  int link;         /* Handle for the second interface of device primary */
+  int primary;
+  /* Settings */
+  unsigned long status;
+  unsigned long recordRate;
+  unsigned long shutterFps;
+  unsigned long width;
+  unsigned long height;
+  unsigned long triggerMode;
+  unsigned long aFrames;
+  unsigned long rFrames;
+  unsigned long rCount;
+  unsigned long shadingMode;
+  unsigned long irig;
+  unsigned long syncPriority;
+  unsigned long burstTransfer;
+  unsigned long bitSel;
+  unsigned long varChannel;
+  unsigned long varRate[PDC_VARIABLE_NUM + 1];
+  unsigned long varWidth[PDC_VARIABLE_NUM + 1];
+  unsigned long varHeight[PDC_VARIABLE_NUM + 1];
+  unsigned long varXPos[PDC_VARIABLE_NUM + 1];
+  unsigned long varYPos[PDC_VARIABLE_NUM + 1];
+  unsigned long extInMode[PDC_EXTIO_MAX_PORT];
+  unsigned long extOutMode[PDC_EXTIO_MAX_PORT];
+  /* Recording */
+  epicsTimeStamp liveStart;
+  epicsTimeStamp recEnd;
+  epicsTimeStamp busyEnd;
+  epicsTimeStamp irigStart;
+  int memValid;
+  PDC_FRAME_INFO frameInfo;
+  unsigned long memRate;
+  unsigned long memWidth;
+  unsigned long memHeight;
+  unsigned long memTriggerMode;
+  unsigned long memIRIG;
+  /* Transfers */
+  epicsTimeStamp linkFree;
+  int pending;
+  unsigned long pendingChild;
+  long pendingFrame;
+  unsigned long pendingBits;
+  void *pendingData;
+  epicsTimeStamp pendingDone;
+  /* Statistics */
+  unsigned long calls;
+  unsigned long transfers;
+  double bytes;
+} simDevice;
+
+static int simInitialized = 0;
+static unsigned long simWidth = 1024;
+static unsigned long simHeight = 1024;
+static unsigned long simBits = 12;
+static double simLatency = 100.0e-6;
+static double simBandwidth = 100.0e6;
+static unsigned long simMemFrames = 1000;
+static simDevice simDevices[PDC_MAX_DEVICE];
+static unsigned long simLinkAddr[PDC_MAX_DEVICE][2];
+static int simNumLinks = 0;
+static unsigned long simEventInterval = 0;
+static unsigned long simChildren = 1;
+
+static const unsigned long simRateList[] = {
+  50, 60, 125, 250, 500, 1000, 2000, 3000, 4000, 5000, 6000, 8000, 10000,
+  20000
+};
+static const unsigned long simTriggerModeList[] = {
+  PDC_TRIGGER_START, PDC_TRIGGER_CENTER, PDC_TRIGGER_END, PDC_TRIGGER_RANDOM,
+  PDC_TRIGGER_MANUAL, PDC_TRIGGER_RANDOM_RESET, PDC_TRIGGER_RANDOM_CENTER,
+  PDC_TRIGGER_RANDOM_MANUAL, PDC_TRIGGER_TWOSTAGE_HALF,
+  PDC_TRIGGER_TWOSTAGE_QUARTER, PDC_TRIGGER_TWOSTAGE_ONEEIGHTH
+};
+static const unsigned long simShadingModeList[] = {
+  PDC_SHADING_OFF, PDC_SHADING_ON, PDC_SHADING_SAVE, PDC_SHADING_LOAD
+};
+static const unsigned long simExtInModeList[] = {
+  PDC_EXT_IN_NONE, PDC_EXT_IN_CAMSYNC_POSI, PDC_EXT_IN_CAMSYNC_NEGA,
+  PDC_EXT_IN_OTHERSSYNC_POSI, PDC_EXT_IN_OTHERSSYNC_NEGA,
+  PDC_EXT_IN_EVENT_POSI, PDC_EXT_IN_EVENT_NEGA, PDC_EXT_IN_TRIGGER_POSI,
+  PDC_EXT_IN_TRIGGER_NEGA
+};
+static const unsigned long simExtOutModeList[] = {
+  PDC_EXT_OUT_SYNC_POSI, PDC_EXT_OUT_SYNC_NEGA, PDC_EXT_OUT_RECORD_POSI,
+  PDC_EXT_OUT_RECORD_NEGA, PDC_EXT_OUT_TRIGGER_POSI, PDC_EXT_OUT_TRIGGER_NEGA,
+  PDC_EXT_OUT_READY_POSI, PDC_EXT_OUT_READY_NEGA, PDC_EXT_OUT_EXPOSE_H1_POSI,
+  PDC_EXT_OUT_EXPOSE_H1_NEGA
+};
+static const unsigned long simSyncPriorityList[] = {0, 1};
+
+#define SIM_LIST_SIZE(list) (sizeof(list) / sizeof(list[0]))
+
+
+void PDCSim_Configure(unsigned long width, unsigned long height,
+                      unsigned long bits, double latencyUsec,
+                      double bandwidthMBps, unsigned long memFrames) {
+  if (width > 0) simWidth = width;
+  if (height > 0) simHeight = height;
+  if ((bits >= 8) && (bits <= 16)) simBits = bits;
+  if (latencyUsec >= 0.0) simLatency = latencyUsec * 1.0e-6;
+  if (bandwidthMBps >= 0.0) simBandwidth = bandwidthMBps * 1.0e6;
+  if (memFrames > 0) simMemFrames = memFrames;
+}
+
+
+static unsigned long simFail(unsigned long *pErrorCode, unsigned long error) {
+  *pErrorCode = error;
+  return PDC_FAILED;
+}
+
+
+static unsigned long simSucceed(unsigned long *pErrorCode) {
+  *pErrorCode = PDC_ERROR_NOERROR;
+  return PDC_SUCCEEDED;
+}
+
+
+/* Every SDK call goes over the network; charge the fixed latency. Returns
+   the handle itself, whose link is used for image transfers. */
+static simDevice *simHandle(unsigned long nDeviceNo, unsigned long *pErrorCode) {
+  simDevice *pDev;
+
+  if (!simInitialized) {
+    *pErrorCode = PDC_ERROR_UNINITIALIZE;
+    return NULL;
+  }
+  if ((nDeviceNo >= PDC_MAX_DEVICE) || !simDevices[nDeviceNo].open) {
+    *pErrorCode = PDC_ERROR_ILLEGAL_DEV_NO;
+    return NULL;
+  }
+  pDev = &simDevices[nDeviceNo];
+  if (simLatency > 0.0) {
+    epicsThreadSleep(simLatency);
+  }
+  epicsMutexMustLock(pDev->lock);
+  pDev->calls++;
+  epicsMutexUnlock(pDev->lock);
+  *pErrorCode = PDC_ERROR_NOERROR;
+  return pDev;
+}
+
+
+/* Returns the camera a handle reaches, which holds the settings and memory */
+static simDevice *simCall(unsigned long nDeviceNo, unsigned long *pErrorCode) {
+  simDevice *pDev = simHandle(nDeviceNo, pErrorCode);
+
+  if (pDev && pDev->link) {
+    pDev = &simDevices[pDev->primary];
+    if (!pDev->open) {
+      *pErrorCode = PDC_ERROR_ILLEGAL_DEV_NO;
+      return NULL;
+    }
+  }
+  return pDev;
+}
+
+
+static simDevice *simChildCall(unsigned long nDeviceNo, unsigned long nChildNo,
+                               unsigned long *pErrorCode) {
+  if ((nChildNo < 1) || (nChildNo > simChildren)) {
+    *pErrorCode = PDC_ERROR_ILLEGAL_CHILD_NO;
+    return NULL;
+  }
+  return simCall(nDeviceNo, pErrorCode);
+}
+
+
+static unsigned long simCopyList(const unsigned long *src, unsigned long n,
+                                 unsigned long *pSize, unsigned long *pList) {
+  unsigned long index;
+
+  if (n > PDC_MAX_LIST_NUMBER) n = PDC_MAX_LIST_NUMBER;
+  for (index=0; index<n; index++) {
+    pList[index] = src[index];
+  }
+  *pSize = n;
+  return n;
+}
+
+
+/* Advance the recording state machine; called with the device locked */
+static void simUpdateStatus(simDevice *pDev) {
+  epicsTimeStamp now;
+  long nFrames;
+  unsigned long index;
+
+  epicsTimeGetCurrent(&now);
+
+  switch (pDev->status) {
+    case PDC_STATUS_REC:
+      if (epicsTimeDiffInSeconds(&now, &pDev->recEnd) < 0.0) {
+        break;
+      }
+      /* Recording finished; fill in the memory description */
+      nFrames = (long) simMemFrames;
+      memset(&pDev->frameInfo, 0, sizeof(PDC_FRAME_INFO));
+      switch (pDev->triggerMode & 0xFF000000) {
+        case PDC_TRIGGER_CENTER:
+        case PDC_TRIGGER_RANDOM_CENTER:
+          pDev->frameInfo.m_nStart = -(nFrames / 2);
+          break;
+        case PDC_TRIGGER_END:
+        case PDC_TRIGGER_MANUAL:
+        case PDC_TRIGGER_RANDOM_MANUAL:
+          pDev->frameInfo.m_nStart = -(nFrames - 1);
+          break;
+        default:
+          pDev->frameInfo.m_nStart = 0;
+          break;
+      }
+      pDev->frameInfo.m_nEnd = pDev->frameInfo.m_nStart + nFrames - 1;
+      pDev->frameInfo.m_nTrigger = 0;
+      pDev->frameInfo.m_nRecordedFrames = nFrames;
+      if (simEventInterval > 0) {
+        for (index=0; index<PDC_MAX_EVENT; index++) {
+          if ((long)((index + 1) * simEventInterval) >= nFrames) break;
+          pDev->frameInfo.m_nEvent[index] = pDev->frameInfo.m_nStart + 
+                                            (index + 1) * simEventInterval;
+          pDev->frameInfo.m_nEventCount++;
+        }
+      }
+      pDev->memRate = pDev->recordRate;
+      pDev->memWidth = pDev->width;
+      pDev->memHeight = pDev->height;
+      pDev->memTriggerMode = pDev->triggerMode;
+      pDev->memIRIG = pDev->irig;
+      /* IRIG time of the first recorded frame */
+      pDev->irigStart = pDev->recEnd;
+      epicsTimeAddSeconds(&pDev->irigStart, -((double)nFrames / pDev->memRate));
+      pDev->memValid = 1;
+      pDev->status = PDC_STATUS_LIVE;
+      break;
+    case PDC_STATUS_SAVE:
+    case PDC_STATUS_LOAD:
+      if (epicsTimeDiffInSeconds(&now, &pDev->busyEnd) >= 0.0) {
+        pDev->status = PDC_STATUS_LIVE;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+
+static void simFillImage(unsigned long width, unsigned long height,
+                         unsigned long nBitDepth, unsigned long bitSel,
+                         unsigned long child, long frame, void *pData) {
+  unsigned long x, y;
+  unsigned long mask = (1UL << simBits) - 1;
+  unsigned long base;
+  int shift;
+
+  if (nBitDepth == 8) {
+    unsigned char *pOut = (unsigned char *) pData;
+    shift = (int)simBits - 8 - (int)bitSel;
+    if (shift < 0) shift = 0;
+    for (y=0; y<height; y++) {
+      base = y + (unsigned long)frame + SIM_CHILD_OFFSET * (child - 1);
+      for (x=0; x<width; x++) {
+        *pOut++ = (unsigned char) (((x + base) & mask) >> shift);
+      }
+    }
+  } else {
+    unsigned short *pOut = (unsigned short *) pData;
+    for (y=0; y<height; y++) {
+      base = y + (unsigned long)frame + SIM_CHILD_OFFSET * (child - 1);
+      for (x=0; x<width; x++) {
+        *pOut++ = (unsigned short) ((x + base) & mask);
+      }
+    }
+  }
+}
+
+
+/* Reserve the link for one image; returns the time the transfer completes.
+   Called with the device locked. */
+static epicsTimeStamp simReserveLink(simDevice *pDev, unsigned long nBytes) {
+  epicsTimeStamp start, done;
+
+  epicsTimeGetCurrent(&start);
+  if (epicsTimeDiffInSeconds(&pDev->linkFree, &start) > 0.0) {
+    start = pDev->linkFree;
+  }
+  done = start;
+  if (simBandwidth > 0.0) {
+    epicsTimeAddSeconds(&done, (double)nBytes / simBandwidth);
+  }
+  pDev->linkFree = done;
+  pDev->transfers++;
+  pDev->bytes += nBytes;
+  return done;
+}
+
+
+static void simWaitUntil(const epicsTimeStamp *pDone) {
+  epicsTimeStamp now;
+  double delay;
+
+  epicsTimeGetCurrent(&now);
+  delay = epicsTimeDiffInSeconds(pDone, &now);
+  if (delay > 0.0) {
+    epicsThreadSleep(delay);
+  }
+}
+
+
+static unsigned long simImageBytes(unsigned long width, unsigned long height,
+                                   unsigned long nBitDepth) {
+  return width * height * ((nBitDepth == 8) ? 1 : 2);
+}
+
+
+void PDCSim_SetEventInterval(unsigned long interval) {
+  simEventInterval = interval;
+}
+
+
+void PDCSim_SetChildCount(unsigned long count) {
+  if (count > 0) simChildren = count;
+}
+
+
+void PDCSim_AddLink(unsigned long ipAddr, unsigned long linkIpAddr) {
+  if (simNumLinks < PDC_MAX_DEVICE) {
+    simLinkAddr[simNumLinks][0] = ipAddr;
+    simLinkAddr[simNumLinks][1] = linkIpAddr;
+    simNumLinks++;
+  }
+}
+
+
+void PDCSim_Report(FILE *fp) {
+  int index;
+
+  fprintf(fp, "Simulated PDCLIB\n");
+  fprintf(fp, "  Sensor: %lu x %lu, %lu bits\n", simWidth, simHeight, simBits);
+  fprintf(fp, "  Call latency: %.1f us\n", simLatency * 1.0e6);
+  fprintf(fp, "  Link bandwidth: %.1f MB/s\n", simBandwidth / 1.0e6);
+  fprintf(fp, "  Memory frames: %lu\n", simMemFrames);
+  fprintf(fp, "  Event interval: %lu\n", simEventInterval);
+  fprintf(fp, "  Heads: %lu\n", simChildren);
+  for (index=0; index<PDC_MAX_DEVICE; index++) {
+    if (simDevices[index].open) {
+      fprintf(fp, "  Device %d: %lu calls, %lu transfers, %.1f MB", index,
+              simDevices[index].calls, simDevices[index].transfers,
+              simDevices[index].bytes / 1.0e6);
+      if (simDevices[index].link) {
+        fprintf(fp, " (second interface of device %d)", 
+                simDevices[index].primary);
+      }
+      fprintf(fp, "\n");
+    }
+  }
+}
+
+
+unsigned long PDC_Init(unsigned long *pErrorCode) {
+  int index;
+
+  if (simInitialized) {
+    return simFail(pErrorCode, PDC_ERROR_INITIALIZED);
+  }
+  for (index=0; index<PDC_MAX_DEVICE; index++) {
+    memset(&simDevices[index], 0, sizeof(simDevice));
+    simDevices[index].lock = epicsMutexMustCreate();
+  }
+  simInitialized = 1;
+  return simSucceed(pErrorCode);
+}
+
+
+unsigned long PDC_DetectDevice(unsigned long nInterfaceCode,
+                               unsigned long *pDetectNo,
+                               unsigned long nDetectNum,
+                               unsigned long nDetectParam,
+                               PPDC_DETECT_NUM_INFO pDetectNumInfo,
+                               unsigned long *pErrorCode) {
+  unsigned long index;
+
+  if (!simInitialized) {
+    return simFail(pErrorCode, PDC_ERROR_UNINITIALIZE);
+  }
+  if ((nInterfaceCode != PDC_INTTYPE_G_ETHER) || (nDetectNum > PDC_MAX_DEVICE)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  /* Every requested address answers */
+  pDetectNumInfo->m_nDeviceNum = nDetectNum;
+  for (index=0; index<nDetectNum; index++) {
+    pDetectNumInfo->m_DetectInfo[index].m_nDeviceCode = SIM_DEVICE_CODE;
+    pDetectNumInfo->m_DetectInfo[index].m_nTmpDeviceNo = pDetectNo[index];
+    pDetectNumInfo->m_DetectInfo[index].m_nInterfaceCode = nInterfaceCode;
+  }
+  return simSucceed(pErrorCode);
+}
+
+
+unsigned long PDC_OpenDevice(PPDC_DETECT_INFO pDetectInfo,
+                             unsigned long *pDeviceNo,
+                             unsigned long *pErrorCode) {
+  simDevice *pDev;
+  epicsMutexId lock;
+  int index, chan, link, primary;
+
+  if (!simInitialized) {
+    return simFail(pErrorCode, PDC_ERROR_UNINITIALIZE);
+  }
+  for (index=0; index<PDC_MAX_DEVICE; index++) {
+    if (!simDevices[index].open) break;
+  }
+  if (index == PDC_MAX_DEVICE) {
+    return simFail(pErrorCode, PDC_ERROR_NO_DEVICE);
+  }
+  pDev = &simDevices[index];
+  lock = pDev->lock;
+  memset(pDev, 0, sizeof(simDevice));
+  pDev->lock = lock;
+  pDev->open = 1;
+  pDev->ipAddr = pDetectInfo->m_nTmpDeviceNo;
+  pDev->status = PDC_STATUS_LIVE;
+  pDev->recordRate = 1000;
+  pDev->shutterFps = pDev->recordRate;
+  pDev->width = simWidth;
+  pDev->height = simHeight;
+  pDev->triggerMode = PDC_TRIGGER_START;
+  pDev->rCount = 1;
+  pDev->shadingMode = PDC_SHADING_OFF;
+  pDev->irig = 1;
+  for (chan=0; chan<PDC_EXTIO_MAX_PORT; chan++) {
+    pDev->extInMode[chan] = PDC_EXT_IN_NONE;
+    pDev->extOutMode[chan] = PDC_EXT_OUT_SYNC_POSI;
+  }
+  epicsTimeGetCurrent(&pDev->liveStart);
+  pDev->linkFree = pDev->liveStart;
+  /* The second address of a camera that is already open */
+  for (link=0; link<simNumLinks; link++) {
+    if (simLinkAddr[link][1] != pDev->ipAddr) continue;
+    for (primary=0; primary<PDC_MAX_DEVICE; primary++) {
+      if ((primary != index) && simDevices[primary].open && 
+          !simDevices[primary].link &&
+          (simDevices[primary].ipAddr == simLinkAddr[link][0])) {
+        pDev->link = 1;
+        pDev->primary = primary;
+        break;
+      }
+    }
+  }
+  *pDeviceNo = index;
+  return simSucceed(pErrorCode);
+}
+
+
+unsigned long PDC_OpenDevice2(PPDC_DETECT_INFO pDetectInfo,
+                              unsigned long nMaxRetryCount,
+                              unsigned long nConnectMode,
+                              unsigned long *pDeviceNo,
+                              unsigned long *pErrorCode) {
+  return PDC_OpenDevice(pDetectInfo, pDeviceNo, pErrorCode);
+}
+
+
+unsigned long PDC_CloseDevice(unsigned long nDeviceNo, unsigned long *pErrorCode) {
+  simDevice *pDev = simHandle(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  epicsMutexMustLock(pDev->lock);
+  pDev->open = 0;
+  epicsMutexUnlock(pDev->lock);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_IsFunction(unsigned long nDeviceNo, unsigned long nChildNo,
+                             unsigned long nFunction, char *pFlag,
+                             unsigned long *pErrorCode) {
+  /* Skip the per-call latency; the driver queries ~100 functions at connect */
+  if (!simInitialized) {
+    return simFail(pErrorCode, PDC_ERROR_UNINITIALIZE);
+  }
+  if ((nDeviceNo >= PDC_MAX_DEVICE) || !simDevices[nDeviceNo].open) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_DEV_NO);
+  }
+  switch (nFunction) {
+    case PDC_EXIST_SHADING:
+    case PDC_EXIST_IRIG:
+    case PDC_EXIST_BURST_TRANSFER:
+    case PDC_EXIST_BITDEPTH:
+    case PDC_EXIST_SYNC_PRIORITY:
+      *pFlag = PDC_EXIST_SUPPORTED;
+      break;
+    default:
+      *pFlag = PDC_EXIST_NOTSUPPORTED;
+      break;
+  }
+  return simSucceed(pErrorCode);
+}
+
+
+unsigned long PDC_GetDeviceCode(unsigned long nDeviceNo, unsigned long *pCode,
+                                unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  *pCode = SIM_DEVICE_CODE;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetDeviceName(unsigned long nDeviceNo, unsigned long nIndex,
+                                TCHAR *pStr, unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  strcpy(pStr, SIM_DEVICE_NAME);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetDeviceID(unsigned long nDeviceNo, unsigned long *pID,
+                              unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  *pID = nDeviceNo;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetLotID(unsigned long nDeviceNo, unsigned long nIndex,
+                           unsigned long *pID, unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  *pID = 1;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetProductID(unsigned long nDeviceNo, unsigned long nIndex,
+                               unsigned long *pID, unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  *pID = 1;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetIndividualID(unsigned long nDeviceNo, unsigned long nIndex,
+                                  unsigned long *pID, unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  *pID = simDevices[nDeviceNo].ipAddr & 0xFF;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetVersion(unsigned long nDeviceNo, unsigned long nIndex,
+                             unsigned long *pVersion, unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  *pVersion = 100;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetMaxChildDeviceCount(unsigned long nDeviceNo,
+                                         unsigned long *pCount,
+                                         unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  *pCount = simChildren;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetChildDeviceCount(unsigned long nDeviceNo,
+                                      unsigned long *pCount,
+                                      unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  *pCount = simChildren;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetMaxResolution(unsigned long nDeviceNo, unsigned long nChildNo,
+                                   unsigned long *pWidth, unsigned long *pHeight,
+                                   unsigned long *pErrorCode) {
+  if (!simChildCall(nDeviceNo, nChildNo, pErrorCode)) return PDC_FAILED;
+  *pWidth = simWidth;
+  *pHeight = simHeight;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetMaxBitDepth(unsigned long nDeviceNo, unsigned long nChildNo,
+                                 char *pDepth, unsigned long *pErrorCode) {
+  if (!simChildCall(nDeviceNo, nChildNo, pErrorCode)) return PDC_FAILED;
+  *pDepth = (char) simBits;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetBitDepth(unsigned long nDeviceNo, unsigned long nChildNo,
+                              char *pDepth, unsigned long *pErrorCode) {
+  if (!simChildCall(nDeviceNo, nChildNo, pErrorCode)) return PDC_FAILED;
+  *pDepth = (char) simBits;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetExternalCount(unsigned long nDeviceNo, unsigned long *pInCount,
+                                   unsigned long *pOutCount,
+                                   unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  *pInCount = SIM_EXT_IN_PORTS;
+  *pOutCount = SIM_EXT_OUT_PORTS;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetStatus(unsigned long nDeviceNo, unsigned long *pStatus,
+                            unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  epicsMutexMustLock(pDev->lock);
+  simUpdateStatus(pDev);
+  *pStatus = pDev->status;
+  epicsMutexUnlock(pDev->lock);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetStatus(unsigned long nDeviceNo, unsigned long nStatus,
+                            unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if ((nStatus != PDC_STATUS_LIVE) && (nStatus != PDC_STATUS_PLAYBACK)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  epicsMutexMustLock(pDev->lock);
+  simUpdateStatus(pDev);
+  if ((nStatus == PDC_STATUS_PLAYBACK) && (pDev->status != PDC_STATUS_LIVE) &&
+      (pDev->status != PDC_STATUS_PLAYBACK)) {
+    epicsMutexUnlock(pDev->lock);
+    return simFail(pErrorCode, PDC_ERROR_SEQUENCE);
+  }
+  pDev->status = nStatus;
+  epicsMutexUnlock(pDev->lock);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetRecReady(unsigned long nDeviceNo, unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  epicsMutexMustLock(pDev->lock);
+  simUpdateStatus(pDev);
+  pDev->status = PDC_STATUS_RECREADY;
+  epicsMutexUnlock(pDev->lock);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetEndless(unsigned long nDeviceNo, unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  epicsMutexMustLock(pDev->lock);
+  if (pDev->status != PDC_STATUS_RECREADY) {
+    epicsMutexUnlock(pDev->lock);
+    return simFail(pErrorCode, PDC_ERROR_SEQUENCE);
+  }
+  pDev->status = PDC_STATUS_ENDLESS;
+  epicsMutexUnlock(pDev->lock);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_TriggerIn(unsigned long nDeviceNo, unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+  double recTime;
+
+  if (!pDev) return PDC_FAILED;
+  epicsMutexMustLock(pDev->lock);
+  if ((pDev->status != PDC_STATUS_RECREADY) &&
+      (pDev->status != PDC_STATUS_ENDLESS)) {
+    epicsMutexUnlock(pDev->lock);
+    return simFail(pErrorCode, PDC_ERROR_SEQUENCE);
+  }
+  /* Time needed to fill the post-trigger part of memory */
+  recTime = (double)simMemFrames / pDev->recordRate;
+  if (pDev->status == PDC_STATUS_ENDLESS) {
+    switch (pDev->triggerMode & 0xFF000000) {
+      case PDC_TRIGGER_CENTER:
+      case PDC_TRIGGER_RANDOM_CENTER:
+        recTime /= 2.0;
+        break;
+      case PDC_TRIGGER_END:
+      case PDC_TRIGGER_MANUAL:
+      case PDC_TRIGGER_RANDOM_MANUAL:
+        recTime = 0.0;
+        break;
+      default:
+        break;
+    }
+  }
+  epicsTimeGetCurrent(&pDev->recEnd);
+  epicsTimeAddSeconds(&pDev->recEnd, recTime);
+  pDev->status = PDC_STATUS_REC;
+  epicsMutexUnlock(pDev->lock);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetCamMode(unsigned long nDeviceNo, unsigned long nChildNo,
+                             unsigned long *pMode, unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  *pMode = (pDev->varChannel > 0) ? 1 : 0;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetRecordRate(unsigned long nDeviceNo, unsigned long nChildNo,
+                                unsigned long *pRate, unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  *pRate = pDev->recordRate;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetRecordRate(unsigned long nDeviceNo, unsigned long nChildNo,
+                                unsigned long nRate, unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+  unsigned long index;
+
+  if (!pDev) return PDC_FAILED;
+  for (index=0; index<SIM_LIST_SIZE(simRateList); index++) {
+    if (simRateList[index] == nRate) break;
+  }
+  if (index == SIM_LIST_SIZE(simRateList)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  epicsMutexMustLock(pDev->lock);
+  pDev->recordRate = nRate;
+  if (pDev->shutterFps < nRate) {
+    pDev->shutterFps = nRate;
+  }
+  epicsTimeGetCurrent(&pDev->liveStart);
+  epicsMutexUnlock(pDev->lock);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetRecordRateList(unsigned long nDeviceNo, unsigned long nChildNo,
+                                    unsigned long *pSize, unsigned long *pList,
+                                    unsigned long *pErrorCode) {
+  if (!simChildCall(nDeviceNo, nChildNo, pErrorCode)) return PDC_FAILED;
+  simCopyList(simRateList, SIM_LIST_SIZE(simRateList), pSize, pList);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetMaxFrames(unsigned long nDeviceNo, unsigned long nChildNo,
+                               unsigned long *pFrames, unsigned long *pBlocks,
+                               unsigned long *pErrorCode) {
+  if (!simChildCall(nDeviceNo, nChildNo, pErrorCode)) return PDC_FAILED;
+  *pFrames = simMemFrames;
+  *pBlocks = 1;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetResolution(unsigned long nDeviceNo, unsigned long nChildNo,
+                                unsigned long *pWidth, unsigned long *pHeight,
+                                unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  *pWidth = pDev->width;
+  *pHeight = pDev->height;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetResolution(unsigned long nDeviceNo, unsigned long nChildNo,
+                                unsigned long nWidth, unsigned long nHeight,
+                                unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if ((nWidth == 0) || (nHeight == 0) || (nWidth > simWidth) ||
+      (nHeight > simHeight)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  epicsMutexMustLock(pDev->lock);
+  pDev->width = nWidth;
+  pDev->height = nHeight;
+  epicsMutexUnlock(pDev->lock);
+  return PDC_SUCCEEDED;
+}
+
+
+/* Full sensor and repeated halving of each dimension, encoded width<<16|height */
+unsigned long PDC_GetResolutionList(unsigned long nDeviceNo, unsigned long nChildNo,
+                                    unsigned long *pSize, unsigned long *pList,
+                                    unsigned long *pErrorCode) {
+  unsigned long width = simWidth, height = simHeight, n = 0;
+
+  if (!simChildCall(nDeviceNo, nChildNo, pErrorCode)) return PDC_FAILED;
+  while ((width >= 128) && (height >= 16) && (n < PDC_MAX_LIST_NUMBER - 1)) {
+    pList[n++] = (width << 16) | height;
+    if (height > width / 2) {
+      height /= 2;
+    } else {
+      pList[n++] = ((width / 2) << 16) | height;
+      width /= 2;
+      height /= 2;
+    }
+  }
+  *pSize = n;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetSegmentPosition(unsigned long nDeviceNo, unsigned long nChildNo,
+                                     unsigned long *pXPos, unsigned long *pYPos,
+                                     unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  *pXPos = (simWidth - pDev->width) / 2;
+  *pYPos = (simHeight - pDev->height) / 2;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetShutterSpeedFps(unsigned long nDeviceNo, unsigned long nChildNo,
+                                     unsigned long *pFps, unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  *pFps = pDev->shutterFps;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetShutterSpeedFps(unsigned long nDeviceNo, unsigned long nChildNo,
+                                     unsigned long nFps, unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if (nFps < pDev->recordRate) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  pDev->shutterFps = nFps;
+  return PDC_SUCCEEDED;
+}
+
+
+/* Shutter speeds from 1/rate down to ~1 us in powers of two */
+unsigned long PDC_GetShutterSpeedFpsList(unsigned long nDeviceNo,
+                                         unsigned long nChildNo,
+                                         unsigned long *pSize, unsigned long *pList,
+                                         unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+  unsigned long fps, n = 0;
+
+  if (!pDev) return PDC_FAILED;
+  for (fps=pDev->recordRate; (fps<=1000000) && (n<PDC_MAX_LIST_NUMBER); fps*=2) {
+    pList[n++] = fps;
+  }
+  *pSize = n;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetTriggerMode(unsigned long nDeviceNo, unsigned long *pMode,
+                                 unsigned long *pAFrames, unsigned long *pRFrames,
+                                 unsigned long *pRCount, unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  *pMode = pDev->triggerMode;
+  *pAFrames = pDev->aFrames;
+  *pRFrames = pDev->rFrames;
+  *pRCount = pDev->rCount;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetTriggerMode(unsigned long nDeviceNo, unsigned long nMode,
+                                 unsigned long nAFrames, unsigned long nRFrames,
+                                 unsigned long nRCount, unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+  unsigned long index;
+
+  if (!pDev) return PDC_FAILED;
+  for (index=0; index<SIM_LIST_SIZE(simTriggerModeList); index++) {
+    if (simTriggerModeList[index] == nMode) break;
+  }
+  if (index == SIM_LIST_SIZE(simTriggerModeList)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  pDev->triggerMode = nMode;
+  pDev->aFrames = nAFrames;
+  pDev->rFrames = nRFrames;
+  pDev->rCount = nRCount;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetTriggerModeList(unsigned long nDeviceNo, unsigned long *pSize,
+                                     unsigned long *pList,
+                                     unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  simCopyList(simTriggerModeList, SIM_LIST_SIZE(simTriggerModeList), pSize, pList);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetShadingMode(unsigned long nDeviceNo, unsigned long nChildNo,
+                                 unsigned long *pMode, unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  *pMode = pDev->shadingMode;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetShadingMode(unsigned long nDeviceNo, unsigned long nChildNo,
+                                 unsigned long nMode, unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  epicsMutexMustLock(pDev->lock);
+  switch (nMode) {
+    case PDC_SHADING_OFF:
+    case PDC_SHADING_ON:
+      pDev->shadingMode = nMode;
+      break;
+    case PDC_SHADING_SAVE:
+    case PDC_SHADING_LOAD:
+      /* Calibration takes a while; the camera reports SAVE/LOAD until done */
+      pDev->status = (nMode == PDC_SHADING_SAVE) ? PDC_STATUS_SAVE :
+                                                   PDC_STATUS_LOAD;
+      epicsTimeGetCurrent(&pDev->busyEnd);
+      epicsTimeAddSeconds(&pDev->busyEnd, SIM_SAVE_LOAD_TIME);
+      pDev->shadingMode = PDC_SHADING_ON;
+      break;
+    default:
+      epicsMutexUnlock(pDev->lock);
+      return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  epicsMutexUnlock(pDev->lock);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetShadingModeList(unsigned long nDeviceNo, unsigned long nChildNo,
+                                     unsigned long *pSize, unsigned long *pList,
+                                     unsigned long *pErrorCode) {
+  if (!simChildCall(nDeviceNo, nChildNo, pErrorCode)) return PDC_FAILED;
+  simCopyList(simShadingModeList, SIM_LIST_SIZE(simShadingModeList), pSize, pList);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetTransferOption(unsigned long nDeviceNo, unsigned long nChildNo,
+                                    unsigned long n8BitSel, unsigned long nBayer,
+                                    unsigned long nInterleave,
+                                    unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if (n8BitSel > simBits - 8) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  pDev->bitSel = n8BitSel;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetIRIG(unsigned long nDeviceNo, unsigned long *pMode,
+                          unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  *pMode = pDev->irig;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetIRIG(unsigned long nDeviceNo, unsigned long nMode,
+                          unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  pDev->irig = nMode ? 1 : 0;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetSyncPriority(unsigned long nDeviceNo, unsigned long *pMode,
+                                  unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  *pMode = pDev->syncPriority;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetSyncPriority(unsigned long nDeviceNo, unsigned long nMode,
+                                  unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  pDev->syncPriority = nMode;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetSyncPriorityList(unsigned long nDeviceNo, unsigned long *pSize,
+                                      unsigned long *pList,
+                                      unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  simCopyList(simSyncPriorityList, SIM_LIST_SIZE(simSyncPriorityList), pSize,
+              pList);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetHighSpeedMode(unsigned long nDeviceNo, unsigned long *pMode,
+                                   unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  *pMode = PDC_FUNCTION_OFF;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetBurstTransfer(unsigned long nDeviceNo, unsigned long *pMode,
+                                   unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  *pMode = pDev->burstTransfer;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetBurstTransfer(unsigned long nDeviceNo, unsigned long nMode,
+                                   unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  pDev->burstTransfer = nMode ? PDC_FUNCTION_ON : PDC_FUNCTION_OFF;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetExternalInMode(unsigned long nDeviceNo, unsigned long nPort,
+                                    unsigned long *pMode, unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if ((nPort < 1) || (nPort > SIM_EXT_IN_PORTS)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  *pMode = pDev->extInMode[nPort-1];
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetExternalInMode(unsigned long nDeviceNo, unsigned long nPort,
+                                    unsigned long nMode, unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if ((nPort < 1) || (nPort > SIM_EXT_IN_PORTS)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  pDev->extInMode[nPort-1] = nMode;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetExternalInModeList(unsigned long nDeviceNo, unsigned long nPort,
+                                        unsigned long *pSize, unsigned long *pList,
+                                        unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  if ((nPort < 1) || (nPort > SIM_EXT_IN_PORTS)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  simCopyList(simExtInModeList, SIM_LIST_SIZE(simExtInModeList), pSize, pList);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetExternalOutMode(unsigned long nDeviceNo, unsigned long nPort,
+                                     unsigned long *pMode, unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if ((nPort < 1) || (nPort > SIM_EXT_OUT_PORTS)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  *pMode = pDev->extOutMode[nPort-1];
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetExternalOutMode(unsigned long nDeviceNo, unsigned long nPort,
+                                     unsigned long nMode, unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if ((nPort < 1) || (nPort > SIM_EXT_OUT_PORTS)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  pDev->extOutMode[nPort-1] = nMode;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetExternalOutModeList(unsigned long nDeviceNo, unsigned long nPort,
+                                         unsigned long *pSize, unsigned long *pList,
+                                         unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  if ((nPort < 1) || (nPort > SIM_EXT_OUT_PORTS)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  simCopyList(simExtOutModeList, SIM_LIST_SIZE(simExtOutModeList), pSize, pList);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetVariableRestriction(unsigned long nDeviceNo,
+                                         unsigned long *pWStep, unsigned long *pHStep,
+                                         unsigned long *pXPosStep,
+                                         unsigned long *pYPosStep,
+                                         unsigned long *pWMin, unsigned long *pHMin,
+                                         unsigned long *pFreePos,
+                                         unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  *pWStep = 128;
+  *pHStep = 16;
+  *pXPosStep = 128;
+  *pYPosStep = 16;
+  *pWMin = 128;
+  *pHMin = 16;
+  *pFreePos = PDC_VARIABLE_FREE_X | PDC_VARIABLE_FREE_Y;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetVariableChannel(unsigned long nDeviceNo, unsigned long nChildNo,
+                                     unsigned long *pChannel,
+                                     unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  *pChannel = pDev->varChannel;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetVariableChannel(unsigned long nDeviceNo, unsigned long nChildNo,
+                                     unsigned long nChannel,
+                                     unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if (nChannel > PDC_VARIABLE_NUM) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  epicsMutexMustLock(pDev->lock);
+  pDev->varChannel = nChannel;
+  if ((nChannel > 0) && (pDev->varRate[nChannel] > 0)) {
+    pDev->recordRate = pDev->varRate[nChannel];
+    pDev->width = pDev->varWidth[nChannel];
+    pDev->height = pDev->varHeight[nChannel];
+  }
+  epicsMutexUnlock(pDev->lock);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetVariableChannelInfo(unsigned long nDeviceNo,
+                                         unsigned long nChannel,
+                                         unsigned long *pRate, unsigned long *pWidth,
+                                         unsigned long *pHeight,
+                                         unsigned long *pXPos, unsigned long *pYPos,
+                                         unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if ((nChannel < 1) || (nChannel > PDC_VARIABLE_NUM)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  *pRate = pDev->varRate[nChannel];
+  *pWidth = pDev->varWidth[nChannel];
+  *pHeight = pDev->varHeight[nChannel];
+  *pXPos = pDev->varXPos[nChannel];
+  *pYPos = pDev->varYPos[nChannel];
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_SetVariableChannelInfo(unsigned long nDeviceNo,
+                                         unsigned long nChannel,
+                                         unsigned long nRate, unsigned long nWidth,
+                                         unsigned long nHeight,
+                                         unsigned long nXPos, unsigned long nYPos,
+                                         unsigned long *pErrorCode) {
+  simDevice *pDev = simCall(nDeviceNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if ((nChannel < 1) || (nChannel > PDC_VARIABLE_NUM) ||
+      (nWidth + nXPos > simWidth) || (nHeight + nYPos > simHeight)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  pDev->varRate[nChannel] = nRate;
+  pDev->varWidth[nChannel] = nWidth;
+  pDev->varHeight[nChannel] = nHeight;
+  pDev->varXPos[nChannel] = nXPos;
+  pDev->varYPos[nChannel] = nYPos;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_EraseVariableChannel(unsigned long nDeviceNo,
+                                       unsigned long nChannel,
+                                       unsigned long *pErrorCode) {
+  return PDC_SetVariableChannelInfo(nDeviceNo, nChannel, 0, 0, 0, 0, 0,
+                                    pErrorCode);
+}
+
+
+unsigned long PDC_GetVariableRecordRateList(unsigned long nDeviceNo,
+                                            unsigned long nChildNo,
+                                            unsigned long *pSize,
+                                            unsigned long *pList,
+                                            unsigned long *pErrorCode) {
+  return PDC_GetRecordRateList(nDeviceNo, nChildNo, pSize, pList, pErrorCode);
+}
+
+
+unsigned long PDC_GetVariableMaxResolution(unsigned long nDeviceNo,
+                                           unsigned long nRate,
+                                           unsigned long *pWidth,
+                                           unsigned long *pHeight,
+                                           unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  *pWidth = simWidth;
+  *pHeight = simHeight;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetVariableMaxWidth(unsigned long nDeviceNo, unsigned long nRate,
+                                      unsigned long nHeight, unsigned long *pWidth,
+                                      unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  *pWidth = simWidth;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetVariableMaxHeight(unsigned long nDeviceNo, unsigned long nRate,
+                                       unsigned long nWidth, unsigned long *pHeight,
+                                       unsigned long *pErrorCode) {
+  if (!simCall(nDeviceNo, pErrorCode)) return PDC_FAILED;
+  *pHeight = simHeight;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetLiveImageData(unsigned long nDeviceNo, unsigned long nChildNo,
+                                   unsigned long nBitDepth, void *pData,
+                                   unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+  epicsTimeStamp now, done;
+  unsigned long width, height, bitSel;
+  long frame;
+
+  if (!pDev) return PDC_FAILED;
+  if ((nBitDepth != 8) && (nBitDepth != 16)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  epicsMutexMustLock(pDev->lock);
+  width = pDev->width;
+  height = pDev->height;
+  bitSel = pDev->bitSel;
+  epicsTimeGetCurrent(&now);
+  frame = (long) (epicsTimeDiffInSeconds(&now, &pDev->liveStart) *
+                  pDev->recordRate);
+  done = simReserveLink(pDev, simImageBytes(width, height, nBitDepth));
+  epicsMutexUnlock(pDev->lock);
+
+  simWaitUntil(&done);
+  simFillImage(width, height, nBitDepth, bitSel, nChildNo, frame, pData);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetMemFrameInfo(unsigned long nDeviceNo, unsigned long nChildNo,
+                                  PPDC_FRAME_INFO pFrame, unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  epicsMutexMustLock(pDev->lock);
+  simUpdateStatus(pDev);
+  if (!pDev->memValid) {
+    memset(pFrame, 0, sizeof(PDC_FRAME_INFO));
+  } else {
+    *pFrame = pDev->frameInfo;
+  }
+  epicsMutexUnlock(pDev->lock);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetMemResolution(unsigned long nDeviceNo, unsigned long nChildNo,
+                                   unsigned long *pWidth, unsigned long *pHeight,
+                                   unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if (!pDev->memValid) {
+    return simFail(pErrorCode, PDC_ERROR_SEQUENCE);
+  }
+  *pWidth = pDev->memWidth;
+  *pHeight = pDev->memHeight;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetMemRecordRate(unsigned long nDeviceNo, unsigned long nChildNo,
+                                   unsigned long *pRate, unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if (!pDev->memValid) {
+    return simFail(pErrorCode, PDC_ERROR_SEQUENCE);
+  }
+  *pRate = pDev->memRate;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetMemTriggerMode(unsigned long nDeviceNo, unsigned long nChildNo,
+                                    unsigned long *pMode, unsigned long *pAFrames,
+                                    unsigned long *pRFrames, unsigned long *pRCount,
+                                    unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if (!pDev->memValid) {
+    return simFail(pErrorCode, PDC_ERROR_SEQUENCE);
+  }
+  *pMode = pDev->memTriggerMode;
+  *pAFrames = pDev->aFrames;
+  *pRFrames = pDev->rFrames;
+  *pRCount = pDev->rCount;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetMemIRIG(unsigned long nDeviceNo, unsigned long nChildNo,
+                             unsigned long *pMode, unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+
+  if (!pDev) return PDC_FAILED;
+  if (!pDev->memValid) {
+    return simFail(pErrorCode, PDC_ERROR_SEQUENCE);
+  }
+  *pMode = pDev->memIRIG;
+  return PDC_SUCCEEDED;
+}
+
+
+/* Validate a memory frame number; called with the device locked */
+static int simValidFrame(simDevice *pDev, long nFrameNo) {
+  return (pDev->memValid && (pDev->status == PDC_STATUS_PLAYBACK) &&
+          (nFrameNo >= pDev->frameInfo.m_nStart) &&
+          (nFrameNo <= pDev->frameInfo.m_nEnd));
+}
+
+
+unsigned long PDC_GetMemIRIGData(unsigned long nDeviceNo, unsigned long nChildNo,
+                                 long nFrameNo, PPDC_IRIG_INFO pData,
+                                 unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+  epicsTimeStamp frameTime;
+  time_t tt;
+  struct tm tmFrame;
+
+  if (!pDev) return PDC_FAILED;
+  epicsMutexMustLock(pDev->lock);
+  if (!simValidFrame(pDev, nFrameNo) || !pDev->memIRIG) {
+    epicsMutexUnlock(pDev->lock);
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  frameTime = pDev->irigStart;
+  epicsTimeAddSeconds(&frameTime, (double)(nFrameNo - pDev->frameInfo.m_nStart) /
+                                  pDev->memRate);
+  epicsMutexUnlock(pDev->lock);
+
+  /* IRIG-B carries UTC day of year and time of day */
+  epicsTimeToTime_t(&tt, &frameTime);
+  epicsTime_gmtime(&tt, &tmFrame);
+  memset(pData, 0, sizeof(PDC_IRIG_INFO));
+  pData->m_nDayOfYear = tmFrame.tm_yday + 1;
+  pData->m_nHour = tmFrame.tm_hour;
+  pData->m_nMinute = tmFrame.tm_min;
+  pData->m_nSecond = tmFrame.tm_sec;
+  pData->m_nMicroSecond = frameTime.nsec / 1000;
+  pData->m_ExistSignal = 1;
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetMemImageData(unsigned long nDeviceNo, unsigned long nChildNo,
+                                  long nFrameNo, unsigned long nBitDepth,
+                                  void *pData, unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+  epicsTimeStamp done;
+  unsigned long width, height, bitSel;
+
+  if (!pDev) return PDC_FAILED;
+  if ((nBitDepth != 8) && (nBitDepth != 16)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  epicsMutexMustLock(pDev->lock);
+  if (!simValidFrame(pDev, nFrameNo)) {
+    epicsMutexUnlock(pDev->lock);
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  width = pDev->memWidth;
+  height = pDev->memHeight;
+  bitSel = pDev->bitSel;
+  done = simReserveLink(pDev, simImageBytes(width, height, nBitDepth));
+  epicsMutexUnlock(pDev->lock);
+
+  simWaitUntil(&done);
+  simFillImage(width, height, nBitDepth, bitSel, nChildNo, nFrameNo, pData);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetMemImageDataStart(unsigned long nDeviceNo,
+                                       unsigned long nChildNo, long nFrameNo,
+                                       unsigned long nBitDepth, void *pData,
+                                       unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+  simDevice *pLink;
+  unsigned long nBytes;
+
+  if (!pDev) return PDC_FAILED;
+  pLink = &simDevices[nDeviceNo];
+  if ((nBitDepth != 8) && (nBitDepth != 16)) {
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  epicsMutexMustLock(pDev->lock);
+  if (!simValidFrame(pDev, nFrameNo)) {
+    epicsMutexUnlock(pDev->lock);
+    return simFail(pErrorCode, PDC_ERROR_ILLEGAL_VALUE);
+  }
+  nBytes = simImageBytes(pDev->memWidth, pDev->memHeight, nBitDepth);
+  epicsMutexUnlock(pDev->lock);
+
+  /* The transfer proceeds in the background until PDC_GetMemImageDataEnd,
+     on the link of the interface the handle was opened on */
+  epicsMutexMustLock(pLink->lock);
+  if (pLink->pending) {
+    epicsMutexUnlock(pLink->lock);
+    return simFail(pErrorCode, PDC_ERROR_SEQUENCE);
+  }
+  pLink->pending = 1;
+  pLink->pendingChild = nChildNo;
+  pLink->pendingFrame = nFrameNo;
+  pLink->pendingBits = nBitDepth;
+  pLink->pendingData = pData;
+  pLink->pendingDone = simReserveLink(pLink, nBytes);
+  epicsMutexUnlock(pLink->lock);
+  return PDC_SUCCEEDED;
+}
+
+
+unsigned long PDC_GetMemImageDataEnd(unsigned long nDeviceNo, unsigned long nChildNo,
+                                     unsigned long nBitDepth, void *pData,
+                                     unsigned long *pErrorCode) {
+  simDevice *pDev = simChildCall(nDeviceNo, nChildNo, pErrorCode);
+  simDevice *pLink;
+  epicsTimeStamp done;
+  unsigned long width, height, bitSel;
+  long frame;
+  void *pDest;
+
+  if (!pDev) return PDC_FAILED;
+  pLink = &simDevices[nDeviceNo];
+  epicsMutexMustLock(pLink->lock);
+  if (!pLink->pending || (nBitDepth != pLink->pendingBits) ||
+      (nChildNo != pLink->pendingChild)) {
+    epicsMutexUnlock(pLink->lock);
+    return simFail(pErrorCode, PDC_ERROR_SEQUENCE);
+  }
+  done = pLink->pendingDone;
+  frame = pLink->pendingFrame;
+  pDest = pLink->pendingData;
+  epicsMutexUnlock(pLink->lock);
+  epicsMutexMustLock(pDev->lock);
+  width = pDev->memWidth;
+  height = pDev->memHeight;
+  bitSel = pDev->bitSel;
+  epicsMutexUnlock(pDev->lock);
+
+  simWaitUntil(&done);
+  /* The data lands in the buffer given to PDC_GetMemImageDataStart */
+  simFillImage(width, height, nBitDepth, bitSel, nChildNo, frame, pDest);
+  if (pData && (pData != pDest)) {
+    memcpy(pData, pDest, simImageBytes(width, height, nBitDepth));
+  }
+
+  epicsMutexMustLock(pLink->lock);
+  pLink->pending = 0;
+  epicsMutexUnlock(pLink->lock);
+  return PDC_SUCCEEDED;
+}
@@ -0,0 +1,399 @@
+/* pdcSimBench.cpp
+ *
+ * Benchmarks of the driver's camera access patterns against the simulated
+ * PDCLIB. Each test replays the sequence of SDK calls that a driver feature
+ * makes, on the camera model of PDCSim.cpp, and prints the rates it reaches.
+ * The numbers quoted in the driver's change history come from these tests.
+ *
+ * Usage: pdcSimBench test
+ *   direct   memory readout into the array vs through a staging buffer
+ *   irig     memory readout with IRIG off, read per frame, and prefetched
+ *   heads    memory readout of 1 to 8 heads sharing one device
+ *
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <epicsTime.h>
+#include <epicsThread.h>
+#include <epicsMutex.h>
+#include <epicsEvent.h>
+
+#include "PDCLIB.h"
+
+/* Each measurement is repeated and the best run is reported */
+#define BENCH_RUNS              3
+/* Destination buffers a readout cycles through, like the NDArray pool */
+#define BENCH_BUFFERS           4
+/* Address of the first simulated camera */
+#define BENCH_IP_ADDR           0xC0A8000AUL
+/* IRIG times the driver requests ahead of the readout (IRIG_PREFETCH_FRAMES) */
+#define BENCH_IRIG_AHEAD        32
+/* Most heads benchHeads reads at once */
+#define BENCH_MAX_HEADS         8
+
+/* How benchReadout handles each frame */
+typedef enum {
+  BENCH_STAGING,        /* Transfer to a staging buffer, then copy */
+  BENCH_DIRECT,         /* Transfer into the destination buffer */
+  BENCH_IRIG_FRAME,     /* BENCH_DIRECT, then read the frame's IRIG time */
+  BENCH_IRIG_PREFETCH   /* BENCH_DIRECT, fetching IRIG times ahead before
+                           each transfer, like readMemFrame */
+} benchMode;
+
+typedef struct {
+  unsigned long nDeviceNo;
+  PDC_FRAME_INFO frameInfo;
+  size_t frameSize;
+} benchCamera;
+
+/* One head of a multi-head readout, run on its own thread like a port */
+typedef struct {
+  benchCamera *pCam;
+  unsigned long nChildNo;
+  epicsMutexId deviceLock;      /* The driver's per-device lock, or NULL */
+  epicsEventId doneEventId;
+  int numRead;
+  int numFailed;
+  int numWrong;
+} benchHead;
+
+
+/* Opens the simulated camera at ipAddr, records one memory and switches to
+   playback. The simulation must already be configured. */
+static int benchOpen(unsigned long ipAddr, benchCamera *pCam) {
+  static int initialized = 0;
+  unsigned long nErrorCode, status, width, height;
+  PDC_DETECT_NUM_INFO detectNumInfo;
+
+  if (!initialized) {
+    if (PDC_Init(&nErrorCode) == PDC_FAILED) {
+      printf("PDC_Init Error %lu\n", nErrorCode);
+      return -1;
+    }
+    initialized = 1;
+  }
+  if ((PDC_DetectDevice(PDC_INTTYPE_G_ETHER, &ipAddr, 1, PDC_DETECT_NORMAL,
+                        &detectNumInfo, &nErrorCode) == PDC_FAILED) ||
+      (PDC_OpenDevice(&detectNumInfo.m_DetectInfo[0], &pCam->nDeviceNo,
+                      &nErrorCode) == PDC_FAILED)) {
+    printf("Can't open the simulated camera: Error %lu\n", nErrorCode);
+    return -1;
+  }
+  /* A fast rate keeps the recording short */
+  PDC_SetRecordRate(pCam->nDeviceNo, 1, 20000, &nErrorCode);
+  PDC_SetRecReady(pCam->nDeviceNo, &nErrorCode);
+  PDC_SetEndless(pCam->nDeviceNo, &nErrorCode);
+  PDC_TriggerIn(pCam->nDeviceNo, &nErrorCode);
+  do {
+    epicsThreadSleep(0.01);
+    PDC_GetStatus(pCam->nDeviceNo, &status, &nErrorCode);
+  } while (status != PDC_STATUS_LIVE);
+  if ((PDC_SetStatus(pCam->nDeviceNo, PDC_STATUS_PLAYBACK,
+                     &nErrorCode) == PDC_FAILED) ||
+      (PDC_GetMemFrameInfo(pCam->nDeviceNo, 1, &pCam->frameInfo,
+                           &nErrorCode) == PDC_FAILED) ||
+      (PDC_GetMemResolution(pCam->nDeviceNo, 1, &width, &height,
+                            &nErrorCode) == PDC_FAILED)) {
+    printf("Can't read the simulated recording: Error %lu\n", nErrorCode);
+    PDC_CloseDevice(pCam->nDeviceNo, &nErrorCode);
+    return -1;
+  }
+  pCam->frameSize = width * height * 2;
+  return 0;
+}
+
+
+static void benchClose(benchCamera *pCam) {
+  unsigned long nErrorCode;
+
+  PDC_CloseDevice(pCam->nDeviceNo, &nErrorCode);
+}
+
+
+static double benchSeconds(const epicsTimeStamp *pStart) {
+  epicsTimeStamp now;
+
+  epicsTimeGetCurrent(&now);
+  return epicsTimeDiffInSeconds(&now, pStart);
+}
+
+
+/* Reads the whole memory with the Start/End pair, the way readImageRange
+   does, handling each frame as mode says. Returns frames/s, or 0 on error. */
+static double benchReadout(benchCamera *pCam, benchMode mode) {
+  unsigned long nErrorCode;
+  char *pBuffers[BENCH_BUFFERS];
+  char *pStage, *pDest;
+  char *pLoaded;
+  int staging = (mode == BENCH_STAGING);
+  PDC_IRIG_INFO tData;
+  epicsTimeStamp start;
+  double elapsed;
+  long frame, first, ahead, numFrames;
+  int index, numRead = 0, failed = 0;
+
+  first = pCam->frameInfo.m_nStart;
+  numFrames = pCam->frameInfo.m_nEnd - first + 1;
+  /* Which frames already have their IRIG time, like the driver's table */
+  pLoaded = (char *)calloc(numFrames, 1);
+  pStage = (char *)malloc(pCam->frameSize);
+  for (index=0; index<BENCH_BUFFERS; index++) {
+    pBuffers[index] = (char *)malloc(pCam->frameSize);
+    memset(pBuffers[index], 0, pCam->frameSize);
+  }
+  memset(pStage, 0, pCam->frameSize);
+
+  epicsTimeGetCurrent(&start);
+  for (frame=pCam->frameInfo.m_nStart; frame<=pCam->frameInfo.m_nEnd; frame++) {
+    pDest = pBuffers[numRead % BENCH_BUFFERS];
+    if (mode == BENCH_IRIG_PREFETCH) {
+      for (ahead=frame; (ahead<frame+BENCH_IRIG_AHEAD) && 
+                        (ahead-first<numFrames); ahead++) {
+        if (pLoaded[ahead - first]) continue;
+        if (PDC_GetMemIRIGData(pCam->nDeviceNo, 1, ahead, &tData,
+                               &nErrorCode) == PDC_FAILED) {
+          failed = 1;
+          break;
+        }
+        pLoaded[ahead - first] = 1;
+      }
+      if (failed) break;
+    }
+    if (PDC_GetMemImageDataStart(pCam->nDeviceNo, 1, frame, 16,
+                                 staging ? pStage : pDest,
+                                 &nErrorCode) == PDC_FAILED) {
+      failed = 1;
+      break;
+    }
+    if (PDC_GetMemImageDataEnd(pCam->nDeviceNo, 1, 16,
+                               staging ? pStage : pDest,
+                               &nErrorCode) == PDC_FAILED) {
+      failed = 1;
+    }
+    if (failed) break;
+    if (staging) {
+      memcpy(pDest, pStage, pCam->frameSize);
+    }
+    if ((mode == BENCH_IRIG_FRAME) &&
+        (PDC_GetMemIRIGData(pCam->nDeviceNo, 1, frame, &tData,
+                            &nErrorCode) == PDC_FAILED)) {
+      failed = 1;
+      break;
+    }
+    numRead++;
+  }
+  elapsed = benchSeconds(&start);
+
+  for (index=0; index<BENCH_BUFFERS; index++) {
+    free(pBuffers[index]);
+  }
+  free(pStage);
+  free(pLoaded);
+  if (failed) {
+    printf("Readout of frame %ld failed: Error %lu\n", frame, nErrorCode);
+    return 0.0;
+  }
+  if (elapsed <= 0.0) {
+    return 0.0;
+  }
+  return numRead / elapsed;
+}
+
+
+/* Reads the whole memory of one head, each Start/End pair under the device
+   lock like runSDKCommand. Frames whose first pixel isn't the head's value
+   are counted as wrong. */
+static void benchHeadTask(void *arg) {
+  benchHead *pHead = (benchHead *)arg;
+  benchCamera *pCam = pHead->pCam;
+  unsigned long nErrorCode, nRet;
+  epicsUInt16 *pBuf;
+  long frame;
+
+  pBuf = (epicsUInt16 *)malloc(pCam->frameSize);
+  for (frame=pCam->frameInfo.m_nStart; frame<=pCam->frameInfo.m_nEnd; frame++) {
+    if (pHead->deviceLock) epicsMutexMustLock(pHead->deviceLock);
+    nRet = PDC_GetMemImageDataStart(pCam->nDeviceNo, pHead->nChildNo, frame,
+                                    16, pBuf, &nErrorCode);
+    if (nRet == PDC_SUCCEEDED) {
+      nRet = PDC_GetMemImageDataEnd(pCam->nDeviceNo, pHead->nChildNo, 16, 
+                                    pBuf, &nErrorCode);
+    }
+    if (pHead->deviceLock) epicsMutexUnlock(pHead->deviceLock);
+    if (nRet == PDC_FAILED) {
+      pHead->numFailed++;
+      continue;
+    }
+    /* PDCSim's pattern for the 12 bit sensor benchHeads configures */
+    if (pBuf[0] != (epicsUInt16)((frame + 256 * (pHead->nChildNo - 1)) & 0xFFF)) {
+      pHead->numWrong++;
+    }
+    pHead->numRead++;
+  }
+  free(pBuf);
+  epicsEventSignal(pHead->doneEventId);
+}
+
+
+/* Reads every frame of numHeads heads at once, each on its own thread.
+   Returns the frames/s of all heads together, or 0 on error. */
+static double benchHeadReadout(benchCamera *pCam, int numHeads, int locked,
+                               int *pNumFailed, int *pNumWrong) {
+  benchHead heads[BENCH_MAX_HEADS];
+  epicsMutexId deviceLock = epicsMutexMustCreate();
+  epicsTimeStamp start;
+  double elapsed;
+  int index, numRead = 0;
+
+  *pNumFailed = 0;
+  *pNumWrong = 0;
+  epicsTimeGetCurrent(&start);
+  for (index=0; index<numHeads; index++) {
+    heads[index].pCam = pCam;
+    heads[index].nChildNo = index + 1;
+    heads[index].deviceLock = locked ? deviceLock : NULL;
+    heads[index].doneEventId = epicsEventMustCreate(epicsEventEmpty);
+    heads[index].numRead = 0;
+    heads[index].numFailed = 0;
+    heads[index].numWrong = 0;
+    epicsThreadCreate("benchHead", epicsThreadPriorityMedium,
+                      epicsThreadGetStackSize(epicsThreadStackMedium),
+                      benchHeadTask, &heads[index]);
+  }
+  for (index=0; index<numHeads; index++) {
+    epicsEventMustWait(heads[index].doneEventId);
+    epicsEventDestroy(heads[index].doneEventId);
+    numRead += heads[index].numRead;
+    *pNumFailed += heads[index].numFailed;
+    *pNumWrong += heads[index].numWrong;
+  }
+  elapsed = benchSeconds(&start);
+  epicsMutexDestroy(deviceLock);
+  if (elapsed <= 0.0) {
+    return 0.0;
+  }
+  return numRead / elapsed;
+}
+
+
+/* Best rate of BENCH_RUNS readouts */
+static double benchBestReadout(benchCamera *pCam, benchMode mode) {
+  double rate, best = 0.0;
+  int run;
+
+  for (run=0; run<BENCH_RUNS; run++) {
+    rate = benchReadout(pCam, mode);
+    if (rate > best) best = rate;
+  }
+  return best;
+}
+
+
+/* Memory readout through a staging buffer vs directly into the array */
+static int benchDirect(void) {
+  benchCamera cam;
+  double staged, direct;
+
+  /* No latency and unlimited bandwidth, so only the host's work counts */
+  PDCSim_Configure(1024, 1024, 12, 0.0, 0.0, 1000);
+  if (benchOpen(BENCH_IP_ADDR, &cam)) return -1;
+  staged = benchBestReadout(&cam, BENCH_STAGING);
+  direct = benchBestReadout(&cam, BENCH_DIRECT);
+  benchClose(&cam);
+
+  printf("Memory readout, 1000 frames of 1024x1024x16 bit, no latency, "
+         "unlimited bandwidth\n");
+  printf("  staging copy  %7.0f frames/s\n", staged);
+  printf("  direct        %7.0f frames/s\n", direct);
+  return 0;
+}
+
+
+/* Memory readout without IRIG, with a PDC_GetMemIRIGData call after each
+   frame, and with the times prefetched in chunks between the transfers */
+static int benchIRIG(void) {
+  static const struct {
+    unsigned long width, height;
+    double bandwidth;
+  } configs[] = {{512, 512, 200.0}, {256, 256, 200.0}, {1024, 1024, 400.0}};
+  benchCamera cam;
+  double off, perFrame, prefetched;
+  size_t index;
+
+  printf("Memory readout, 1000 frames, 200 us per SDK call\n");
+  printf("  geometry   link       IRIG off  per frame  prefetched\n");
+  for (index=0; index<sizeof(configs)/sizeof(configs[0]); index++) {
+    PDCSim_Configure(configs[index].width, configs[index].height, 12, 200.0,
+                     configs[index].bandwidth, 1000);
+    if (benchOpen(BENCH_IP_ADDR, &cam)) return -1;
+    off = benchBestReadout(&cam, BENCH_DIRECT);
+    perFrame = benchBestReadout(&cam, BENCH_IRIG_FRAME);
+    prefetched = benchBestReadout(&cam, BENCH_IRIG_PREFETCH);
+    benchClose(&cam);
+    printf("  %4lux%-4lu  %3.0f MB/s  %5.0f fps  %5.0f fps   %5.0f fps\n",
+           configs[index].width, configs[index].height,
+           configs[index].bandwidth, off, perFrame, prefetched);
+  }
+  return 0;
+}
+
+
+/* Memory readout of several heads of one camera, with and without the
+   driver's per-device lock around each transfer */
+static int benchHeads(void) {
+  static const int numHeads[] = {1, 2, 4, 8};
+  benchCamera cam;
+  double rate, best;
+  int index, run, numFailed, numWrong, unlockedFailed;
+
+  PDCSim_Configure(512, 512, 12, 200.0, 200.0, 500);
+  PDCSim_SetChildCount(BENCH_MAX_HEADS);
+  if (benchOpen(BENCH_IP_ADDR, &cam)) return -1;
+  printf("Memory readout of each head, 500 frames of 512x512x16 bit, "
+         "200 us per SDK call, 200 MB/s link\n");
+  printf("  heads  all heads  per head    MB/s   unlocked: failed "
+         "transfers\n");
+  for (index=0; index<(int)(sizeof(numHeads)/sizeof(numHeads[0])); index++) {
+    best = 0.0;
+    for (run=0; run<BENCH_RUNS; run++) {
+      rate = benchHeadReadout(&cam, numHeads[index], 1, &numFailed, &numWrong);
+      if (numFailed || numWrong) {
+        printf("%d heads: %d transfers failed, %d frames wrong\n",
+               numHeads[index], numFailed, numWrong);
+        benchClose(&cam);
+        return -1;
+      }
+      if (rate > best) best = rate;
+    }
+    benchHeadReadout(&cam, numHeads[index], 0, &unlockedFailed, &numWrong);
+    printf("  %5d  %5.0f fps  %5.0f fps  %6.1f   %d of %d\n", numHeads[index],
+           best, best / numHeads[index], best * cam.frameSize / 1.0e6, 
+           unlockedFailed, 500 * numHeads[index]);
+  }
+  benchClose(&cam);
+  return 0;
+}
+
+
+int main(int argc, char *argv[]) {
+  if ((argc == 2) && (strcmp(argv[1], "direct") == 0)) {
+    return benchDirect() ? 1 : 0;
+  }
+  if ((argc == 2) && (strcmp(argv[1], "irig") == 0)) {
+    return benchIRIG() ? 1 : 0;
+  }
+  if ((argc == 2) && (strcmp(argv[1], "heads") == 0)) {
+    return benchHeads() ? 1 : 0;
+  }
+  printf("Usage: %s test\n", argv[0]);
+  printf("  direct   memory readout into the array vs through a staging "
+         "buffer\n");
+  printf("  irig     memory readout with IRIG off, read per frame, and "
+         "prefetched\n");
+  printf("  heads    memory readout of 1 to 8 heads sharing one device\n");
+  return 1;
+}